@@ -0,0 +1,641 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* per-exec latency of a trivial binary run natively and through the various
+ * paths of csexec, see 'csexec-bench --help' */
+
+#define _GNU_SOURCE
+
+#include "cswrap-util.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* trivial binary with the default ELF interpreter */
+#ifndef BENCH_TRIVIAL
+#   define BENCH_TRIVIAL "exec-trivial"
+#endif
+
+/* the same binary linked with -Wl,--dynamic-linker=csexec-loader */
+#ifndef BENCH_TRIVIAL_CSEXEC
+#   define BENCH_TRIVIAL_CSEXEC "exec-trivial-csexec"
+#endif
+
+#ifndef BENCH_CSEXEC
+#   define BENCH_CSEXEC "csexec"
+#endif
+
+/* directory with libcsexec-preload.so */
+#ifndef BENCH_PRELOAD_DIR
+#   define BENCH_PRELOAD_DIR "."
+#endif
+
+/* runs excluded from the results to warm up the page cache */
+#define BENCH_WARMUP_RUNS 16
+
+#define NOT_MEASURED -1.0
+
+extern char **environ;
+
+static const char *prog_name;
+
+/* ld.so [--preload LIB] as printed by 'csexec --print-ld-exec-cmd' */
+static char *ld_exec_cmd;
+static char *ld_so;
+static char *ld_preload;
+
+/* CSEXEC_WRAP_CMD that makes csexec run ld.so as a --skip-ld-linux wrapper */
+static char *skip_ld_linux_cmd;
+
+enum exec_via {
+    EV_NATIVE,
+    EV_LD_SO,
+    EV_LD_SO_PRELOAD,
+    EV_CSEXEC,
+    EV_LOADER
+};
+
+struct scenario {
+    const char             *name;
+    const char             *desc;
+    enum exec_via           via;
+    const char             *wrap_cmd;
+    bool                    skip_ld_linux;
+};
+
+static const struct scenario scenario_list[] = {
+    {
+        "native",
+        "execute the trivial binary directly",
+        EV_NATIVE, NULL, false
+    }, {
+        "ld-so",
+        "execute it via ld.so",
+        EV_LD_SO, NULL, false
+    }, {
+        "ld-so-preload",
+        "execute it via ld.so --preload libcsexec-preload.so",
+        EV_LD_SO_PRELOAD, NULL, false
+    }, {
+        "loader",
+        "csexec-loader -> ld.so --preload",
+        EV_LOADER, NULL, false
+    }, {
+        "loader-wrap-env",
+        "csexec-loader -> env (looked up in $PATH) -> ld.so --preload",
+        EV_LOADER, "env", false
+    }, {
+        "loader-skip-ld-linux",
+        "csexec-loader -> --skip-ld-linux wrapper (ld.so, no preload)",
+        EV_LOADER, NULL, true
+    }, {
+        "csexec",
+        "csexec -> ld.so --preload",
+        EV_CSEXEC, NULL, false
+    }, {
+        "csexec-skip-ld-linux",
+        "csexec -> --skip-ld-linux wrapper (ld.so, no preload)",
+        EV_CSEXEC, NULL, true
+    },
+    { NULL, NULL, EV_NATIVE, NULL, false }
+};
+
+/* ------------------------------------------------------------------------- */
+/* fixture */
+
+/* read ld.so and its --preload argument from csexec */
+static bool read_ld_exec_cmd(void)
+{
+    FILE *fp = popen(BENCH_CSEXEC " --print-ld-exec-cmd", "r");
+    if (!fp)
+        return false;
+
+    size_t size = 0U;
+    const ssize_t len = getline(&ld_exec_cmd, &size, fp);
+    if (pclose(fp) || len <= 0)
+        return false;
+
+    ld_exec_cmd[strcspn(ld_exec_cmd, "\n")] = '\0';
+    ld_so = strtok(ld_exec_cmd, " ");
+    const char *opt = strtok(NULL, " ");
+    if (opt && STREQ(opt, "--preload"))
+        ld_preload = strtok(NULL, " ");
+
+    return ld_so
+        && -1 != asprintf(&skip_ld_linux_cmd, "--skip-ld-linux\a%s", ld_so);
+}
+
+/* make libcsexec-preload.so available to ld.so in the child processes */
+static bool init_env(void)
+{
+    const char *old = getenv("LD_LIBRARY_PATH");
+    char *val;
+    if (-1 == asprintf(&val, "%s%s%s", BENCH_PRELOAD_DIR, (old) ? ":" : "",
+                (old) ? old : ""))
+        return false;
+
+    const int rv = setenv("LD_LIBRARY_PATH", val, /* overwrite */ 1);
+    free(val);
+    return !rv;
+}
+
+/* return false if the scenario is not supported by ld.so */
+static bool setup_scenario(const struct scenario *s)
+{
+    if (EV_LD_SO_PRELOAD == s->via && !ld_preload)
+        return false;
+
+    const char *wrap_cmd = (s->skip_ld_linux)
+        ? skip_ld_linux_cmd
+        : s->wrap_cmd;
+    if (wrap_cmd)
+        return !setenv("CSEXEC_WRAP_CMD", wrap_cmd, /* overwrite */ 1);
+
+    return !unsetenv("CSEXEC_WRAP_CMD");
+}
+
+/* called in the child process, returns only on failure */
+static void exec_scenario(const struct scenario *s)
+{
+    const char *argv[8];
+    const char *file;
+    int i = 0;
+
+    switch (s->via) {
+        case EV_NATIVE:
+            file = BENCH_TRIVIAL;
+            argv[i++] = file;
+            break;
+
+        case EV_LD_SO:
+        case EV_LD_SO_PRELOAD:
+            file = ld_so;
+            argv[i++] = file;
+            if (EV_LD_SO_PRELOAD == s->via) {
+                argv[i++] = "--preload";
+                argv[i++] = ld_preload;
+            }
+            argv[i++] = BENCH_TRIVIAL;
+            break;
+
+        case EV_CSEXEC:
+            /* the way csexec-loader falls back to csexec: [EXECFN, ARG0] */
+            file = BENCH_CSEXEC;
+            argv[i++] = BENCH_TRIVIAL_CSEXEC;
+            argv[i++] = "exec-trivial";
+            break;
+
+        case EV_LOADER:
+        default:
+            file = BENCH_TRIVIAL_CSEXEC;
+            argv[i++] = "exec-trivial";
+            break;
+    }
+
+    argv[i] = NULL;
+    execve(file, (char **) argv, environ);
+}
+
+/* ------------------------------------------------------------------------- */
+/* measurement */
+
+struct result {
+    const char             *name;
+    double                  p50_us;
+    double                  p90_us;
+    double                  p99_us;
+    double                  max_us;
+    double                  execs_per_sec;
+    double                  syscalls;
+    double                  execs;
+};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/* return the q-quantile of the sorted samples (nearest rank) */
+static double percentile(const double *samples, int cnt, double q)
+{
+    int i = (int) (cnt * q + 0.999999);
+    if (i < 1)
+        i = 1;
+
+    return samples[i - 1];
+}
+
+/* fork, execute the scenario, and wait for it, return the elapsed time in ns
+ * or a negative value on failure */
+static double run_once(const struct scenario *s)
+{
+    const double start = now_ns();
+    const pid_t pid = fork();
+    if (!pid) {
+        exec_scenario(s);
+        _exit(127);
+    }
+
+    int status;
+    if (pid < 0 || pid != waitpid(pid, &status, 0)
+            || !WIFEXITED(status) || WEXITSTATUS(status))
+        return -1.0;
+
+    return now_ns() - start;
+}
+
+/* run the scenario in a traced child, count the syscalls it enters and the
+ * execve() calls that succeed, return false if tracing is not possible */
+static bool count_syscalls(const struct scenario *s, struct result *res)
+{
+    fflush(NULL);
+    const pid_t pid = fork();
+    if (pid < 0)
+        return false;
+
+    if (!pid) {
+        /* child */
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL))
+            _exit(EXIT_FAILURE);
+
+        raise(SIGSTOP);
+        exec_scenario(s);
+        _exit(127);
+    }
+
+    int status;
+    if (pid != waitpid(pid, &status, 0) || !WIFSTOPPED(status)) {
+        /* PTRACE_TRACEME failed */
+        waitpid(pid, &status, 0);
+        return false;
+    }
+
+    ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *) (PTRACE_O_TRACESYSGOOD
+                | PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL));
+
+    long syscalls = 0L;
+    long execs = 0L;
+    bool in_syscall = false;
+    int sig = 0;
+    for (;;) {
+        if (ptrace(PTRACE_SYSCALL, pid, NULL, (void *) (long) sig)) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return false;
+        }
+
+        if (pid != waitpid(pid, &status, 0))
+            return false;
+
+        if (WIFEXITED(status)) {
+            if (WEXITSTATUS(status))
+                return false;
+
+            res->syscalls = syscalls;
+            res->execs = execs;
+            return true;
+        }
+
+        if (WIFSIGNALED(status))
+            return false;
+
+        sig = WSTOPSIG(status);
+        if ((SIGTRAP | 0x80) == sig) {
+            /* syscall-enter-stop and syscall-exit-stop alternate */
+            in_syscall = !in_syscall;
+            if (in_syscall)
+                ++syscalls;
+            sig = 0;
+        }
+        else if (SIGTRAP == sig && PTRACE_EVENT_EXEC == status >> 16) {
+            ++execs;
+            sig = 0;
+        }
+    }
+}
+
+static bool measure(const struct scenario *s, int runs, struct result *res)
+{
+    int i;
+    for (i = 0; i < BENCH_WARMUP_RUNS; ++i)
+        if (run_once(s) < 0.0)
+            return false;
+
+    double *samples = malloc(runs * sizeof *samples);
+    if (!samples)
+        return false;
+
+    double total = 0.0;
+    for (i = 0; i < runs; ++i) {
+        samples[i] = run_once(s);
+        if (samples[i] < 0.0) {
+            free(samples);
+            return false;
+        }
+        total += samples[i];
+    }
+
+    qsort(samples, runs, sizeof *samples, cmp_double);
+    res->name = s->name;
+    res->p50_us = percentile(samples, runs, 0.50) / 1e3;
+    res->p90_us = percentile(samples, runs, 0.90) / 1e3;
+    res->p99_us = percentile(samples, runs, 0.99) / 1e3;
+    res->max_us = samples[runs - 1] / 1e3;
+    res->execs_per_sec = runs * 1e9 / total;
+    free(samples);
+
+    if (!count_syscalls(s, res))
+        res->syscalls = res->execs = NOT_MEASURED;
+
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* reporting */
+
+static void print_value(FILE *fp, const char *fmt, double val)
+{
+    if (val < 0.0)
+        fprintf(fp, "%9s", "n/a");
+    else
+        fprintf(fp, fmt, val);
+}
+
+static void print_header(void)
+{
+    printf("%-22s %9s %9s %9s %9s %9s %9s %9s\n", "SCENARIO", "p50[us]",
+            "p90[us]", "p99[us]", "max[us]", "execs/s", "syscalls", "execve");
+}
+
+static void print_result(const struct result *res)
+{
+    printf("%-22s", res->name);
+    print_value(stdout, " %8.1f", res->p50_us);
+    print_value(stdout, " %8.1f", res->p90_us);
+    print_value(stdout, " %8.1f", res->p99_us);
+    print_value(stdout, " %8.1f", res->max_us);
+    print_value(stdout, " %8.0f", res->execs_per_sec);
+    print_value(stdout, " %8.0f", res->syscalls);
+    print_value(stdout, " %8.0f", res->execs);
+    putchar('\n');
+}
+
+static bool save_results(const char *file, const struct result *results,
+                         size_t cnt)
+{
+    FILE *fp = fopen(file, "w");
+    if (!fp) {
+        fprintf(stderr, "%s: error: failed to open %s: %s\n", prog_name,
+                file, strerror(errno));
+        return false;
+    }
+
+    fprintf(fp, "# csexec-bench baseline: name p50_us p90_us p99_us max_us "
+            "execs/s syscalls execve\n");
+    size_t i;
+    for (i = 0U; i < cnt; ++i)
+        fprintf(fp, "%s %.1f %.1f %.1f %.1f %.0f %.0f %.0f\n",
+                results[i].name, results[i].p50_us, results[i].p90_us,
+                results[i].p99_us, results[i].max_us,
+                results[i].execs_per_sec, results[i].syscalls,
+                results[i].execs);
+
+    return !fclose(fp);
+}
+
+/* compare results with the baseline, return the number of regressions */
+static int compare_results(const char *file, const struct result *results,
+                           size_t cnt, double threshold)
+{
+    FILE *fp = fopen(file, "r");
+    if (!fp) {
+        fprintf(stderr, "%s: error: failed to open %s: %s\n", prog_name,
+                file, strerror(errno));
+        return -1;
+    }
+
+    printf("\n%-22s %14s %14s %9s  %s\n", "SCENARIO", "base p50[us]",
+            "p50[us]", "delta", "verdict");
+
+    int regressions = 0;
+    char line[256];
+    while (fgets(line, sizeof line, fp)) {
+        char name[128];
+        struct result base;
+        if ('#' == line[0] || 8 != sscanf(line,
+                    "%127s %lf %lf %lf %lf %lf %lf %lf", name, &base.p50_us,
+                    &base.p90_us, &base.p99_us, &base.max_us,
+                    &base.execs_per_sec, &base.syscalls, &base.execs))
+            continue;
+
+        const struct result *cur = NULL;
+        size_t i;
+        for (i = 0U; i < cnt; ++i)
+            if (STREQ(results[i].name, name))
+                cur = &results[i];
+
+        if (!cur)
+            /* not selected to run */
+            continue;
+
+        const double delta = 100.0 * (cur->p50_us - base.p50_us)
+            / base.p50_us;
+        const char *verdict = "ok";
+        if (cur->p50_us > base.p50_us * (1.0 + threshold / 100.0))
+            verdict = "SLOWER";
+        /* the counters are deterministic, any growth is a regression */
+        else if (0.0 <= base.execs && base.execs < cur->execs)
+            verdict = "MORE EXECS";
+        else if (0.0 <= base.syscalls && base.syscalls < cur->syscalls)
+            verdict = "MORE SYSCALLS";
+
+        if (!STREQ(verdict, "ok"))
+            ++regressions;
+
+        printf("%-22s %14.1f %14.1f %+8.1f%%  %s\n", name, base.p50_us,
+                cur->p50_us, delta, verdict);
+    }
+
+    fclose(fp);
+    return regressions;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void usage(FILE *fp)
+{
+    fprintf(fp, "Usage: %s [OPTION]... [NAME]...\n\n"
+            "Measure the latency of executing a trivial binary natively and "
+            "through csexec\n(all scenarios unless NAMEs are given).\n\n"
+            "    --list              list available scenarios\n"
+            "    --runs N            executions measured in each scenario "
+            "(default 500)\n"
+            "    --save FILE         save the results as a baseline\n"
+            "    --compare FILE      compare the results with a baseline, "
+            "fail on regression\n"
+            "    --threshold PCT     tolerated slowdown of p50 in percent "
+            "(default 10)\n", prog_name);
+}
+
+static const struct scenario *find_scenario(const char *name)
+{
+    const struct scenario *s;
+    for (s = scenario_list; s->name; ++s)
+        if (STREQ(s->name, name))
+            return s;
+
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    prog_name = argv[0];
+
+    const char *save_file = NULL;
+    const char *compare_file = NULL;
+    int runs = 500;
+    double threshold = 10.0;
+
+    int i;
+    for (i = 1; i < argc && MATCH_PREFIX(argv[i], "--"); ++i) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (STREQ(opt, "--help")) {
+            usage(stdout);
+            return EXIT_SUCCESS;
+        }
+
+        if (STREQ(opt, "--list")) {
+            const struct scenario *s;
+            for (s = scenario_list; s->name; ++s)
+                printf("%-22s %s\n", s->name, s->desc);
+            return EXIT_SUCCESS;
+        }
+
+        if (!val) {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+
+        if (STREQ(opt, "--runs"))
+            runs = atoi(val);
+        else if (STREQ(opt, "--save"))
+            save_file = val;
+        else if (STREQ(opt, "--compare"))
+            compare_file = val;
+        else if (STREQ(opt, "--threshold"))
+            threshold = atof(val);
+        else {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+
+        ++i;
+    }
+
+    if (runs < 1) {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+
+    int j;
+    for (j = i; j < argc; ++j) {
+        if (!find_scenario(argv[j])) {
+            fprintf(stderr, "%s: error: unknown scenario: %s\n", prog_name,
+                    argv[j]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!read_ld_exec_cmd()) {
+        fprintf(stderr, "%s: error: failed to read the ld.so command from "
+                "%s\n", prog_name, BENCH_CSEXEC);
+        return EXIT_FAILURE;
+    }
+
+    if (!init_env()) {
+        fprintf(stderr, "%s: error: failed to set LD_LIBRARY_PATH\n",
+                prog_name);
+        return EXIT_FAILURE;
+    }
+
+    struct result results[sizeof scenario_list / sizeof *scenario_list];
+    size_t cnt = 0U;
+    int status = EXIT_SUCCESS;
+
+    print_header();
+    const struct scenario *s;
+    for (s = scenario_list; s->name; ++s) {
+        if (i < argc) {
+            for (j = i; j < argc && !STREQ(argv[j], s->name); ++j)
+                ;
+            if (j == argc)
+                continue;
+        }
+
+        if (!setup_scenario(s)) {
+            printf("%-22s %s\n", s->name, "(not supported by ld.so)");
+            continue;
+        }
+
+        if (!measure(s, runs, &results[cnt])) {
+            fprintf(stderr, "%s: error: failed to execute %s\n", prog_name,
+                    s->name);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        print_result(&results[cnt++]);
+    }
+
+    if (save_file && !save_results(save_file, results, cnt))
+        status = EXIT_FAILURE;
+
+    if (compare_file) {
+        const int regressions = compare_results(compare_file, results, cnt,
+                threshold);
+        if (regressions) {
+            fflush(stdout);
+            if (0 < regressions)
+                fprintf(stderr, "%s: %d scenario(s) regressed\n", prog_name,
+                        regressions);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    free(skip_ld_linux_cmd);
+    free(ld_exec_cmd);
+    return status;
+}
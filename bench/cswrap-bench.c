@@ -0,0 +1,938 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* microbenchmarks of the hot functions of cswrap, see 'cswrap-bench --help' */
+
+#define _GNU_SOURCE
+
+#include "cswrap-translate.h"
+#include "cswrap-util.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef BENCH_CORPUS_DIR
+#   define BENCH_CORPUS_DIR "corpus"
+#endif
+
+#ifndef BENCH_CSWRAP
+#   define BENCH_CSWRAP "cswrap"
+#endif
+
+/* number of timed runs of each benchmark, the median is reported */
+#define BENCH_REPS 5
+
+/* number of operations executed while counting syscalls */
+#define BENCH_SYSCALL_OPS 256UL
+
+/* number of directories in the long $PATH */
+#define BENCH_PATH_DIRS 64
+
+/* number of arguments of the large argv given to handle_cvar() */
+#define BENCH_ARGV_SIZE 2048
+
+/* number of flags in add_flags */
+#define BENCH_ADD_FLAGS 5
+
+/* value of a counter that could not be measured */
+#define NOT_MEASURED -1.0
+
+static const char *prog_name;
+
+/* ------------------------------------------------------------------------- */
+/* counting of allocations */
+
+static unsigned long n_allocs;
+
+#ifdef BENCH_COUNT_ALLOCS
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+void *malloc(size_t size)
+{
+    ++n_allocs;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    ++n_allocs;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    ++n_allocs;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* fixture shared by all benchmarks */
+
+static char scratch[] = "/tmp/cswrap-bench.XXXXXX";
+static char *long_path;
+static char *path_buf;
+static size_t path_size;
+
+struct corpus {
+    char                  **lines;
+    size_t                  cnt;
+};
+
+static struct corpus corpora[3];
+static const char *corpus_names[] = { "gcc", "clang", "clang-analyzer" };
+
+static char *startup_tool;
+static char *startup_env[2];
+
+static char **big_argv;
+static char *del_globs;
+static char *add_flags;
+
+static int create_file(const char *path, mode_t mode)
+{
+    char *dup = strdup(path);
+    char *slash;
+    for (slash = dup + strlen(scratch) + 1U; (slash = strchr(slash, '/'));
+            *slash++ = '/') {
+        *slash = '\0';
+        if (mkdir(dup, 0755) && EEXIST != errno) {
+            free(dup);
+            return -1;
+        }
+    }
+
+    free(dup);
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return -1;
+
+    fclose(fp);
+    return chmod(path, mode);
+}
+
+/* create files listed in tree.lst so that the paths can be resolved */
+static bool create_tree(const char *corpus_dir)
+{
+    char *name;
+    if (-1 == asprintf(&name, "%s/tree.lst", corpus_dir))
+        return false;
+
+    size_t size;
+    char *lst = read_file(name, &size);
+    free(name);
+    if (!lst)
+        return false;
+
+    bool ok = true;
+    char *line, *save;
+    for (line = strtok_r(lst, "\n", &save); ok && line;
+            line = strtok_r(NULL, "\n", &save)) {
+        if ('#' == line[0])
+            continue;
+
+        char *path;
+        ok = (-1 != asprintf(&path, "%s/tree/%s", scratch, line))
+            && !create_file(path, 0644);
+        if (ok)
+            free(path);
+    }
+
+    free(lst);
+    return ok;
+}
+
+static bool load_corpus(struct corpus *c, const char *corpus_dir,
+                        const char *name)
+{
+    char *file;
+    if (-1 == asprintf(&file, "%s/%s.err", corpus_dir, name))
+        return false;
+
+    size_t size;
+    char *data = read_file(file, &size);
+    if (!data) {
+        fprintf(stderr, "%s: error: failed to read %s\n", prog_name, file);
+        free(file);
+        return false;
+    }
+
+    free(file);
+
+    /* split the corpus to lines, keep the new-line characters */
+    char *line = data;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        end = (end) ? end + 1 : line + strlen(line);
+        c->lines = realloc(c->lines, (c->cnt + 1U) * sizeof *c->lines);
+        if (!c->lines)
+            return false;
+
+        c->lines[c->cnt++] = strndup(line, end - line);
+        line = end;
+    }
+
+    free(data);
+    return 0U < c->cnt;
+}
+
+/* $PATH with BENCH_PATH_DIRS items, the wrapper shows up every 8 items and
+ * the tool is found in the last one */
+static bool create_long_path(void)
+{
+    char *wrap;
+    if (-1 == asprintf(&wrap, "%s/wrap/cswrap", scratch)
+            || create_file(wrap, 0755))
+        return false;
+
+    size_t len = 0U;
+    int i;
+    for (i = 0; i < BENCH_PATH_DIRS; ++i) {
+        char *dir, *tool;
+        if (-1 == asprintf(&dir, "%s/path/%02d", scratch, i))
+            return false;
+
+        if (-1 == asprintf(&tool, "%s/gcc", dir))
+            return false;
+
+        if (i == BENCH_PATH_DIRS - 1) {
+            if (create_file(tool, 0755))
+                return false;
+        }
+        else if (0 == i % 8) {
+            if (create_file(tool, 0644) || unlink(tool) || symlink(wrap, tool))
+                return false;
+        }
+        else if (mkdir(dir, 0755) && EEXIST != errno)
+            return false;
+
+        char *sep = (i) ? ":" : "";
+        long_path = realloc(long_path, len + strlen(sep) + strlen(dir) + 1U);
+        if (!long_path)
+            return false;
+
+        len += sprintf(long_path + len, "%s%s", sep, dir);
+        free(tool);
+        free(dir);
+    }
+
+    free(wrap);
+    path_size = len + 1U;
+    path_buf = malloc(path_size);
+    return !!path_buf;
+}
+
+/* command line of a huge compile job and globs to delete/add flags in it */
+static bool create_big_argv(void)
+{
+    big_argv = calloc(BENCH_ARGV_SIZE + 1, sizeof *big_argv);
+    if (!big_argv)
+        return false;
+
+    big_argv[0] = "gcc";
+    int i;
+    for (i = 1; i < BENCH_ARGV_SIZE; ++i) {
+        char *arg;
+        int rv;
+        switch (i % 8) {
+            case 0:  rv = asprintf(&arg, "-I/usr/include/pkg%d", i); break;
+            case 1:  rv = asprintf(&arg, "-DHAVE_FEATURE_%d=1", i);  break;
+            case 2:  rv = asprintf(&arg, "-Wno-error=unused-%d", i); break;
+            case 3:  rv = asprintf(&arg, "-O%d", i % 4);             break;
+            case 4:  rv = asprintf(&arg, "-fstack-protector-strong"); break;
+            case 5:  rv = asprintf(&arg, "-isystem/opt/sdk%d", i);   break;
+            case 6:  rv = asprintf(&arg, "-g%d", i % 4);             break;
+            default: rv = asprintf(&arg, "src/file%d.c", i);         break;
+        }
+        if (-1 == rv)
+            return false;
+
+        big_argv[i] = arg;
+    }
+
+    /* 32 globs of which only a few match anything */
+    static const char *matching_globs[] = {
+        "-O[0-9]", "-g*", "-Werror*", "-fstack-protector*"
+    };
+
+    size_t len = 0U;
+    for (i = 0; i < 32; ++i) {
+        char glob[32];
+        const int glen = (i < 4)
+            ? snprintf(glob, sizeof glob, "%s", matching_globs[i])
+            : snprintf(glob, sizeof glob, "-fno-feature-%d*", i);
+
+        del_globs = realloc(del_globs, len + glen + 2U);
+        if (!del_globs)
+            return false;
+
+        len += sprintf(del_globs + len, "%s%s", (i) ? ":" : "", glob);
+    }
+
+    add_flags = strdup("-O0:-g3:-fno-strict-aliasing:-Wall:-Wextra");
+    return !!add_flags;
+}
+
+/* symlink to cswrap named as a tool that does nothing */
+static bool create_startup_tool(void)
+{
+    if (-1 == asprintf(&startup_tool, "%s/startup/true", scratch)
+            || create_file(startup_tool, 0644) || unlink(startup_tool)
+            || symlink(BENCH_CSWRAP, startup_tool))
+        return false;
+
+    return -1 != asprintf(&startup_env[0], "PATH=%s/startup:/usr/bin:/bin",
+            scratch);
+}
+
+static void remove_scratch(void)
+{
+    char *cmd;
+    if (-1 != asprintf(&cmd, "rm -rf '%s'", scratch)) {
+        if (system(cmd))
+            fprintf(stderr, "%s: warning: failed to remove %s\n", prog_name,
+                    scratch);
+        free(cmd);
+    }
+}
+
+static bool init_fixture(const char *corpus_dir)
+{
+    if (!mkdtemp(scratch)) {
+        fprintf(stderr, "%s: error: mkdtemp() failed: %s\n", prog_name,
+                strerror(errno));
+        return false;
+    }
+
+    if (!create_tree(corpus_dir) || !create_long_path() || !create_big_argv()
+            || !create_startup_tool())
+        goto fail;
+
+    size_t i;
+    for (i = 0U; i < sizeof corpora / sizeof *corpora; ++i)
+        if (!load_corpus(&corpora[i], corpus_dir, corpus_names[i]))
+            goto fail;
+
+    return true;
+
+fail:
+    fprintf(stderr, "%s: error: failed to prepare fixture in %s\n",
+            prog_name, scratch);
+    remove_scratch();
+    return false;
+}
+
+/* ------------------------------------------------------------------------- */
+/* the benchmarks */
+
+static struct cswrap_translator *tr;
+static size_t tr_line;
+
+static void translate(struct corpus *c, unsigned long n)
+{
+    for (; n; --n) {
+        struct cswrap_line res;
+        cswrap_translate_line(tr, c->lines[tr_line], &res);
+        cswrap_line_free(&res);
+        if (++tr_line == c->cnt)
+            tr_line = 0U;
+    }
+}
+
+static bool translate_setup(unsigned flags)
+{
+    char *cwd;
+    if (-1 == asprintf(&cwd, "%s/tree", scratch))
+        return false;
+
+    tr = cswrap_translator_new(cwd, "gcc", flags);
+    free(cwd);
+    tr_line = 0U;
+    return !!tr;
+}
+
+static bool setup_plain(void)
+{
+    return translate_setup(0U);
+}
+
+static bool setup_analyzer(void)
+{
+    return translate_setup(CSWRAP_ANALYZER_NOTES);
+}
+
+static void teardown_translator(void)
+{
+    cswrap_translator_free(tr);
+    tr = NULL;
+}
+
+static void run_translate_gcc(unsigned long n)
+{
+    translate(&corpora[0], n);
+}
+
+static void run_translate_clang(unsigned long n)
+{
+    translate(&corpora[1], n);
+}
+
+static void run_translate_analyzer(unsigned long n)
+{
+    translate(&corpora[2], n);
+}
+
+static void run_remove_self(unsigned long n)
+{
+    for (; n; --n) {
+        memcpy(path_buf, long_path, path_size);
+        remove_self_from_path("gcc", path_buf, "cswrap");
+    }
+}
+
+static void run_find_tool(unsigned long n)
+{
+    for (; n; --n) {
+        memcpy(path_buf, long_path, path_size);
+        free(find_tool_in_path("gcc", path_buf, "cswrap"));
+    }
+}
+
+/* input file names as seen while running ./configure, cmake, meson, ... */
+static const char *configure_names[] = {
+    "conftest.c",
+    "/tmp/build/CMakeFiles/CMakeTmp/src.c",
+    "CMakeFiles/cmTC_4f2a1.dir/testCCompiler.c",
+    "_configtest.c",
+    "foo.cudafe1.cpp",
+    "try.c",
+    "ztest12345.c",
+    "config.h/probe.c",
+    "src/parser.c",
+    "lib/hash.c",
+    "../../main.c",
+    "test.c",
+    NULL
+};
+
+static void run_is_ignored(unsigned long n)
+{
+    const char **pname = configure_names;
+    for (; n; --n) {
+        is_ignored_file(*pname);
+        if (!*++pname)
+            pname = configure_names;
+    }
+}
+
+static void run_handle_cvar(unsigned long n)
+{
+    for (; n; --n) {
+        char **argv = malloc((BENCH_ARGV_SIZE + 1) * sizeof *argv);
+        if (!argv)
+            abort();
+
+        memcpy(argv, big_argv, (BENCH_ARGV_SIZE + 1) * sizeof *argv);
+        if (!handle_cvar(&argv, FO_DEL, "CSWRAP_BENCH_DEL_FLAGS")
+                || !handle_cvar(&argv, FO_ADD, "CSWRAP_BENCH_ADD_FLAGS"))
+            abort();
+
+        /* free only the flags appended by handle_cvar() */
+        int argc;
+        for (argc = 0; argv[argc]; ++argc)
+            ;
+        for (argc -= BENCH_ADD_FLAGS; argv[argc]; ++argc)
+            free(argv[argc]);
+        free(argv);
+    }
+}
+
+static void run_startup(unsigned long n)
+{
+    for (; n; --n) {
+        const pid_t pid = fork();
+        if (!pid) {
+            char *argv[] = { "true", NULL };
+            execve(startup_tool, argv, startup_env);
+            _exit(127);
+        }
+
+        int status;
+        if (pid < 0 || pid != waitpid(pid, &status, 0)
+                || !WIFEXITED(status) || WEXITSTATUS(status))
+            abort();
+    }
+}
+
+struct bench {
+    const char             *name;
+    const char             *desc;
+    bool                  (*setup)(void);
+    void                  (*run)(unsigned long n);
+    void                  (*teardown)(void);
+};
+
+static const struct bench bench_list[] = {
+    {
+        "translate-gcc",
+        "translate one line of gcc diagnostics",
+        setup_plain, run_translate_gcc, teardown_translator
+    }, {
+        "translate-clang",
+        "translate one line of clang diagnostics",
+        setup_plain, run_translate_clang, teardown_translator
+    }, {
+        "translate-analyzer",
+        "translate one line of clang --analyze diagnostics",
+        setup_analyzer, run_translate_analyzer, teardown_translator
+    }, {
+        "remove-self-from-path",
+        "drop the wrapper from a $PATH of 64 items",
+        NULL, run_remove_self, NULL
+    }, {
+        "find-tool-in-path",
+        "look up the tool in a $PATH of 64 items",
+        NULL, run_find_tool, NULL
+    }, {
+        "is-ignored-file",
+        "check one input file name of a configure-style argv",
+        NULL, run_is_ignored, NULL
+    }, {
+        "handle-cvar",
+        "apply 32 globs and 5 flags to a 2048-item argv",
+        NULL, run_handle_cvar, NULL
+    }, {
+        "wrapper-startup",
+        "run /bin/true through cswrap (fork, exec, and wait)",
+        NULL, run_startup, NULL
+    },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+/* ------------------------------------------------------------------------- */
+/* measurement */
+
+struct result {
+    const char             *name;
+    double                  ns;
+    double                  syscalls;
+    double                  allocs;
+};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/* run the benchmark in a traced child and count syscalls it enters between
+ * two SIGSTOP markers, return the count or -1 if tracing is not possible */
+static long count_syscalls(const struct bench *b, unsigned long n)
+{
+    fflush(NULL);
+    const pid_t pid = fork();
+    if (pid < 0)
+        return -1L;
+
+    if (!pid) {
+        /* child */
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL))
+            _exit(EXIT_FAILURE);
+
+        raise(SIGSTOP);
+        if (b->setup && !b->setup())
+            _exit(EXIT_FAILURE);
+
+        /* warm up lazily initialized state outside of the measured region */
+        b->run(1UL);
+        raise(SIGSTOP);
+        b->run(n);
+        raise(SIGSTOP);
+        _exit(EXIT_SUCCESS);
+    }
+
+    int status;
+    if (pid != waitpid(pid, &status, 0) || !WIFSTOPPED(status)) {
+        /* PTRACE_TRACEME failed */
+        waitpid(pid, &status, 0);
+        return -1L;
+    }
+
+    ptrace(PTRACE_SETOPTIONS, pid, NULL,
+            (void *) (PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL));
+
+    long cnt = 0L;
+    int markers = 0;
+    bool in_syscall = false;
+    int sig = 0;
+    for (;;) {
+        if (ptrace(PTRACE_SYSCALL, pid, NULL, (void *) (long) sig)) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return -1L;
+        }
+
+        if (pid != waitpid(pid, &status, 0))
+            return -1L;
+
+        if (WIFEXITED(status))
+            return (EXIT_SUCCESS == WEXITSTATUS(status) && 2 == markers)
+                ? cnt
+                : -1L;
+
+        if (WIFSIGNALED(status))
+            return -1L;
+
+        sig = WSTOPSIG(status);
+        if ((SIGTRAP | 0x80) == sig) {
+            /* syscall-enter-stop and syscall-exit-stop alternate */
+            in_syscall = !in_syscall;
+            if (in_syscall && 1 == markers)
+                ++cnt;
+            sig = 0;
+        }
+        else if (SIGSTOP == sig) {
+            ++markers;
+            sig = 0;
+        }
+    }
+}
+
+static double syscalls_per_op(const struct bench *b)
+{
+    const long base = count_syscalls(b, 0UL);
+    const long full = count_syscalls(b, BENCH_SYSCALL_OPS);
+    if (base < 0L || full < base)
+        return NOT_MEASURED;
+
+    return (double) (full - base) / BENCH_SYSCALL_OPS;
+}
+
+static bool measure(const struct bench *b, double min_time_ms,
+                    struct result *res)
+{
+    if (b->setup && !b->setup())
+        return false;
+
+    /* find the number of operations that takes at least 1/BENCH_REPS of the
+     * requested time */
+    const double min_ns = min_time_ms * 1e6 / BENCH_REPS;
+    unsigned long n = 1UL;
+    double elapsed;
+    for (;;) {
+        const double start = now_ns();
+        b->run(n);
+        elapsed = now_ns() - start;
+        if (min_ns <= elapsed)
+            break;
+
+        const double scale = (elapsed < min_ns / 100.0)
+            ? 100.0
+            : 1.2 * min_ns / elapsed;
+        n = (unsigned long) (n * scale) + 1UL;
+    }
+
+    double samples[BENCH_REPS];
+    int i;
+    for (i = 0; i < BENCH_REPS; ++i) {
+        const unsigned long allocs = n_allocs;
+        const double start = now_ns();
+        b->run(n);
+        samples[i] = (now_ns() - start) / n;
+        if (!i)
+            res->allocs = (double) (n_allocs - allocs) / n;
+    }
+
+    if (b->teardown)
+        b->teardown();
+
+    qsort(samples, BENCH_REPS, sizeof *samples, cmp_double);
+    res->name = b->name;
+    res->ns = samples[BENCH_REPS / 2];
+    res->syscalls = syscalls_per_op(b);
+#ifndef BENCH_COUNT_ALLOCS
+    res->allocs = NOT_MEASURED;
+#endif
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* reporting */
+
+static void print_value(FILE *fp, const char *fmt, double val)
+{
+    if (val < 0.0)
+        fprintf(fp, "%14s", "n/a");
+    else
+        fprintf(fp, fmt, val);
+}
+
+static void print_header(void)
+{
+    printf("%-24s %14s %14s %14s\n", "BENCHMARK", "ns/op", "syscalls/op",
+            "allocs/op");
+}
+
+static void print_result(const struct result *res)
+{
+    printf("%-24s", res->name);
+    print_value(stdout, " %13.1f", res->ns);
+    print_value(stdout, " %13.2f", res->syscalls);
+    print_value(stdout, " %13.2f", res->allocs);
+    putchar('\n');
+}
+
+static bool save_results(const char *file, const struct result *results,
+                         size_t cnt)
+{
+    FILE *fp = fopen(file, "w");
+    if (!fp) {
+        fprintf(stderr, "%s: error: failed to open %s: %s\n", prog_name,
+                file, strerror(errno));
+        return false;
+    }
+
+    fprintf(fp, "# cswrap-bench baseline: name ns/op syscalls/op allocs/op\n");
+    size_t i;
+    for (i = 0U; i < cnt; ++i)
+        fprintf(fp, "%s %.1f %.2f %.2f\n", results[i].name, results[i].ns,
+                results[i].syscalls, results[i].allocs);
+
+    return !fclose(fp);
+}
+
+/* return true if cur is worse than base by more than tolerance */
+static bool regressed(double cur, double base, double tolerance)
+{
+    if (cur < 0.0 || base < 0.0)
+        /* not measured */
+        return false;
+
+    return cur > base + tolerance;
+}
+
+/* compare results with the baseline, return the number of regressions */
+static int compare_results(const char *file, const struct result *results,
+                           size_t cnt, double threshold)
+{
+    FILE *fp = fopen(file, "r");
+    if (!fp) {
+        fprintf(stderr, "%s: error: failed to open %s: %s\n", prog_name,
+                file, strerror(errno));
+        return -1;
+    }
+
+    printf("\n%-24s %14s %14s %9s  %s\n", "BENCHMARK", "base ns/op",
+            "ns/op", "delta", "verdict");
+
+    int regressions = 0;
+    char line[256];
+    while (fgets(line, sizeof line, fp)) {
+        char name[128];
+        struct result base;
+        if ('#' == line[0] || 4 != sscanf(line, "%127s %lf %lf %lf", name,
+                    &base.ns, &base.syscalls, &base.allocs))
+            continue;
+
+        const struct result *cur = NULL;
+        size_t i;
+        for (i = 0U; i < cnt; ++i)
+            if (STREQ(results[i].name, name))
+                cur = &results[i];
+
+        if (!cur)
+            /* not selected to run */
+            continue;
+
+        const double delta = 100.0 * (cur->ns - base.ns) / base.ns;
+        const char *verdict = "ok";
+        if (regressed(cur->ns, base.ns, base.ns * threshold / 100.0))
+            verdict = "SLOWER";
+        /* the counters are deterministic, any growth is a regression */
+        else if (regressed(cur->syscalls, base.syscalls, 0.005))
+            verdict = "MORE SYSCALLS";
+        else if (regressed(cur->allocs, base.allocs, 0.005))
+            verdict = "MORE ALLOCS";
+
+        if (!STREQ(verdict, "ok"))
+            ++regressions;
+
+        printf("%-24s %14.1f %14.1f %+8.1f%%  %s\n", name, base.ns, cur->ns,
+                delta, verdict);
+    }
+
+    fclose(fp);
+    return regressions;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void usage(FILE *fp)
+{
+    fprintf(fp, "Usage: %s [OPTION]... [NAME]...\n\n"
+            "Run microbenchmarks of cswrap (all of them unless NAMEs are "
+            "given).\n\n"
+            "    --list              list available benchmarks\n"
+            "    --min-time MS       time spent in each benchmark "
+            "(default 1000)\n"
+            "    --corpus-dir DIR    directory with recorded diagnostics\n"
+            "    --save FILE         save the results as a baseline\n"
+            "    --compare FILE      compare the results with a baseline, "
+            "fail on regression\n"
+            "    --threshold PCT     tolerated slowdown in percent "
+            "(default 10)\n", prog_name);
+}
+
+static const struct bench *find_bench(const char *name)
+{
+    const struct bench *b;
+    for (b = bench_list; b->name; ++b)
+        if (STREQ(b->name, name))
+            return b;
+
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    prog_name = argv[0];
+
+    const char *corpus_dir = BENCH_CORPUS_DIR;
+    const char *save_file = NULL;
+    const char *compare_file = NULL;
+    double min_time_ms = 1000.0;
+    double threshold = 10.0;
+
+    int i;
+    for (i = 1; i < argc && MATCH_PREFIX(argv[i], "--"); ++i) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (STREQ(opt, "--help")) {
+            usage(stdout);
+            return EXIT_SUCCESS;
+        }
+
+        if (STREQ(opt, "--list")) {
+            const struct bench *b;
+            for (b = bench_list; b->name; ++b)
+                printf("%-24s %s\n", b->name, b->desc);
+            return EXIT_SUCCESS;
+        }
+
+        if (!val) {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+
+        if (STREQ(opt, "--min-time"))
+            min_time_ms = atof(val);
+        else if (STREQ(opt, "--corpus-dir"))
+            corpus_dir = val;
+        else if (STREQ(opt, "--save"))
+            save_file = val;
+        else if (STREQ(opt, "--compare"))
+            compare_file = val;
+        else if (STREQ(opt, "--threshold"))
+            threshold = atof(val);
+        else {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+
+        ++i;
+    }
+
+    /* check names of the selected benchmarks before preparing the fixture */
+    int j;
+    for (j = i; j < argc; ++j) {
+        if (!find_bench(argv[j])) {
+            fprintf(stderr, "%s: error: unknown benchmark: %s\n", prog_name,
+                    argv[j]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!init_fixture(corpus_dir))
+        return EXIT_FAILURE;
+
+    /* handle_cvar() reads the flags from the environment */
+    setenv("CSWRAP_BENCH_DEL_FLAGS", del_globs, 1);
+    setenv("CSWRAP_BENCH_ADD_FLAGS", add_flags, 1);
+
+    struct result results[sizeof bench_list / sizeof *bench_list];
+    size_t cnt = 0U;
+    int status = EXIT_SUCCESS;
+
+    print_header();
+    const struct bench *b;
+    for (b = bench_list; b->name; ++b) {
+        if (i < argc) {
+            for (j = i; j < argc && !STREQ(argv[j], b->name); ++j)
+                ;
+            if (j == argc)
+                continue;
+        }
+
+        if (!measure(b, min_time_ms, &results[cnt])) {
+            fprintf(stderr, "%s: error: failed to set up %s\n", prog_name,
+                    b->name);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        print_result(&results[cnt++]);
+    }
+
+    remove_scratch();
+
+    if (save_file && !save_results(save_file, results, cnt))
+        status = EXIT_FAILURE;
+
+    if (compare_file) {
+        const int regressions = compare_results(compare_file, results, cnt,
+                threshold);
+        if (regressions) {
+            fflush(stdout);
+            if (0 < regressions)
+                fprintf(stderr, "%s: %d benchmark(s) regressed\n", prog_name,
+                        regressions);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* trivial binary executed by csexec-bench, so that its run-time is dominated
+ * by the cost of execve() and dynamic linking */
+
+int main(void)
+{
+    return 0;
+}
@@ -0,0 +1,160 @@
+#!/bin/bash
+
+# Copyright (C) 2026 Red Hat, Inc.
+#
+# This file is part of cswrap.
+#
+# cswrap is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# cswrap is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+
+# training workload of the PGO build (cmake -DPGO=ON), it runs instrumented
+# cswrap wrapping fake compilers that replay the recorded diagnostics in
+# corpus/, and instrumented csexec launching a test binary
+
+stamp=
+if [[ "$1" = --stamp ]]; then
+    stamp="$2"
+    shift 2
+fi
+
+if [[ $# -ne 2 ]]; then
+    echo "Usage: $0 [--stamp FILE] BIN_DIR PROFILE_DIR" >&2
+    exit 1
+fi
+
+bin_dir="$(realpath "$1")"
+prof_dir="$2"
+corpus="$(dirname "$(realpath "$0")")/corpus"
+
+# with --stamp, train only if the binaries or the workload have changed
+if [[ -n "$stamp" ]] && [[ -e "$stamp" ]]; then
+    newer="$(find "$bin_dir" "$corpus" "$0" -maxdepth 1 -type f \
+        -newer "$stamp" \( -name 'cswrap' -o -name 'csexec*' \
+        -o -name 'libcsexec*' -o -name '*.err' -o -name '*.lst' \
+        -o -name '*.sh' \) -print -quit)"
+    [[ -z "$newer" ]] && exit 0
+fi
+
+rm -rf "$prof_dir"
+mkdir -p "$prof_dir" || exit $?
+echo "Training instrumented binaries in $bin_dir"
+
+work="$(mktemp -d /tmp/cswrap-pgo.XXXXXX)" || exit $?
+trap 'rm -rf "$work"' EXIT
+cd "$work" || exit $?
+
+# files referenced by the recorded diagnostics
+grep -v '^#' "$corpus/tree.lst" | while read -r file; do
+    mkdir -p "$(dirname "$file")" && touch "$file" || exit $?
+done
+
+# fake compilers replaying the recorded diagnostics, and their wrappers
+mkdir -p compiler wrapper
+cat > compiler/gcc << EOF
+#!/bin/sh
+cat "$corpus/gcc.err" >&2
+EOF
+cat > compiler/clang << EOF
+#!/bin/sh
+for arg; do
+    test "\$arg" = --analyze && exec cat "$corpus/clang-analyzer.err" >&2
+done
+cat "$corpus/clang.err" >&2
+EOF
+chmod 0755 compiler/gcc compiler/clang || exit $?
+ln -s "$bin_dir/cswrap" wrapper/gcc || exit $?
+ln -s "$bin_dir/cswrap" wrapper/clang || exit $?
+
+wrapped_path="$work/wrapper:$work/compiler:$PATH"
+
+# run 8 concurrent batches of 16 wrapped compilations
+run_batches() {
+    local i j
+    for i in $(seq 8); do
+        for j in $(seq 16); do
+            PATH="$wrapped_path" "$@" -c src/main.c -o /dev/null
+        done 2>/dev/null &
+    done
+    wait
+}
+
+for tool in gcc clang "clang --analyze"; do
+    # shellcheck disable=SC2086
+    run_batches $tool
+    # shellcheck disable=SC2086
+    CSWRAP_CAP_FILE="$work/cap.err" run_batches $tool
+    # shellcheck disable=SC2086
+    CSWRAP_CAP_FILE="$work/cap.jsonl" CSWRAP_CAP_FORMAT=jsonl \
+        run_batches $tool
+done
+
+# the usual flag editing and exclusion
+CSWRAP_DEL_CFLAGS="-O*:-Werror*" CSWRAP_ADD_CFLAGS="-O0:-Wall" \
+    CSWRAP_EXCLUDE="$work/include/" run_batches gcc
+
+# csexec launching a test binary through its loader
+loader="$bin_dir/csexec-loader-test"
+if [[ -x "$loader" ]]; then
+    # the test binary resolves its own path as build tools usually do
+    cat > test.c << EOF
+#include <stdlib.h>
+#include <unistd.h>
+int main(void)
+{
+    char buf[4096];
+    for (int i = 0; i < 64; ++i) {
+        if (readlink("/proc/self/exe", buf, sizeof buf) < 0)
+            return 1;
+        free(canonicalize_file_name("/proc/self/exe"));
+    }
+    return 0;
+}
+EOF
+    "${CC:-cc}" -D_GNU_SOURCE -Wl,--dynamic-linker="$loader" -o test test.c \
+        || exit $?
+
+    # the wrapper that skips ld.so needs to load the binary by itself
+    export LD_LIBRARY_PATH="$bin_dir"
+    ld_so="$("$bin_dir/csexec" --print-ld-exec-cmd | cut -d' ' -f1)"
+    for i in $(seq 64); do
+        ./test || exit $?
+        CSEXEC_WRAP_CMD="env" ./test || exit $?
+        CSEXEC_WRAP_CMD=$'--skip-ld-linux\a'"$ld_so" ./test || exit $?
+    done
+
+    # the loader runs the command by itself, so exercise csexec directly:
+    # its options, a shebang script, and execve() as the loader would do it
+    printf '#!%s\n' "$work/test" > script
+    chmod 0755 script || exit $?
+    for i in $(seq 64); do
+        "$bin_dir/csexec" --help > /dev/null || exit $?
+        "$bin_dir/csexec" --print-ld-exec-cmd > /dev/null || exit $?
+        "$bin_dir/csexec" --print-ld-exec-cmd ./test > /dev/null || exit $?
+        ./script || exit $?
+        (exec -a "$work/test" "$bin_dir/csexec" ./test) || exit $?
+        (CSEXEC_WRAP_CMD="env" exec -a "$work/test" "$bin_dir/csexec" ./test) \
+            || exit $?
+    done
+fi
+
+# Clang writes raw profiles that need to be merged
+shopt -s nullglob
+raw=("$prof_dir"/*.profraw)
+if [[ ${#raw[@]} -gt 0 ]]; then
+    "${LLVM_PROFDATA:-llvm-profdata}" merge -o "$prof_dir/cswrap.profdata" \
+        "${raw[@]}" || exit $?
+fi
+
+if [[ -n "$stamp" ]]; then
+    touch "$stamp" || exit $?
+fi
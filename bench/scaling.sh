@@ -0,0 +1,237 @@
+#!/bin/bash
+
+# Copyright (C) 2026 Red Hat, Inc.
+#
+# This file is part of cswrap.
+#
+# cswrap is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# cswrap is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+
+# end-to-end scaling benchmark of many concurrent wrappers, it runs fake
+# compilers emitting diagnostics both directly and through cswrap
+
+self="$(basename "$0")"
+
+usage() {
+    cat << EOF
+Usage: $self [OPTION]... PATH_TO_CSWRAP
+
+Run N fake compilers at once, each emitting L lines of diagnostics, both
+directly and wrapped by cswrap with the capture file on or off.
+
+    -j "N..."     numbers of concurrent compilers (default "1 8 64 256")
+    -l "L..."     lines of diagnostics per compiler (default "0 100 1000")
+    -c "on|off"   capture file settings (default "off on")
+    -r REPS       repetitions of each configuration (default 3)
+    -o DIR        directory to write results.jsonl and results.csv to
+    -t LABEL      label of the results, e.g. version (default git describe)
+EOF
+}
+
+jobs_list="1 8 64 256"
+lines_list="0 100 1000"
+cap_list="off on"
+reps=3
+out_dir=.
+label=
+
+while getopts "j:l:c:r:o:t:h" opt; do
+    case "$opt" in
+        j) jobs_list="$OPTARG" ;;
+        l) lines_list="$OPTARG" ;;
+        c) cap_list="$OPTARG" ;;
+        r) reps="$OPTARG" ;;
+        o) out_dir="$OPTARG" ;;
+        t) label="$OPTARG" ;;
+        h) usage; exit 0 ;;
+        *) usage >&2; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [[ $# -ne 1 ]] || [[ ! -x "$1" ]]; then
+    usage >&2
+    exit 1
+fi
+
+cswrap="$(realpath "$1")"
+src_dir="$(dirname "$(realpath "$0")")/.."
+out_dir="$(realpath "$out_dir")"
+mkdir -p "$out_dir" || exit $?
+
+if [[ -z "$label" ]]; then
+    label="$(git -C "$src_dir" describe --always --dirty 2>/dev/null)"
+    label="${label:-unknown}"
+fi
+
+work="$(mktemp -d /tmp/cswrap-scaling.XXXXXX)" || exit $?
+trap 'rm -rf "$work"' EXIT
+cd "$work" || exit $?
+
+# fake compiler and its wrapper, the compiler replays a recorded stderr
+mkdir -p compiler wrapper src
+cat > compiler/bench-cc << 'EOF'
+#!/bin/sh
+exec cat "$BENCH_DIAG_FILE" >&2
+EOF
+chmod 0755 compiler/bench-cc || exit $?
+ln -s "$cswrap" wrapper/bench-cc || exit $?
+
+# source files the diagnostics refer to so that their paths get translated
+for i in $(seq 0 15); do
+    touch "src/f$i.c"
+done
+
+# write L lines of gcc-like diagnostics in blocks of 4 lines
+gen_diag() {
+    awk -v n="$1" 'BEGIN {
+        for (i = 0; i < n; i++) {
+            f = int(i / 4) % 16
+            ln = int(i / 4) + 1
+            if (i % 4 == 0)
+                printf "src/f%d.c: In function \x27fn%d\x27:\n", f, ln
+            else if (i % 4 == 1)
+                printf "src/f%d.c:%d:9: warning: unused variable \x27v\x27 " \
+                       "[-Wunused-variable]\n", f, ln
+            else if (i % 4 == 2)
+                printf "%5d |     int v;\n", ln
+            else
+                printf "      |         ^\n"
+        }
+    }'
+}
+
+now_us() {
+    local t
+    t="$(date +%s%N)"
+    echo $((t / 1000))
+}
+
+# run N compilers at once, print the wall time in microseconds
+run_batch() {
+    local n="$1" cmd="$2" i beg end
+    beg="$(now_us)"
+    for ((i = 0; i < n; i++)); do
+        "$cmd" 2>> build.log &
+    done
+    wait
+    end="$(now_us)"
+    echo $((end - beg))
+}
+
+# print the median of the numbers given as arguments
+median() {
+    printf '%s\n' "$@" | sort -n | awk '{ v[NR] = $1 }
+        END { print v[int((NR + 1) / 2)] }'
+}
+
+# print p50 p90 p99 max of the numbers on stdin, "null" if there are none
+percentiles() {
+    sort -n | awk '{ v[NR] = $1 }
+        function p(q) { i = int(NR * q + 0.999999); return v[(i < 1) ? 1 : i] }
+        END {
+            if (!NR) { print "null null null null"; exit }
+            print p(.50), p(.90), p(.99), v[NR]
+        }'
+}
+
+# extract the numeric value of the given key from JSON Lines records
+field() {
+    grep -o "\"$1\": [0-9]*" | awk '{ print $2 }'
+}
+
+jsonl="$out_dir/results.jsonl"
+csv="$out_dir/results.csv"
+: > "$jsonl"
+echo "label,jobs,lines,capture,direct_us,wrapped_us,overhead_us,\
+overhead_pct,lock_p50_us,lock_p90_us,lock_p99_us,lock_max_us,\
+cpu_us_per_line,cpu_us_per_wrapper" > "$csv"
+
+printf '%6s %6s %4s %12s %12s %9s %10s %10s %10s\n' JOBS LINES CAP \
+    "direct[ms]" "wrapped[ms]" overhead "lock p50" "lock p99" "cpu/line"
+printf '%6s %6s %4s %12s %12s %9s %10s %10s %10s\n' "" "" "" "" "" "" \
+    "[us]" "[us]" "[us]"
+
+for lines in $lines_list; do
+    export BENCH_DIAG_FILE="$work/diag.$lines"
+    gen_diag "$lines" > "$BENCH_DIAG_FILE"
+
+    for jobs in $jobs_list; do
+        # direct exec baseline, does not depend on the capture setting
+        direct=()
+        for ((r = 0; r < reps; r++)); do
+            direct+=("$(PATH="$work/compiler:$PATH" run_batch "$jobs" bench-cc)")
+        done
+        direct_us="$(median "${direct[@]}")"
+
+        for cap in $cap_list; do
+            rm -f build.log stats.jsonl cap.out
+            if [[ "$cap" = on ]]; then
+                export CSWRAP_CAP_FILE="$work/cap.out"
+            else
+                unset CSWRAP_CAP_FILE
+            fi
+
+            wrapped=()
+            for ((r = 0; r < reps; r++)); do
+                wrapped+=("$(CSWRAP_STATS_FILE="$work/stats.jsonl" \
+                    PATH="$work/wrapper:$work/compiler:$PATH" \
+                    run_batch "$jobs" bench-cc)")
+            done
+            wrapped_us="$(median "${wrapped[@]}")"
+
+            overhead_us=$((wrapped_us - direct_us))
+            overhead_pct="$(awk -v w="$wrapped_us" -v d="$direct_us" \
+                'BEGIN { printf "%.1f", (d) ? 100 * (w - d) / d : 0 }')"
+
+            read -r p50 p90 p99 pmax < <(
+                # only wrappers that had anything to capture take the lock
+                grep '"lock_waits": [1-9]' stats.jsonl \
+                    | field lock_wait_us | percentiles)
+
+            cpu_total="$(field cpu_us < stats.jsonl | awk '{ s += $1 } END { print s + 0 }')"
+            lines_total="$(field lines < stats.jsonl | awk '{ s += $1 } END { print s + 0 }')"
+            n_records="$(wc -l < stats.jsonl)"
+            cpu_per_line="$(awk -v c="$cpu_total" -v l="$lines_total" \
+                'BEGIN { if (l) printf "%.3f", c / l; else print "null" }')"
+            cpu_per_wrapper="$(awk -v c="$cpu_total" -v n="$n_records" \
+                'BEGIN { if (n) printf "%.1f", c / n; else print "null" }')"
+
+            printf '{"label": "%s", "jobs": %d, "lines": %d, "capture": %s, ' \
+                "$label" "$jobs" "$lines" \
+                "$([[ "$cap" = on ]] && echo true || echo false)" >> "$jsonl"
+            printf '"reps": %d, "direct_us": %d, "wrapped_us": %d, ' \
+                "$reps" "$direct_us" "$wrapped_us" >> "$jsonl"
+            printf '"overhead_us": %d, "overhead_pct": %s, ' \
+                "$overhead_us" "$overhead_pct" >> "$jsonl"
+            printf '"lock_wait_us": {"p50": %s, "p90": %s, "p99": %s, ' \
+                "$p50" "$p90" "$p99" >> "$jsonl"
+            printf '"max": %s}, "cpu_us_per_line": %s, ' \
+                "$pmax" "$cpu_per_line" >> "$jsonl"
+            printf '"cpu_us_per_wrapper": %s}\n' "$cpu_per_wrapper" >> "$jsonl"
+
+            echo "$label,$jobs,$lines,$cap,$direct_us,$wrapped_us,\
+$overhead_us,$overhead_pct,$p50,$p90,$p99,$pmax,$cpu_per_line,\
+$cpu_per_wrapper" | sed 's/null//g' >> "$csv"
+
+            printf '%6d %6d %4s %12.1f %12.1f %8s%% %10s %10s %10s\n' \
+                "$jobs" "$lines" "$cap" \
+                "$(awk -v v="$direct_us" 'BEGIN { print v / 1000 }')" \
+                "$(awk -v v="$wrapped_us" 'BEGIN { print v / 1000 }')" \
+                "$overhead_pct" "${p50/null/-}" "${p99/null/-}" \
+                "${cpu_per_line/null/-}"
+        done
+    done
+done
+
+echo "results written to $jsonl and $csv"
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2022 Red Hat, Inc.
+ * Copyright (C) 2022 - 2026 Red Hat, Inc.
  *
  * This file is part of cswrap.
  *
@@ -17,6 +17,34 @@
  * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+// numbers of the system calls we need
+enum {
+    SYS_openat  = 56,
+    SYS_read    = 63,
+    SYS_close   = 57,
+    SYS_execve  = 221,
+    SYS_exit    = 93
+};
+
+// execute the given system call, return negative errno on failure
+// doc: syscall(2) https://man7.org/linux/man-pages/man2/syscall.2.html
+// and https://marcin.juszkiewicz.com.pl/download/tables/syscalls.html
+static long loader_syscall(long nr, long arg1, long arg2, long arg3)
+{
+    register long x8 asm("x8") = nr;
+    register long x0 asm("x0") = arg1;
+    register long x1 asm("x1") = arg2;
+    register long x2 asm("x2") = arg3;
+    asm volatile (
+        "svc #0"                    // aarch64 syscall insn
+        : "+r" (x0)
+        : "r" (x8)
+        , "r" (x1)
+        , "r" (x2)
+        : "memory", "cc");
+    return x0;
+}
+
 #include "csexec-loader-common.c"
 
 // we do not start from main() to stay glibc-independent
@@ -32,31 +60,6 @@ void _start(void)
         , "=r" (argv)               // %1
         ::);
 
-    // pointer to a NULL-terminated list of environment variables
-    const char **env = argc + argv + 1;
-
-    // allocate exec_args[] on stack
-    const char *exec_args[/* execfn */ 1 + argc + /* term */ 1];
-
-    // fill exec_args[]
-    prepare_exec_args(exec_args, argv, env);
-
-    // execute syscall execve(CSEXEC_BIN, exec_args, env)
-    // doc: syscall(2) https://man7.org/linux/man-pages/man2/syscall.2.html
-    // and https://marcin.juszkiewicz.com.pl/download/tables/syscalls.html
-    asm volatile (
-        "mov w8, #221;"             // execve()
-        "mov x0, %0;"               // CSEXEC_BIN
-        "mov x1, %1;"               // exec_args
-        "mov x2, %2;"               // env
-        "svc #0;"                   // aarch64 syscall insn
-        "mov x0, #0x7F;"            // execve() has failed, handle it as ENOENT
-        "mov w8, #93;"              // exit()
-        "svc #0" :
-        : "r" (CSEXEC_BIN)          // %0
-        , "r" (exec_args)           // %1
-        , "r" (env)                 // %2
-        : "x0", "x1", "x2", "w8",
-        // needed for optimizer to see the contents of exec_args as still alive
-        "memory");
+    // execve() the final target, does not return
+    run_loader(argc, argv);
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020 - 2022 Red Hat, Inc.
+ * Copyright (C) 2020 - 2026 Red Hat, Inc.
  *
  * This file is part of cswrap.
  *
@@ -24,6 +24,101 @@
 #   define CSEXEC_BIN "/usr/bin/csexec"
 #endif
 
+// environment variable to read wrap_cmd from
+#ifndef CSEXEC_WRAP_CMD_ENV_VAR_NAME
+#   define CSEXEC_WRAP_CMD_ENV_VAR_NAME "CSEXEC_WRAP_CMD"
+#endif
+
+// executable of the dynamic linker (used as ELF interpreter)
+#ifndef LD_LINUX_SO
+#   define LD_LINUX_SO "/lib64/ld-linux-x86-64.so.2"
+#endif
+
+#ifndef LIBCSEXEC_PRELOAD_SO
+#   define LIBCSEXEC_PRELOAD_SO "libcsexec-preload.so"
+#endif
+
+// set to 1 if dynamic linker supports the --preload option
+#ifndef LD_LINUX_SO_TAKES_PRELOAD
+#   define LD_LINUX_SO_TAKES_PRELOAD 0
+#endif
+
+// set to 1 if dynamic linker supports the --argv0 option
+#ifndef LD_LINUX_SO_TAKES_ARGV0
+#   define LD_LINUX_SO_TAKES_ARGV0 0
+#endif
+
+// used when PATH is not set, as in glibc's execvp()
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+// constants of the kernel API shared by all supported architectures
+enum {
+    AT_FDCWD    = -100,
+    O_RDONLY    = 0
+};
+
+// the code below cannot use the C run-time libs, so we need our own helpers
+// for the few string operations it does (see loader_syscall() in the
+// architecture-specific part for how we talk to the kernel)
+
+static int str_len(const char *str)
+{
+    int len = 0;
+    while (str[len])
+        ++len;
+
+    return len;
+}
+
+static int str_eq(const char *a, const char *b)
+{
+    while (*a && *a == *b)
+        ++a, ++b;
+
+    return *a == *b;
+}
+
+// return pointer behind prefix if str starts with prefix, NULL otherwise
+static const char* skip_prefix(const char *str, const char *prefix)
+{
+    while (*prefix)
+        if (*str++ != *prefix++)
+            return NULL;
+
+    return str;
+}
+
+// copy src to dst including the trailing NUL, return pointer to the NUL
+static char* str_copy(char *dst, const char *src)
+{
+    while ((*dst = *src++))
+        ++dst;
+
+    return dst;
+}
+
+static const char* base_name(const char *path)
+{
+    const char *base = path;
+    for (; *path; ++path)
+        if (*path == '/')
+            base = path + 1;
+
+    return base;
+}
+
+// return value of the given environment variable, or NULL if not set
+static const char* find_env(const char **env, const char *name)
+{
+    for (; *env; ++env) {
+        const char *val = skip_prefix(*env, name);
+        if (val && *val == '=')
+            return val + 1;
+    }
+
+    return NULL;
+}
+
 // query real path of the executable
 static const char* dig_execfn(const char **argv, const char **env_ptr)
 {
@@ -65,16 +160,77 @@ static const char* dig_execfn(const char **argv, const char **env_ptr)
     }
 }
 
+// return true if csexec needs to handle the execution by itself
+static int need_csexec(const char *execfn)
+{
+    // csexec-loader invoked directly, or csexec given its own options
+    const char *base = base_name(execfn);
+    if (str_eq(base, "csexec-loader") || str_eq(base, "csexec"))
+        return 1;
+
+    // a script with an instrumented interpreter in its shebang line,
+    // csexec needs to find the path of the interpreter (see its
+    // handle_shebang_exec()), which is beyond what we can easily do here
+    const long fd = loader_syscall(SYS_openat, AT_FDCWD, (long) execfn,
+                                   O_RDONLY);
+    if (fd < 0)
+        // execfn not readable
+        return 0;
 
-// fill exec_args for csexec
-static void prepare_exec_args(const char **exec_args,
-                              const char **argv,
-                              const char **env_ptr)
+    char buf[2];
+    const long len = loader_syscall(SYS_read, fd, (long) buf, sizeof buf);
+    loader_syscall(SYS_close, fd, 0, 0);
+    return len == sizeof buf && buf[0] == '#' && buf[1] == '!';
+}
+
+// count BEL-separated arguments in wrap_cmd (including the command name)
+static int count_wrap_argc(const char *wrap_cmd)
 {
-    int idx_dst = 0;
+    if (!wrap_cmd || !wrap_cmd[0])
+        // wrap_cmd unset or empty
+        return 0;
 
-    // query real path of the executable
-    exec_args[idx_dst++] = dig_execfn(argv, env_ptr);
+    int wrap_argc = 1;
+    for (; *wrap_cmd; ++wrap_cmd)
+        if (*wrap_cmd == '\a')
+            ++wrap_argc;
+
+    return wrap_argc;
+}
+
+// split a copy of wrap_cmd in buf into exec_args[], return count of args
+static int read_wrap_cmd(const char **exec_args, char *buf,
+                         const char *wrap_cmd)
+{
+    if (!wrap_cmd || !wrap_cmd[0])
+        // wrap_cmd unset or empty
+        return 0;
+
+    int idx = 0;
+    exec_args[idx++] = buf;
+    for (; *wrap_cmd; ++wrap_cmd, ++buf) {
+        if (*wrap_cmd == '\a') {
+            // BEL separator --> NUL terminator + start of the next arg
+            *buf = '\0';
+            exec_args[idx++] = buf + 1;
+        }
+        else {
+            *buf = *wrap_cmd;
+        }
+    }
+
+    *buf = '\0';
+    return idx;
+}
+
+// let csexec do the job: execve(CSEXEC_BIN, [EXECFN, ARG0, ...], env)
+static void exec_csexec(const char **exec_args,
+                        const char *execfn,
+                        const char **argv,
+                        const char **env)
+{
+    int idx_dst = 0;
+    exec_args[idx_dst++] = execfn;
 
     // shallow copy of argv[] at the end of exec_args[]
     int idx_src = 0;
@@ -83,4 +239,146 @@ static void prepare_exec_args(const char **exec_args,
 
     // terminate exec_args[]
     exec_args[idx_dst] = NULL;
+
+    loader_syscall(SYS_execve, (long) CSEXEC_BIN, (long) exec_args,
+                   (long) env);
+
+    // execve() has failed, handle it as ENOENT
+    loader_syscall(SYS_exit, 0x7F, 0, 0);
+}
+
+// execve() file, look it up in PATH if it does not contain a slash
+// (as execvp() does), return only on failure
+static void exec_file_in_path(const char *file,
+                              const char **exec_args,
+                              const char **env)
+{
+    const char *p;
+    for (p = file; *p; ++p) {
+        if (*p == '/') {
+            loader_syscall(SYS_execve, (long) file, (long) exec_args,
+                           (long) env);
+            return;
+        }
+    }
+
+    const char *path = find_env(env, "PATH");
+    if (!path)
+        path = DEFAULT_PATH;
+
+    char buf[str_len(path) + /* '/' */ 1 + str_len(file) + /* NUL */ 1];
+    for (;;) {
+        // an empty element of PATH stands for the current directory
+        char *dst = buf;
+        for (; *path && *path != ':'; ++path)
+            *dst++ = *path;
+        if (dst != buf)
+            *dst++ = '/';
+        str_copy(dst, file);
+
+        loader_syscall(SYS_execve, (long) buf, (long) exec_args, (long) env);
+
+        if (!*path++)
+            // PATH exhausted
+            return;
+    }
+}
+
+// execute the binary via LD_LINUX_SO (or CSEXEC_WRAP_CMD) as csexec would,
+// without executing csexec itself
+static void run_loader(const int argc, const char **argv)
+{
+    // pointer to a NULL-terminated list of environment variables
+    const char **env = argv + argc + 1;
+
+    // query real path of the executable
+    const char *execfn = dig_execfn(argv, env);
+
+    // compute the size of exec_args[] as csexec does, it is enough for
+    // exec_csexec() to use exec_args[] as well
+    const char *wrap_cmd = find_env(env, CSEXEC_WRAP_CMD_ENV_VAR_NAME);
+    const int wrap_argc = count_wrap_argc(wrap_cmd);
+    const int exec_args_size = wrap_argc + (/* LD_LINUX_SO */ 1 + 2 + 2)
+        + /* EXECFN */ 1 + argc + /* term */ 1;
+
+    // allocate exec_args[] on stack
+    const char *exec_args[exec_args_size];
+
+    // we require at least ARG0, csexec reports the error otherwise
+    if (argc < 1 || need_csexec(execfn))
+        exec_csexec(exec_args, execfn, argv, env);
+
+    // split a copy of wrap_cmd into exec_args[], env must stay untouched
+    char wrap_buf[(wrap_cmd) ? str_len(wrap_cmd) + 1 : 1];
+    int idx_dst = read_wrap_cmd(exec_args, wrap_buf, wrap_cmd);
+    int exec_args_offset = 0;
+
+    // environment passed to the executed file
+    const char **exec_env = env;
+
+    // if ${CSEXEC_WRAP_CMD} starts with "--skip-ld-linux\a",
+    // skip LD_LINUX_SO and directly run the command that follows
+    const int skip_ld_linux = 1 < wrap_argc
+        && str_eq("--skip-ld-linux", exec_args[0]);
+
+    // count of environment variables, and CSEXEC_ARGV0=ARG0 for the above
+    int env_cnt = 0;
+    if (skip_ld_linux)
+        while (env[env_cnt])
+            ++env_cnt;
+
+    static const char argv0_name[] = "CSEXEC_ARGV0=";
+    char argv0_var[(skip_ld_linux)
+        ? sizeof argv0_name + str_len(argv[0]) : 1];
+    const char *argv0_env[env_cnt + /* CSEXEC_ARGV0 */ 1 + /* term */ 1];
+
+    // file to execute
+    const char *exec_file;
+
+    if (skip_ld_linux) {
+        exec_file = exec_args[/* real wrap_cmd */ 1];
+        exec_args[++exec_args_offset] = argv[/* ARG0 */ 0];
+
+        // shebang-executed shell scripts cannot easily access the real argv[0]
+        str_copy(str_copy(argv0_var, argv0_name), argv[/* ARG0 */ 0]);
+        int idx_env = 0;
+        int idx_src;
+        for (idx_src = 0; idx_src < env_cnt; ++idx_src)
+            if (!skip_prefix(env[idx_src], argv0_name))
+                argv0_env[idx_env++] = env[idx_src];
+        argv0_env[idx_env++] = argv0_var;
+        argv0_env[idx_env] = NULL;
+        exec_env = argv0_env;
+    }
+    else {
+        // explicitly invoke dynamic linker
+        exec_args[idx_dst++] = LD_LINUX_SO;
+#if LD_LINUX_SO_TAKES_PRELOAD
+        exec_args[idx_dst++] = "--preload";
+        exec_args[idx_dst++] = LIBCSEXEC_PRELOAD_SO;
+#endif
+#if LD_LINUX_SO_TAKES_ARGV0
+        exec_args[idx_dst++] = "--argv0";
+        exec_args[idx_dst++] = argv[/* ARG0 */ 0];
+#endif
+        // path to execute (either wrap_cmd or LD_LINUX_SO)
+        exec_file = exec_args[0];
+    }
+
+    // path to the original binary
+    exec_args[idx_dst++] = execfn;
+
+    // shallow copy of other command-line arguments
+    int idx_src = 1;
+    while (idx_src < argc)
+        exec_args[idx_dst++] = argv[idx_src++];
+
+    // terminate exec_args[]
+    exec_args[idx_dst] = NULL;
+
+    // execute exec_file passing it (exec_args[] + exec_args_offset) as argv[]
+    exec_file_in_path(exec_file, exec_args + exec_args_offset, exec_env);
+
+    // execution failed, csexec will retry and report the error properly
+    exec_csexec(exec_args, execfn, argv, env);
 }
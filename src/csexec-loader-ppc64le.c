@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2022 Red Hat, Inc.
+ * Copyright (C) 2022 - 2026 Red Hat, Inc.
  *
  * This file is part of cswrap.
  *
@@ -17,6 +17,38 @@
  * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+// numbers of the system calls we need
+enum {
+    SYS_openat  = 286,
+    SYS_read    = 3,
+    SYS_close   = 6,
+    SYS_execve  = 11,
+    SYS_exit    = 1
+};
+
+// execute the given system call, return negative errno on failure
+// doc:
+//   * Power Architecture 64-Bit ELF V2 ABI Specification 2.2
+//   * syscall(2) https://man7.org/linux/man-pages/man2/syscall.2.html
+//   * https://marcin.juszkiewicz.com.pl/download/tables/syscalls.html
+static long loader_syscall(long nr, long arg1, long arg2, long arg3)
+{
+    register long r0 asm("r0") = nr;
+    register long r3 asm("r3") = arg1;
+    register long r4 asm("r4") = arg2;
+    register long r5 asm("r5") = arg3;
+    asm volatile (
+        "sc;"                       // ppc64 syscall insn
+        "bns+ 1f;"                  // summary overflow bit set on error
+        "neg %1, %1;"               // return -errno as other archs do
+        "1:"
+        : "+r" (r0), "+r" (r3), "+r" (r4), "+r" (r5)
+        :
+        : "memory", "cr0", "r6", "r7", "r8", "r9", "r10", "r11", "r12",
+          "ctr", "xer");
+    return r3;
+}
+
 #include "csexec-loader-common.c"
 
 // we do not start from main() to stay glibc-independent
@@ -40,33 +72,6 @@ void _start(void)
         , "=r" (argv)               // %1
         ::);
 
-    // pointer to a NULL-terminated list of environment variables
-    const char **env = argc + argv + 1;
-
-    // allocate exec_args[] on stack
-    const char *exec_args[/* execfn */ 1 + argc + /* term */ 1];
-
-    // fill exec_args[]
-    prepare_exec_args(exec_args, argv, env);
-
-    // execute syscall execve(CSEXEC_BIN, exec_args, env)
-    // doc:
-    //   * Power Architecture 64-Bit ELF V2 ABI Specification 2.2
-    //   * syscall(2) https://man7.org/linux/man-pages/man2/syscall.2.html
-    //   * https://marcin.juszkiewicz.com.pl/download/tables/syscalls.html
-    asm volatile (
-        "li %%r0, 11;"              // execve()
-        "mr %%r3, %0;"              // CSEXEC_BIN
-        "mr %%r4, %1;"              // exec_args
-        "mr %%r5, %2;"              // env
-        "sc;"                       // ppc64 syscall insn
-        "li %%r3, 0x7F;"            // execve() has failed, handle it as ENOENT
-        "li %%r0, 1;"               // exit()
-        "sc" :
-        : "r" (CSEXEC_BIN)          // %0
-        , "r" (exec_args)           // %1
-        , "r" (env)                 // %2
-        : "r0", "r3", "r4", "r5",
-        // needed for optimizer to see the contents of exec_args as still alive
-        "memory");
+    // execve() the final target, does not return
+    run_loader(argc, argv);
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2022 Red Hat, Inc.
+ * Copyright (C) 2022 - 2026 Red Hat, Inc.
  *
  * This file is part of cswrap.
  *
@@ -17,6 +17,36 @@
  * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+// numbers of the system calls we need
+enum {
+    SYS_openat  = 288,
+    SYS_read    = 3,
+    SYS_close   = 6,
+    SYS_execve  = 11,
+    SYS_exit    = 1
+};
+
+// execute the given system call, return negative errno on failure
+// docs:
+//   * ELF Application Binary Interface s390x Supplement Parameter Passing
+//   * syscall(2) https://man7.org/linux/man-pages/man2/syscall.2.html
+//   * https://marcin.juszkiewicz.com.pl/download/tables/syscalls.html
+static long loader_syscall(long nr, long arg1, long arg2, long arg3)
+{
+    register long r1 asm("r1") = nr;
+    register long r2 asm("r2") = arg1;
+    register long r3 asm("r3") = arg2;
+    register long r4 asm("r4") = arg3;
+    asm volatile (
+        "svc 0"                     // s390{,x} syscall insn
+        : "+r" (r2)
+        : "r" (r1)
+        , "r" (r3)
+        , "r" (r4)
+        : "memory");
+    return r2;
+}
+
 #include "csexec-loader-common.c"
 
 // we do not start from main() to stay glibc-independent
@@ -34,33 +64,6 @@ void _start(void)
         , "=r" (argv)               // %1
         ::);
 
-    // pointer to a NULL-terminated list of environment variables
-    const char **env = argc + argv + 1;
-
-    // allocate exec_args[] on stack
-    const char *exec_args[/* execfn */ 1 + argc + /* term */ 1];
-
-    // fill exec_args[]
-    prepare_exec_args(exec_args, argv, env);
-
-    // execute syscall execve(CSEXEC_BIN, exec_args, env)
-    // docs:
-    //   * ELF Application Binary Interface s390x Supplement Parameter Passing
-    //   * syscall(2) https://man7.org/linux/man-pages/man2/syscall.2.html
-    //   * https://marcin.juszkiewicz.com.pl/download/tables/syscalls.html
-    asm volatile (
-        "lgfi %%r1, 11;"            // execve()
-        "lgr %%r2, %0;"             // CSEXEC_BIN
-        "lgr %%r3, %1;"             // exec_args
-        "lgr %%r4, %2;"             // env
-        "svc 0;"                    // s390{,x} syscall insn
-        "lgfi %%r2, 0x7F;"          // execve() has failed, handle it as ENOENT
-        "lgfi %%r1, 1;"             // exit()
-        "svc 0" :
-        : "r" (CSEXEC_BIN)          // %0
-        , "r" (exec_args)           // %1
-        , "r" (env)                 // %2
-        : "r1", "r2", "r3", "r4",
-        // needed for optimizer to see the contents of exec_args as still alive
-        "memory");
+    // execve() the final target, does not return
+    run_loader(argc, argv);
 }
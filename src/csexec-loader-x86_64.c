@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020 - 2022 Red Hat, Inc.
+ * Copyright (C) 2020 - 2026 Red Hat, Inc.
  *
  * This file is part of cswrap.
  *
@@ -17,6 +17,32 @@
  * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+// numbers of the system calls we need
+enum {
+    SYS_openat  = 257,
+    SYS_read    = 0,
+    SYS_close   = 3,
+    SYS_execve  = 59,
+    SYS_exit    = 60
+};
+
+// execute the given system call, return negative errno on failure
+// doc: https://en.wikibooks.org/wiki/X86_Assembly/Interfacing_with_Linux
+// and https://blog.rchapman.org/posts/Linux_System_Call_Table_for_x86_64
+static long loader_syscall(long nr, long arg1, long arg2, long arg3)
+{
+    long rv;
+    asm volatile (
+        "syscall"                   // x86_64 syscall insn
+        : "=a" (rv)
+        : "a" (nr)                  // rax
+        , "D" (arg1)                // rdi
+        , "S" (arg2)                // rsi
+        , "d" (arg3)                // rdx
+        : "rcx", "r11", "memory");
+    return rv;
+}
+
 #include "csexec-loader-common.c"
 
 // we do not start from main() to stay glibc-independent
@@ -32,31 +58,6 @@ void _start(void)
         , "=r" (argv)               // %1
         ::);
 
-    // pointer to a NULL-terminated list of environment variables
-    const char **env = argc + argv + 1;
-
-    // allocate exec_args[] on stack
-    const char *exec_args[/* execfn */ 1 + argc + /* term */ 1];
-
-    // fill exec_args[]
-    prepare_exec_args(exec_args, argv, env);
-
-    // execute syscall execve(CSEXEC_BIN, exec_args, env)
-    // doc: https://en.wikibooks.org/wiki/X86_Assembly/Interfacing_with_Linux
-    // and https://blog.rchapman.org/posts/Linux_System_Call_Table_for_x86_64
-    asm volatile (
-        "mov $59, %%rax;"           // execve()
-        "mov %0, %%rdi;"            // CSEXEC_BIN
-        "mov %1, %%rsi;"            // exec_args
-        "mov %2, %%rdx;"            // env
-        "syscall;"                  // x86_64 syscall insn
-        "mov $0x7F, %%rdi;"         // execve() has failed, handle it as ENOENT
-        "mov $60, %%rax;"           // exit()
-        "syscall" :
-        : "r" (CSEXEC_BIN)          // %0
-        , "r" (exec_args)           // %1
-        , "r" (env)                 // %2
-        : "rax", "rdi", "rsi", "rdx",
-        // needed for optimizer to see the contents of exec_args as still alive
-        "memory");
+    // execve() the final target, does not return
+    run_loader(argc, argv);
 }
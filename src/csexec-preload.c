@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020 Red Hat, Inc.
+ * Copyright (C) 2020 - 2026 Red Hat, Inc.
  *
  * This file is part of cswrap.
  *
@@ -22,11 +22,14 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <error.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/auxv.h>
 #include <unistd.h>
 
 // executable of the dynamic linker (used as ELF interpreter)
@@ -34,42 +37,37 @@
 #   define LD_LINUX_SO "/lib64/ld-linux-x86-64.so.2"
 #endif
 
-// if readlink() or canonicalize_file_name() is called from a multi-threaded
-// program, we need to block other threads until globals are initialized by
-// the thread that triggered the initialization
-pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-// optimization to eliminate unncecessary calls to pthread_mutex_lock()
-static volatile bool init_done;
+// global state is initialized by the first thread that calls any of our
+// wrappers, pthread_once() is a single atomic load once that has happened
+static pthread_once_t init_control = PTHREAD_ONCE_INIT;
 
 // address of the original canonicalize_file_name()
 static char* (*orig_cfn)(const char *path);
-static void init_orig_cfn(void)
-{
-    // resolve the original symbol of canonicalize_file_name()
-    orig_cfn = dlsym(RTLD_NEXT, "canonicalize_file_name");
-    if (orig_cfn)
-        return;
-
-    error(1, 0, "csexec-preload: failed to bind canonicalize_file_name(): %s",
-            dlerror());
-}
 
 // address of the original readlink() we are going to wrap
 static ssize_t (*orig_readlink)(const char *, char *, size_t);
-static void init_orig_readlink(void)
+
+// address of the original readlinkat() we are going to wrap
+static ssize_t (*orig_readlinkat)(int, const char *, char *, size_t);
+
+// address of the original realpath() we are going to wrap
+static char* (*orig_realpath)(const char *, char *);
+
+// resolve the original symbol of the given function
+static void* bind_orig(const char *name)
 {
-    // resolve the original symbol of readlink()
-    orig_readlink = dlsym(RTLD_NEXT, "readlink");
-    if (orig_readlink)
-        return;
+    void *addr = dlsym(RTLD_NEXT, name);
+    if (addr)
+        return addr;
 
-    error(1, 0, "csexec-preload: failed to bind readlink(): %s", dlerror());
+    error(1, 0, "csexec-preload: failed to bind %s(): %s", name, dlerror());
+    return NULL;
 }
 
 // real path of LD_LINUX_SO (which /proc/self/exe points at in case the ELF
 // interpreter is invoked explicitly)
 static char ld_so_real[0x100];
+static size_t ld_so_real_len;
 static void init_ld_so_real(void)
 {
     // resolve real path of LD_LINUX_SO
@@ -81,12 +79,24 @@ static void init_ld_so_real(void)
 
     // store the result to our static buffer and release the heap object
     strcpy(ld_so_real, tmp);
+    ld_so_real_len = strlen(ld_so_real);
     free(tmp);
 }
 
+// "/proc/PID/exe" of this process, refreshed in the child after fork()
+static char self_exe_pid[sizeof "/proc//exe" + 3 * sizeof(pid_t)];
+static void init_self_exe_pid(void)
+{
+    snprintf(self_exe_pid, sizeof self_exe_pid, "/proc/%d/exe", getpid());
+}
+
 // pretended target of /proc/self/exe
 static char real_exe[0x400];
-static void init_real_exe(void)
+static size_t real_exe_len;
+
+// find real_exe in /proc/self/cmdline, needed only if ld.so is too old to
+// update AT_EXECFN in the auxiliary vector when it is invoked explicitly
+static void read_real_exe_from_cmdline(void)
 {
     // open /proc/self/cmdline for reading
     const char *cmd_line_fn = "/proc/self/cmdline";
@@ -144,46 +154,97 @@ static void init_real_exe(void)
     fclose(cmd_line);
 }
 
-// initialize global variables on first call
-static void init_once(void) {
-    if (init_done)
-        // already initialized
-        return;
-
-    int rv = pthread_mutex_lock(&init_mutex);
-    if (rv != 0)
-        error(1, rv, "csexec-prealod: failed to lock init mutex");
+static void init_real_exe(void)
+{
+    // csexec passes the real executable to ld.so, which stores it as
+    // AT_EXECFN to the auxiliary vector of the program (glibc 2.33+)
+    const char *execfn = (const char *) getauxval(AT_EXECFN);
+    if (execfn && strcmp(LD_LINUX_SO, execfn) && strcmp(ld_so_real, execfn)
+            && strlen(execfn) < sizeof real_exe)
+        strcpy(real_exe, execfn);
+    else
+        read_real_exe_from_cmdline();
+
+    // the path may be relative to the initial working directory, resolve it
+    // now as /proc/self/exe would do
+    char *tmp = (real_exe[0]) ? orig_realpath(real_exe, NULL) : NULL;
+    if (tmp && strlen(tmp) < sizeof real_exe)
+        strcpy(real_exe, tmp);
+    free(tmp);
 
-    if (!init_done) {
-        // first call -> initialize global state
-        init_orig_cfn();
-        init_orig_readlink();
-        init_ld_so_real();
-        init_real_exe();
+    real_exe_len = strlen(real_exe);
+}
 
-        // no need to call pthread_mutex_lock() from now on
-        init_done = true;
-    }
+// initialize global variables on first call
+static void init_globals(void)
+{
+    orig_cfn = bind_orig("canonicalize_file_name");
+    orig_readlink = bind_orig("readlink");
+    orig_readlinkat = bind_orig("readlinkat");
+    orig_realpath = bind_orig("realpath");
+    init_ld_so_real();
+    init_real_exe();
+
+    // the cached PID would be stale in the child process after fork()
+    init_self_exe_pid();
+    const int rv = pthread_atfork(NULL, NULL, init_self_exe_pid);
+    if (rv != 0)
+        error(1, rv, "csexec-preload: failed to register atfork handler");
+}
 
-    rv = pthread_mutex_unlock(&init_mutex);
+static void init_once(void)
+{
+    const int rv = pthread_once(&init_control, init_globals);
     if (rv != 0)
-        error(1, rv, "csexec-prealod: failed to unlock init mutex");
+        error(1, rv, "csexec-preload: failed to initialize");
+}
+
+// initialize global variables before the program can call chdir()
+__attribute__((constructor))
+static void init_on_load(void)
+{
+    init_once();
 }
 
 // return true if path is effectively /proc/self/exe
 static bool is_self_exe(const char *path)
 {
-    if (!strcmp("/proc/self/exe", path))
-        return true;
+    return !strcmp("/proc/self/exe", path) || !strcmp(self_exe_pid, path);
+}
+
+// return true if the NUL-terminated path resolved by the original function
+// is LD_LINUX_SO and needs to be replaced by real_exe
+static bool is_ld_so(const char *path, const char *resolved)
+{
+    return !strcmp(ld_so_real, resolved) && is_self_exe(path);
+}
+
+// return true if the result of the original readlink() (which is not
+// NUL-terminated and may be truncated to bufsiz) needs to be replaced
+static bool is_ld_so_link(const char *path, const char *buf, ssize_t len,
+                          size_t bufsiz)
+{
+    if (len < 0 || ld_so_real_len < (size_t) len)
+        // either failed or unrelated call to readlink()
+        return false;
 
-    char *str;
-    if (-1 == asprintf(&str, "/proc/%d/exe", getpid()))
-        // OOM
+    if ((size_t) len != ld_so_real_len && (size_t) len != bufsiz)
+        // neither complete nor truncated path of LD_LINUX_SO
         return false;
 
-    const bool matched = !strcmp(str, path);
-    free(str);
-    return matched;
+    return !memcmp(ld_so_real, buf, len) && is_self_exe(path);
+}
+
+// copy the pretended value into the specified buffer and return its length,
+// clear the rest of the path written there by the original function
+static ssize_t copy_real_exe(char *buf, size_t bufsiz, size_t orig_len)
+{
+    const size_t len = (real_exe_len < bufsiz) ? real_exe_len : bufsiz;
+    memcpy(buf, real_exe, len);
+    if (len < orig_len)
+        memset(buf + len, 0, orig_len - len);
+
+    return len;
 }
 
 // our wrapper of the original canonicalize_file_name()
@@ -194,19 +255,43 @@ char *canonicalize_file_name(const char *path)
     // call the real canonicalize_file_name() using the code pointer
     char *rv = orig_cfn(path);
 
-    if (!rv || !!strcmp(ld_so_real, rv))
+    if (!rv || !is_ld_so(path, rv))
         // either failed or unrelated call to canonicalize_file_name()
         return rv;
 
-    // check whether path is something we should override
-    if (!is_self_exe(path))
-        return rv;
-
     // free the originally returned value and duplicate the pretended one
     free(rv);
     return strdup(real_exe);
 }
 
+// our wrapper of the original realpath()
+char *realpath(const char *path, char *resolved)
+{
+    init_once();
+
+    // call the real realpath() using the code pointer
+    char *rv = orig_realpath(path, resolved);
+
+    if (!rv || !is_ld_so(path, rv))
+        // either failed or unrelated call to realpath()
+        return rv;
+
+    if (!resolved) {
+        // free the originally returned value and duplicate the pretended one
+        free(rv);
+        return strdup(real_exe);
+    }
+
+    // the caller-provided buffer is PATH_MAX bytes long
+    if (PATH_MAX <= real_exe_len) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    memcpy(resolved, real_exe, real_exe_len + 1U);
+    return resolved;
+}
+
 // our wrapper of the original readlink()
 ssize_t readlink(const char *path, char *buf, size_t bufsiz)
 {
@@ -215,15 +300,24 @@ ssize_t readlink(const char *path, char *buf, size_t bufsiz)
     // call the real readlink() using the code pointer
     const ssize_t rv = orig_readlink(path, buf, bufsiz);
 
-    if (rv < 0 || !!strncmp(ld_so_real, buf, rv))
-        // either failed or unrelated call to readlink()
+    if (!is_ld_so_link(path, buf, rv, bufsiz))
         return rv;
 
-    // check whether path is something we should override
-    if (!is_self_exe(path))
+    return copy_real_exe(buf, bufsiz, rv);
+}
+
+// our wrapper of the original readlinkat()
+ssize_t readlinkat(int dirfd, const char *path, char *buf, size_t bufsiz)
+{
+    init_once();
+
+    // call the real readlinkat() using the code pointer
+    const ssize_t rv = orig_readlinkat(dirfd, path, buf, bufsiz);
+
+    // a relative path is only comparable with ours if relative to CWD
+    if ((path[0] != '/' && dirfd != AT_FDCWD)
+            || !is_ld_so_link(path, buf, rv, bufsiz))
         return rv;
 
-    // copy the pretended value into the specified buffer and return its length
-    strncpy(buf, real_exe, bufsiz);
-    return strnlen(buf, bufsiz);
+    return copy_real_exe(buf, bufsiz, rv);
 }
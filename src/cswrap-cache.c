@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-cache.h"
+#include "cswrap-ppcache.h"
+#include "cswrap-util.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>               /* for flock() */
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* bump this whenever the key computation or the entry format changes */
+static const char cache_magic[] = "cswrap-cache-1";
+
+/* the cache is pruned down to this percentage of its limit */
+#define CACHE_PRUNE_PCT 90ULL
+
+/* entry being recorded */
+static FILE *store_fp;
+static char *store_tmp_name;
+static char *store_name;
+static const char *store_dir;
+
+/* hash output of the preprocessor run on the input files */
+static bool hash_preprocessed(uint64_t *phash, const char *exec_path,
+                              char **argv)
+{
+    int pipefd[2];
+    if (-1 == pipe(pipefd))
+        return false;
+
+    const pid_t pid = spawn_preprocessor(exec_path, argv, pipefd[/* wr */ 1],
+                                         /* discard */ -1);
+    close(pipefd[/* wr */ 1]);
+    if (pid < 0) {
+        close(pipefd[/* rd */ 0]);
+        return false;
+    }
+
+    /* hash the preprocessed translation unit */
+    char buf[0x10000];
+    for (;;) {
+        const ssize_t len = read(pipefd[/* rd */ 0], buf, sizeof buf);
+        if (0 < len)
+            *phash = hash_bytes(*phash, buf, len);
+        else if (!len || EINTR != errno)
+            break;
+    }
+    close(pipefd[/* rd */ 0]);
+
+    return wait_for_preprocessor(pid);
+}
+
+/* return true if arg looks like name of a preprocessed C/C++ file */
+static bool is_preprocessed_file(const char *arg)
+{
+    const char *suffix = strrchr(arg, '.');
+    return suffix && (STREQ(suffix, ".i") || STREQ(suffix, ".ii"));
+}
+
+/* hash contents of the named file */
+static bool hash_file(uint64_t *phash, const char *name)
+{
+    const int fd = open(name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    char buf[0x10000];
+    ssize_t len;
+    while (0 < (len = read(fd, buf, sizeof buf)))
+        *phash = hash_bytes(*phash, buf, len);
+
+    close(fd);
+    return !len;
+}
+
+bool cache_compute_key(uint64_t *pkey, const char *exec_path, char **argv,
+                       const bool preprocess)
+{
+    uint64_t hash = hash_bytes(HASH_INIT, cache_magic, sizeof cache_magic);
+
+    /* identity of the tool binary */
+    struct stat st;
+    if (stat(exec_path, &st))
+        return false;
+
+    const unsigned long long id[] = {
+        st.st_dev, st.st_ino, st.st_size, st.st_mtime
+    };
+    hash = hash_bytes(hash, id, sizeof id);
+
+    /* relative paths in diagnostics are resolved against cwd */
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof cwd))
+        return false;
+    hash = hash_bytes(hash, cwd, strlen(cwd) + 1U);
+
+    /* effective command line */
+    char **parg;
+    for (parg = argv + 1; *parg; ++parg)
+        hash = hash_bytes(hash, *parg, strlen(*parg) + 1U);
+
+    if (preprocess) {
+        /* contents of the translation unit after preprocessing */
+        if (!hash_preprocessed(&hash, exec_path, argv))
+            return false;
+    }
+    else {
+        /* contents of the input files */
+        for (parg = argv + 1; *parg; ++parg)
+            if ((is_input_file(*parg, /* enable_cxx */ true)
+                        || is_preprocessed_file(*parg))
+                    && !hash_file(&hash, *parg))
+                return false;
+    }
+
+    *pkey = hash;
+    return true;
+}
+
+/* return heap-allocated path of the entry, create its directory if asked */
+static char *entry_name(const char *dir, uint64_t key, bool create)
+{
+    char *sub_dir;
+    if (-1 == asprintf(&sub_dir, "%s/%02x", dir, (unsigned) (key >> 56)))
+        return NULL;
+
+    if (create && mkdir(sub_dir, 0775) && EEXIST != errno) {
+        free(sub_dir);
+        return NULL;
+    }
+
+    char *name;
+    if (-1 == asprintf(&name, "%s/%014llx", sub_dir,
+                (unsigned long long) (key & 0xffffffffffffffULL)))
+        name = NULL;
+
+    free(sub_dir);
+    return name;
+}
+
+struct cache_stats {
+    unsigned long long      hits;
+    unsigned long long      misses;
+    unsigned long long      bytes;
+};
+
+/* open and lock the file with statistics of the cache */
+static int lock_stats(const char *dir, struct cache_stats *stats)
+{
+    memset(stats, 0, sizeof *stats);
+
+    char *name;
+    if (-1 == asprintf(&name, "%s/stats", dir))
+        return -1;
+
+    const int fd = open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+    free(name);
+    if (fd < 0)
+        return -1;
+
+    if (flock(fd, LOCK_EX)) {
+        close(fd);
+        return -1;
+    }
+
+    char buf[0x100];
+    const ssize_t len = read(fd, buf, sizeof buf - 1U);
+    if (0 < len) {
+        buf[len] = '\0';
+        sscanf(buf, "hits %llu misses %llu bytes %llu",
+                &stats->hits, &stats->misses, &stats->bytes);
+    }
+
+    return fd;
+}
+
+/* write the statistics and release the lock */
+static void unlock_stats(int fd, const struct cache_stats *stats)
+{
+    char buf[0x100];
+    const int len = snprintf(buf, sizeof buf, "hits %llu misses %llu "
+            "bytes %llu\n", stats->hits, stats->misses, stats->bytes);
+
+    if (0 < len && !ftruncate(fd, 0)
+            && len != pwrite(fd, buf, len, 0))
+        /* nothing we can do about it */
+        (void) 0;
+
+    close(fd);
+}
+
+/* update hit/miss counters of the cache */
+static void count_lookup(const char *dir, bool hit)
+{
+    struct cache_stats stats;
+    const int fd = lock_stats(dir, &stats);
+    if (fd < 0)
+        return;
+
+    if (hit)
+        ++stats.hits;
+    else
+        ++stats.misses;
+
+    unlock_stats(fd, &stats);
+}
+
+FILE *cache_lookup(const char *dir, uint64_t key, int *pstatus)
+{
+    char *name = entry_name(dir, key, /* create */ false);
+    if (!name)
+        return NULL;
+
+    FILE *fp = fopen(name, "r");
+    if (fp) {
+        /* check the header of the entry */
+        char magic[sizeof cache_magic];
+        if (2 == fscanf(fp, "%14s %d", magic, pstatus)
+                && STREQ(magic, cache_magic) && '\n' == fgetc(fp))
+            /* mark the entry as recently used */
+            utimensat(AT_FDCWD, name, NULL, 0);
+        else {
+            fclose(fp);
+            fp = NULL;
+        }
+    }
+
+    free(name);
+    count_lookup(dir, !!fp);
+    return fp;
+}
+
+/* release resources of the entry being recorded */
+static void store_cleanup(void)
+{
+    if (store_fp) {
+        fclose(store_fp);
+        unlink(store_tmp_name);
+        store_fp = NULL;
+    }
+
+    free(store_tmp_name);
+    free(store_name);
+    store_tmp_name = NULL;
+    store_name = NULL;
+    store_dir = NULL;
+}
+
+bool cache_store_begin(const char *dir, uint64_t key)
+{
+    if (mkdir(dir, 0775) && EEXIST != errno)
+        return false;
+
+    store_name = entry_name(dir, key, /* create */ true);
+    if (!store_name)
+        return false;
+
+    if (-1 == asprintf(&store_tmp_name, "%s.XXXXXX", store_name)) {
+        store_tmp_name = NULL;
+        store_cleanup();
+        return false;
+    }
+
+    const int fd = mkstemp(store_tmp_name);
+    if (fd < 0) {
+        store_cleanup();
+        return false;
+    }
+
+    store_fp = fdopen(fd, "w");
+    if (!store_fp) {
+        close(fd);
+        unlink(store_tmp_name);
+        store_cleanup();
+        return false;
+    }
+
+    /* the exit status is not known yet, it is filled in on commit */
+    store_dir = dir;
+    fprintf(store_fp, "%s %3d\n", cache_magic, 0);
+    return true;
+}
+
+void cache_store_line(const char *line)
+{
+    if (store_fp)
+        fputs(line, store_fp);
+}
+
+void cache_store_abort(void)
+{
+    store_cleanup();
+}
+
+struct cache_entry {
+    char                   *name;
+    time_t                  mtime;
+    unsigned long long      size;
+};
+
+static int cmp_entries_by_mtime(const void *a, const void *b)
+{
+    const struct cache_entry *ea = a;
+    const struct cache_entry *eb = b;
+    return (ea->mtime > eb->mtime) - (ea->mtime < eb->mtime);
+}
+
+/* collect all entries of the cache, return the total size of them [B] */
+static unsigned long long scan_entries(const char *dir,
+                                       struct cache_entry **pentries,
+                                       size_t *pcnt)
+{
+    unsigned long long total = 0ULL;
+    size_t cnt = 0U, alloc = 0U;
+    struct cache_entry *entries = NULL;
+
+    unsigned i;
+    for (i = 0U; i < 0x100U; ++i) {
+        char sub_dir[PATH_MAX];
+        snprintf(sub_dir, sizeof sub_dir, "%s/%02x", dir, i);
+        DIR *d = opendir(sub_dir);
+        if (!d)
+            continue;
+
+        const struct dirent *de;
+        while ((de = readdir(d))) {
+            /* skip ".", ".." and entries being recorded */
+            if (strchr(de->d_name, '.'))
+                continue;
+
+            char *name;
+            if (-1 == asprintf(&name, "%s/%s", sub_dir, de->d_name))
+                continue;
+
+            struct stat st;
+            if (stat(name, &st) || !S_ISREG(st.st_mode)) {
+                free(name);
+                continue;
+            }
+
+            total += st.st_size;
+            if (!pentries) {
+                free(name);
+                ++cnt;
+                continue;
+            }
+
+            if (cnt == alloc) {
+                alloc = (alloc) ? (2U * alloc) : 0x100U;
+                struct cache_entry *tmp = realloc(entries,
+                        alloc * sizeof *entries);
+                if (!tmp) {
+                    free(name);
+                    break;
+                }
+                entries = tmp;
+            }
+
+            entries[cnt].name = name;
+            entries[cnt].mtime = st.st_mtime;
+            entries[cnt].size = st.st_size;
+            ++cnt;
+        }
+
+        closedir(d);
+    }
+
+    if (pentries)
+        *pentries = entries;
+    *pcnt = cnt;
+    return total;
+}
+
+/* remove the least recently used entries until we fit into the limit */
+static unsigned long long evict_entries(const char *dir,
+                                        unsigned long long limit)
+{
+    struct cache_entry *entries;
+    size_t cnt;
+    unsigned long long total = scan_entries(dir, &entries, &cnt);
+    qsort(entries, cnt, sizeof *entries, cmp_entries_by_mtime);
+
+    /* prune a bit more than necessary so that we do not evict on each run */
+    const unsigned long long target = limit / 100ULL * CACHE_PRUNE_PCT;
+    size_t i;
+    for (i = 0U; i < cnt; ++i) {
+        if (target < total && !unlink(entries[i].name))
+            total -= entries[i].size;
+
+        free(entries[i].name);
+    }
+
+    free(entries);
+    return total;
+}
+
+void cache_store_commit(int status, unsigned long long limit)
+{
+    if (!store_fp)
+        return;
+
+    /* fill in the exit status and check that everything has been written */
+    const bool ok = !fseek(store_fp, 0L, SEEK_SET)
+        && 0 < fprintf(store_fp, "%s %3d\n", cache_magic, status)
+        && !fseek(store_fp, 0L, SEEK_END);
+
+    const long size = ftell(store_fp);
+    const int rv = fclose(store_fp);
+    store_fp = NULL;
+    if (!ok || rv || size < 0 || rename(store_tmp_name, store_name)) {
+        unlink(store_tmp_name);
+        store_cleanup();
+        return;
+    }
+
+    struct cache_stats stats;
+    const int fd = lock_stats(store_dir, &stats);
+    if (0 <= fd) {
+        stats.bytes += size;
+        if (limit < stats.bytes)
+            stats.bytes = evict_entries(store_dir, limit);
+
+        unlock_stats(fd, &stats);
+    }
+
+    store_cleanup();
+}
+
+int print_cache_stats(const char *dir, unsigned long long limit)
+{
+    struct cache_stats stats;
+    const int fd = lock_stats(dir, &stats);
+    if (fd < 0) {
+        fprintf(stderr, "cswrap: error: failed to open cache in %s: %s\n",
+                dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* count the entries actually present and resync the size counter */
+    size_t cnt;
+    stats.bytes = scan_entries(dir, NULL, &cnt);
+    unlock_stats(fd, &stats);
+
+    const unsigned long long lookups = stats.hits + stats.misses;
+    const double ratio = (lookups)
+        ? (100.0 * stats.hits / lookups)
+        : 0.0;
+
+    printf("cache directory: %s\n", dir);
+    printf("entries:         %zu\n", cnt);
+    printf("size:            %llu KiB (limit %llu MiB)\n",
+            stats.bytes >> 10, limit >> 20);
+    printf("hits:            %llu\n", stats.hits);
+    printf("misses:          %llu\n", stats.misses);
+    printf("hit ratio:       %.1f%%\n", ratio);
+    return EXIT_SUCCESS;
+}
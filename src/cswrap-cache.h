@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_CACHE_H
+#define CSWRAP_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* default limit on the total size of cache entries [MiB] */
+#define CACHE_SIZE_DEFAULT 1024ULL
+
+/* compute key of the tool invocation, return false if it cannot be cached */
+bool cache_compute_key(uint64_t *pkey, const char *exec_path, char **argv,
+                       bool preprocess);
+
+/* return the cache entry positioned at the first line, NULL on cache miss */
+FILE *cache_lookup(const char *dir, uint64_t key, int *pstatus);
+
+/* start recording output of the tool to be stored in the cache */
+bool cache_store_begin(const char *dir, uint64_t key);
+
+/* record one line of output of the tool */
+void cache_store_line(const char *line);
+
+/* store the recorded output, evict old entries if the limit [B] is exceeded */
+void cache_store_commit(int status, unsigned long long limit);
+
+/* discard the recorded output */
+void cache_store_abort(void);
+
+/* print statistics of the cache in dir to stdout, return exit status */
+int print_cache_stats(const char *dir, unsigned long long limit);
+
+#endif /* CSWRAP_CACHE_H */
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-capmerge.h"
+#include "cswrap-util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* size of stdio buffers of the input and output streams */
+#define MERGE_BUF_SIZE (1UL << 20)
+
+/* one input capture file, with its current diagnostic block */
+struct cap_input {
+    const char         *name;
+    FILE               *fp;
+    pid_t               pid;        /* decompressor, 0 if none */
+    char               *vbuf;
+    char               *line;       /* the line following the block */
+    size_t              line_size;
+    ssize_t             line_len;
+    char               *blk;
+    size_t              blk_len;
+    size_t              blk_alloc;
+    bool                failed;
+};
+
+/* set of hashes of the blocks written so far (open addressing) */
+struct hash_index {
+    uint64_t           *slots;
+    size_t              cnt;
+    size_t              alloc;
+};
+
+static const struct {
+    const char         *magic;
+    size_t              len;
+    const char         *prog;
+} decompressors[] = {
+    { "\x1f\x8b",                   2U, "gzip"  },
+    { "BZh",                        3U, "bzip2" },
+    { "\xfd" "7zXZ\0",              6U, "xz"    },
+    { "\x28\xb5\x2f\xfd",           4U, "zstd"  },
+    { NULL,                         0U, NULL    }
+};
+
+/* return the decompressor the file needs to be read through, NULL if none */
+static const char *detect_decompressor(int fd)
+{
+    char magic[8];
+    const ssize_t len = pread(fd, magic, sizeof magic, 0);
+    int i;
+    for (i = 0; len > 0 && decompressors[i].magic; ++i)
+        if (decompressors[i].len <= (size_t) len
+                && !memcmp(magic, decompressors[i].magic,
+                    decompressors[i].len))
+            return decompressors[i].prog;
+
+    return NULL;
+}
+
+/* open the input, through a decompressor if needed */
+static bool input_open(struct cap_input *in)
+{
+    const int fd = open(in->name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    const char *prog = detect_decompressor(fd);
+    if (!prog) {
+        in->fp = fdopen(fd, "r");
+        if (!in->fp) {
+            close(fd);
+            return false;
+        }
+    }
+    else {
+        int pfd[2];
+        if (pipe2(pfd, O_CLOEXEC)) {
+            close(fd);
+            return false;
+        }
+
+        in->pid = fork();
+        if (!in->pid) {
+            /* child: decompress the file to the pipe */
+            if (0 <= dup2(fd, STDIN_FILENO)
+                    && 0 <= dup2(pfd[1], STDOUT_FILENO))
+                execlp(prog, prog, "-dc", (char *) NULL);
+
+            fprintf(stderr, "cswrap: error: failed to exec %s: %s\n", prog,
+                    strerror(errno));
+            _exit(127);
+        }
+
+        const int err = errno;
+        close(fd);
+        close(pfd[1]);
+        if (in->pid < 0) {
+            close(pfd[0]);
+            errno = err;
+            return false;
+        }
+
+        in->fp = fdopen(pfd[0], "r");
+        if (!in->fp) {
+            close(pfd[0]);
+            return false;
+        }
+    }
+
+    /* large buffers pay off when streaming big files */
+    in->vbuf = malloc(MERGE_BUF_SIZE);
+    if (in->vbuf)
+        setvbuf(in->fp, in->vbuf, _IOFBF, MERGE_BUF_SIZE);
+
+    in->line_len = getline(&in->line, &in->line_size, in->fp);
+    return true;
+}
+
+/* close the input, return false if it could not be read completely */
+static bool input_close(struct cap_input *in)
+{
+    bool ok = !in->failed;
+    if (in->fp) {
+        if (ferror(in->fp))
+            ok = false;
+        fclose(in->fp);
+    }
+
+    int status;
+    if (0 < in->pid && (waitpid(in->pid, &status, 0) != in->pid
+                || !WIFEXITED(status) || WEXITSTATUS(status)))
+        /* the decompressor failed */
+        ok = false;
+
+    free(in->vbuf);
+    free(in->line);
+    free(in->blk);
+    return ok;
+}
+
+/* append the current line to the block */
+static bool block_append(struct cap_input *in)
+{
+    const size_t len = (size_t) in->line_len;
+    if (in->blk_alloc < in->blk_len + len) {
+        size_t alloc = (in->blk_alloc) ? in->blk_alloc : 256U;
+        while (alloc < in->blk_len + len)
+            alloc <<= 1;
+
+        char *blk = realloc(in->blk, alloc);
+        if (!blk)
+            return false;
+
+        in->blk = blk;
+        in->blk_alloc = alloc;
+    }
+
+    memcpy(in->blk + in->blk_len, in->line, len);
+    in->blk_len += len;
+    return true;
+}
+
+/* read the next diagnostic block of the input, return false at EOF */
+static bool input_next_block(struct cap_input *in)
+{
+    in->blk_len = 0U;
+    bool has_primary = false;
+    for (; 0 < in->line_len;
+            in->line_len = getline(&in->line, &in->line_size, in->fp)) {
+        if ('{' == in->line[0]) {
+            /* a record of JSON Lines capture is a block on its own */
+            if (in->blk_len)
+                break;
+
+            if (!block_append(in))
+                goto oom;
+
+            in->line_len = getline(&in->line, &in->line_size, in->fp);
+            break;
+        }
+
+        const enum line_kind kind = classify_line(in->line);
+        if (has_primary && (LK_CONTEXT == kind || LK_PRIMARY == kind))
+            /* the line starts a new diagnostic block */
+            break;
+
+        if (LK_PRIMARY == kind)
+            has_primary = true;
+
+        if (!block_append(in))
+            goto oom;
+    }
+
+    return 0U < in->blk_len;
+
+oom:
+    in->failed = true;
+    in->blk_len = 0U;
+    return false;
+}
+
+/* compare names of two input files for qsort() */
+static int name_cmp(const void *a, const void *b)
+{
+    const struct cap_input *ia = a;
+    const struct cap_input *ib = b;
+    return strcmp(ia->name, ib->name);
+}
+
+/* insert hash into the index, return false if it was already there */
+static bool index_insert(struct hash_index *idx, uint64_t hash)
+{
+    /* zero marks an empty slot */
+    hash |= !hash;
+
+    if (idx->alloc <= 2U * idx->cnt) {
+        /* keep the load factor below 1/2 */
+        const size_t alloc = (idx->alloc) ? (2U * idx->alloc) : 4096U;
+        uint64_t *slots = calloc(alloc, sizeof *slots);
+        if (!slots)
+            /* OOM, duplicates are not dropped anymore */
+            return true;
+
+        size_t i;
+        for (i = 0U; i < idx->alloc; ++i) {
+            const uint64_t h = idx->slots[i];
+            if (!h)
+                continue;
+
+            size_t j = h & (alloc - 1U);
+            while (slots[j])
+                j = (j + 1U) & (alloc - 1U);
+            slots[j] = h;
+        }
+
+        free(idx->slots);
+        idx->slots = slots;
+        idx->alloc = alloc;
+    }
+
+    size_t i = hash & (idx->alloc - 1U);
+    for (; idx->slots[i]; i = (i + 1U) & (idx->alloc - 1U))
+        if (idx->slots[i] == hash)
+            return false;
+
+    idx->slots[i] = hash;
+    ++idx->cnt;
+    return true;
+}
+
+int cap_merge(char **files, bool dedup, FILE *out)
+{
+    size_t cnt = 0U;
+    while (files[cnt])
+        ++cnt;
+
+    struct cap_input *inputs = calloc(cnt, sizeof *inputs);
+    if (cnt && !inputs) {
+        fprintf(stderr, "cswrap: error: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    /* the inputs are taken in the order of their names, so the result does
+     * not depend on the order of arguments */
+    size_t i;
+    for (i = 0U; i < cnt; ++i)
+        inputs[i].name = files[i];
+    qsort(inputs, cnt, sizeof *inputs, name_cmp);
+
+    static char out_buf[MERGE_BUF_SIZE];
+    setvbuf(out, out_buf, _IOFBF, sizeof out_buf);
+
+    /* each input is written as one unbroken run of blocks because blocks of
+     * one invocation are contiguous in the capture file of its build node */
+    int status = EXIT_SUCCESS;
+    struct hash_index idx = { NULL, 0U, 0U };
+    unsigned long n_written = 0UL, n_dropped = 0UL;
+    for (i = 0U; i < cnt; ++i) {
+        struct cap_input *in = &inputs[i];
+        const bool opened = input_open(in);
+        if (!opened) {
+            fprintf(stderr, "cswrap: error: failed to open %s: %s\n",
+                    in->name, strerror(errno));
+            status = EXIT_FAILURE;
+        }
+
+        while (opened && input_next_block(in)) {
+            if (dedup && !index_insert(&idx,
+                        hash_bytes(HASH_INIT, in->blk, in->blk_len)))
+                ++n_dropped;
+            else {
+                fwrite(in->blk, 1U, in->blk_len, out);
+                ++n_written;
+            }
+        }
+
+        if (!input_close(in) && opened) {
+            fprintf(stderr, "cswrap: error: failed to read %s\n", in->name);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    if (fflush(out) || ferror(out)) {
+        fprintf(stderr, "cswrap: error: failed to write output: %s\n",
+                strerror(errno));
+        status = EXIT_FAILURE;
+    }
+
+    if (dedup)
+        fprintf(stderr, "cswrap: note: %lu blocks merged, "
+                "%lu duplicates dropped\n", n_written, n_dropped);
+
+    free(idx.slots);
+    free(inputs);
+    return status;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_CAPMERGE_H
+#define CSWRAP_CAPMERGE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/* merge capture files (plain or compressed by gzip, bzip2, xz, or zstd) into
+ * out by diagnostic blocks, drop blocks already written if dedup is true,
+ * return exit status, nothing may have been written to out yet */
+int cap_merge(char **files, bool dedup, FILE *out);
+
+#endif /* CSWRAP_CAPMERGE_H */
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-caprec.h"
+#include "cswrap-json.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* return heap-allocated copy of str without the trailing new-line */
+static char *dup_line(const char *str, size_t len)
+{
+    if (len && '\n' == str[len - 1U])
+        --len;
+
+    return strndup(str, len);
+}
+
+bool cap_record_add(struct cap_record *rec, const char *tool,
+                    const char *prefix, size_t prefix_len,
+                    const char *path, const char *rest)
+{
+    if (rec->cnt == rec->alloc) {
+        const size_t alloc = (rec->alloc) ? (2U * rec->alloc) : 8U;
+        struct cap_line *lines = realloc(rec->lines, alloc * sizeof *lines);
+        if (!lines)
+            return false;
+
+        rec->lines = lines;
+        rec->alloc = alloc;
+    }
+
+    struct cap_line *line = &rec->lines[rec->cnt];
+    line->prefix = strndup(prefix, prefix_len);
+    line->path = (path) ? strdup(path) : NULL;
+    line->rest = dup_line(rest, strlen(rest));
+    if (!line->prefix || (path && !line->path) || !line->rest) {
+        free(line->prefix);
+        free(line->path);
+        free(line->rest);
+        return false;
+    }
+
+    /* classify the line as it would look like in the text output */
+    char *text;
+    if (-1 == asprintf(&text, "%s%s%s", line->prefix,
+                (path) ? path : "", line->rest))
+        line->kind = LK_PLAIN;
+    else {
+        line->kind = classify_line(text);
+        free(text);
+    }
+
+    rec->tool = tool;
+    ++rec->cnt;
+    return true;
+}
+
+/* write text of the line as a JSON string */
+static void print_line_text(FILE *fp, const struct cap_line *line)
+{
+    char *text;
+    if (-1 == asprintf(&text, "%s%s%s", line->prefix,
+                (line->path) ? line->path : "", line->rest)) {
+        fputs("null", fp);
+        return;
+    }
+
+    json_print_str(fp, text);
+    free(text);
+}
+
+/* write "file", "line", "column", "severity", and "message" of the line */
+static void print_location(FILE *fp, const struct cap_line *line)
+{
+    fputs("\"file\": ", fp);
+    json_print_str(fp, line->path);
+
+    /* ":LINE:COLUMN: SEVERITY: MESSAGE", the numbers are optional */
+    const char *str = line->rest;
+    static const char *const num_keys[] = { "line", "column" };
+    int i;
+    for (i = 0; i < 2 && ':' == str[0] && isdigit((unsigned char) str[1]);
+            ++i) {
+        char *end;
+        const unsigned long num = strtoul(str + 1, &end, 10);
+        fprintf(fp, ", \"%s\": %lu", num_keys[i], num);
+        str = end;
+    }
+
+    if (':' == str[0])
+        ++str;
+    while (' ' == *str)
+        ++str;
+
+    /* the severity ("warning", "fatal error", ...) is terminated by a colon */
+    size_t len = 0U;
+    while (islower((unsigned char) str[len]) || ' ' == str[len])
+        ++len;
+
+    if (len && ':' == str[len] && ' ' != str[len - 1U]) {
+        char *sev = strndup(str, len);
+        if (sev) {
+            fputs(", \"severity\": ", fp);
+            json_print_str(fp, sev);
+            free(sev);
+        }
+
+        str += len + 1U;
+        while (' ' == *str)
+            ++str;
+    }
+
+    fputs(", \"message\": ", fp);
+    json_print_str(fp, str);
+}
+
+/* write the lines in [beg, end) as an array of the given key, translated
+ * notes as locations if notes is true, other lines as strings otherwise */
+static void print_lines(FILE *fp, const struct cap_record *rec,
+                        const char *key, size_t beg, size_t end, bool notes)
+{
+    bool first = true;
+    size_t i;
+    for (i = beg; i < end; ++i) {
+        const struct cap_line *line = &rec->lines[i];
+        const bool is_note = LK_NOTE == line->kind && line->path;
+        if (is_note != notes)
+            continue;
+
+        if (first)
+            fprintf(fp, ", \"%s\": [", key);
+        else
+            fputs(", ", fp);
+        first = false;
+
+        if (notes) {
+            fputc('{', fp);
+            print_location(fp, line);
+            fputc('}', fp);
+        }
+        else
+            print_line_text(fp, line);
+    }
+
+    if (!first)
+        fputc(']', fp);
+}
+
+void cap_record_write_text(FILE *fp, const char *tool, const char *text)
+{
+    char *line = dup_line(text, strlen(text));
+    if (!line)
+        return;
+
+    fputs("{\"tool\": ", fp);
+    json_print_str(fp, tool);
+    fputs(", \"text\": ", fp);
+    json_print_str(fp, line);
+    fputs("}\n", fp);
+    free(line);
+}
+
+/* write text of the line as a record of its own */
+static void write_line_text(FILE *fp, const char *tool,
+                            const struct cap_line *line)
+{
+    char *text;
+    if (-1 == asprintf(&text, "%s%s%s", line->prefix,
+                (line->path) ? line->path : "", line->rest))
+        return;
+
+    cap_record_write_text(fp, tool, text);
+    free(text);
+}
+
+void cap_record_write(FILE *fp, const struct cap_record *rec,
+                      bool primary_only)
+{
+    size_t i;
+    for (i = 0U; i < rec->cnt; ++i)
+        if (LK_PRIMARY == rec->lines[i].kind && rec->lines[i].path)
+            break;
+
+    const size_t prim = i;
+    if (rec->cnt <= prim) {
+        /* no primary line, write each line as a record of its own */
+        for (i = 0U; i < rec->cnt; ++i) {
+            const struct cap_line *line = &rec->lines[i];
+            if (!line->path || line->prefix[0]) {
+                write_line_text(fp, rec->tool, line);
+                continue;
+            }
+
+            fputs("{\"tool\": ", fp);
+            json_print_str(fp, rec->tool);
+            fputs(", ", fp);
+            print_location(fp, line);
+            fputs("}\n", fp);
+        }
+
+        return;
+    }
+
+    /* output preceding the inclusion context is not part of the message */
+    size_t ctx;
+    for (ctx = 0U; ctx < prim && LK_CONTEXT != rec->lines[ctx].kind; ++ctx)
+        if (!primary_only)
+            write_line_text(fp, rec->tool, &rec->lines[ctx]);
+
+    fputs("{\"tool\": ", fp);
+    json_print_str(fp, rec->tool);
+    fputs(", ", fp);
+    print_location(fp, &rec->lines[prim]);
+    if (!primary_only) {
+        /* the inclusion context precedes the primary line */
+        print_lines(fp, rec, "context", ctx, prim, /* notes */ false);
+        print_lines(fp, rec, "notes", prim + 1U, rec->cnt, /* notes */ true);
+        print_lines(fp, rec, "snippet", prim + 1U, rec->cnt, /* notes */ false);
+    }
+
+    fputs("}\n", fp);
+}
+
+void cap_record_clear(struct cap_record *rec)
+{
+    size_t i;
+    for (i = 0U; i < rec->cnt; ++i) {
+        free(rec->lines[i].prefix);
+        free(rec->lines[i].path);
+        free(rec->lines[i].rest);
+    }
+
+    free(rec->lines);
+    memset(rec, 0, sizeof *rec);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_CAPREC_H
+#define CSWRAP_CAPREC_H
+
+#include "cswrap-util.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/* one line of a diagnostic block, split by translate_line() */
+struct cap_line {
+    enum line_kind          kind;
+    char                   *prefix;     /* "In file included from " or "" */
+    char                   *path;       /* absolute path, NULL if none */
+    char                   *rest;       /* ":1:2: warning: ..." or raw line */
+};
+
+/* lines of a diagnostic block to be written as structured records */
+struct cap_record {
+    const char             *tool;
+    struct cap_line        *lines;
+    size_t                  cnt;
+    size_t                  alloc;
+};
+
+/* append a line to the record, path is NULL if the line is not translated,
+ * in which case rest holds the whole line, return false on OOM */
+bool cap_record_add(struct cap_record *rec, const char *tool,
+                    const char *prefix, size_t prefix_len,
+                    const char *path, const char *rest);
+
+/* write the record as JSON Lines (one object per diagnostic) to fp, with the
+ * primary line only if primary_only is true */
+void cap_record_write(FILE *fp, const struct cap_record *rec,
+                      bool primary_only);
+
+/* write one line of text as a record of its own */
+void cap_record_write_text(FILE *fp, const char *tool, const char *text);
+
+/* release lines of the record */
+void cap_record_clear(struct cap_record *rec);
+
+#endif /* CSWRAP_CAPREC_H */
@@ -0,0 +1,635 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-capstore.h"
+#include "cswrap-util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>               /* for flock() */
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* bump this whenever the on-disk layout changes */
+#define STORE_MAGIC 0x63737301U
+
+/* the store consists of the following files in its directory:
+ *
+ *   lock           flock()-ed by writers (exclusively) and readers (shared)
+ *   index          header followed by an open-addressing table of slots
+ *   NNNNNNNN.seg   append-only segments of records, one per put
+ *
+ * A record is superseded by pointing its slot to a newer record.  The space
+ * taken by superseded records is reclaimed by compaction, which copies live
+ * records to a new segment and removes the old ones. */
+
+struct store_header {
+    uint32_t            magic;
+    uint32_t            seg;        /* the segment being appended to */
+    uint64_t            cap;        /* number of slots, a power of two */
+    uint64_t            used;       /* live slots and tombstones */
+    uint64_t            live;       /* live slots */
+    uint64_t            live_bytes;
+    uint64_t            dead_bytes;
+};
+
+/* values of hash with special meaning */
+#define SLOT_EMPTY      0U
+#define SLOT_DELETED    1U
+
+struct store_slot {
+    uint64_t            hash;       /* hash of the key */
+    uint64_t            off;        /* offset of the record in the segment */
+    uint32_t            seg;
+    uint32_t            len;        /* length of the record including header */
+};
+
+struct record_header {
+    uint32_t            magic;
+    uint32_t            key_len;
+    uint64_t            data_len;
+};
+
+/* an open store */
+struct store {
+    const char         *dir;
+    int                 lock_fd;
+    int                 idx_fd;
+    struct store_header hdr;
+};
+
+/* read exactly len bytes at offset off, return false otherwise */
+static bool read_at(int fd, void *buf, size_t len, off_t off)
+{
+    char *ptr = buf;
+    while (len) {
+        const ssize_t rv = pread(fd, ptr, len, off);
+        if (rv < 0 && EINTR == errno)
+            continue;
+        if (rv <= 0)
+            return false;
+
+        ptr += rv;
+        len -= rv;
+        off += rv;
+    }
+
+    return true;
+}
+
+/* write exactly len bytes at offset off, return false otherwise */
+static bool write_at(int fd, const void *buf, size_t len, off_t off)
+{
+    const char *ptr = buf;
+    while (len) {
+        const ssize_t rv = pwrite(fd, ptr, len, off);
+        if (rv < 0 && EINTR == errno)
+            continue;
+        if (rv <= 0)
+            return false;
+
+        ptr += rv;
+        len -= rv;
+        off += rv;
+    }
+
+    return true;
+}
+
+/* open the file of the given name in the store */
+static int open_file(const struct store *st, const char *name, int flags)
+{
+    char *path;
+    if (-1 == asprintf(&path, "%s/%s", st->dir, name))
+        return -1;
+
+    const int fd = open(path, flags | O_CLOEXEC, 0664);
+    free(path);
+    return fd;
+}
+
+/* open the segment of the given number */
+static int open_seg(const struct store *st, uint32_t seg, int flags)
+{
+    char name[sizeof "NNNNNNNN.seg"];
+    snprintf(name, sizeof name, "%08x.seg", (unsigned) seg);
+    return open_file(st, name, flags);
+}
+
+/* remove the segment of the given number */
+static void unlink_seg(const struct store *st, uint32_t seg)
+{
+    char *path;
+    if (-1 == asprintf(&path, "%s/%08x.seg", st->dir, (unsigned) seg))
+        return;
+
+    unlink(path);
+    free(path);
+}
+
+static off_t slot_off(uint64_t i)
+{
+    return (off_t) (sizeof(struct store_header) + i * sizeof(struct store_slot));
+}
+
+/* write an empty index with the given number of slots to a temporary file
+ * and rename it over the index, return the new file descriptor */
+static int create_index(struct store *st, const struct store_header *hdr,
+                        const struct store_slot *slots)
+{
+    char *tmp_name, *name;
+    if (-1 == asprintf(&name, "%s/index", st->dir))
+        return -1;
+    if (-1 == asprintf(&tmp_name, "%s/index.tmp", st->dir)) {
+        free(name);
+        return -1;
+    }
+
+    int fd = open(tmp_name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0664);
+    const size_t size = hdr->cap * sizeof *slots;
+    bool ok = 0 <= fd
+        && !ftruncate(fd, slot_off(hdr->cap))
+        && write_at(fd, hdr, sizeof *hdr, 0)
+        && (!slots || write_at(fd, slots, size, slot_off(0U)))
+        && !rename(tmp_name, name);
+
+    if (!ok && 0 <= fd) {
+        close(fd);
+        unlink(tmp_name);
+        fd = -1;
+    }
+
+    free(tmp_name);
+    free(name);
+    return fd;
+}
+
+/* open and lock the store, create it if it does not exist yet */
+static bool store_open(struct store *st, const char *dir, bool write)
+{
+    memset(st, 0, sizeof *st);
+    st->dir = dir;
+    st->idx_fd = -1;
+    if (write)
+        mkdir(dir, 0775);
+
+    st->lock_fd = open_file(st, "lock", O_RDWR | O_CREAT);
+    if (st->lock_fd < 0 || flock(st->lock_fd, (write) ? LOCK_EX : LOCK_SH))
+        goto fail;
+
+    st->idx_fd = open_file(st, "index", O_RDWR);
+    if (0 <= st->idx_fd) {
+        if (!read_at(st->idx_fd, &st->hdr, sizeof st->hdr, 0)
+                || STORE_MAGIC != st->hdr.magic)
+            /* index created by an incompatible version of cswrap */
+            goto fail;
+
+        return true;
+    }
+
+    if (ENOENT != errno)
+        goto fail;
+
+    /* a new store */
+    st->hdr.magic = STORE_MAGIC;
+    st->hdr.cap = 1024U;
+    if (!write)
+        return true;
+
+    st->idx_fd = create_index(st, &st->hdr, NULL);
+    if (0 <= st->idx_fd)
+        return true;
+
+fail:
+    if (0 <= st->idx_fd)
+        close(st->idx_fd);
+    if (0 <= st->lock_fd)
+        close(st->lock_fd);
+    return false;
+}
+
+/* release the lock */
+static void store_close(struct store *st)
+{
+    if (0 <= st->idx_fd)
+        close(st->idx_fd);
+    close(st->lock_fd);
+}
+
+/* read all slots of the index into a heap-allocated array */
+static struct store_slot *load_slots(const struct store *st)
+{
+    struct store_slot *slots = calloc(st->hdr.cap, sizeof *slots);
+    if (slots && 0 <= st->idx_fd
+            && !read_at(st->idx_fd, slots, st->hdr.cap * sizeof *slots,
+                slot_off(0U))) {
+        free(slots);
+        return NULL;
+    }
+
+    return slots;
+}
+
+/* insert slot into an in-memory table of cap slots (no tombstones there) */
+static void insert_slot(struct store_slot *slots, uint64_t cap,
+                        const struct store_slot *slot)
+{
+    uint64_t i = slot->hash & (cap - 1U);
+    while (SLOT_EMPTY != slots[i].hash)
+        i = (i + 1U) & (cap - 1U);
+
+    slots[i] = *slot;
+}
+
+/* rewrite the index with twice as many slots, dropping tombstones */
+static bool grow_index(struct store *st)
+{
+    struct store_slot *slots = load_slots(st);
+    if (!slots)
+        return false;
+
+    struct store_header hdr = st->hdr;
+    hdr.cap = (st->hdr.live < st->hdr.cap / 4U) ? st->hdr.cap : 2U * hdr.cap;
+    hdr.used = hdr.live;
+    struct store_slot *grown = calloc(hdr.cap, sizeof *grown);
+    if (!grown) {
+        free(slots);
+        return false;
+    }
+
+    uint64_t i;
+    for (i = 0U; i < st->hdr.cap; ++i)
+        if (SLOT_DELETED < slots[i].hash)
+            insert_slot(grown, hdr.cap, &slots[i]);
+
+    const int fd = create_index(st, &hdr, grown);
+    free(grown);
+    free(slots);
+    if (fd < 0)
+        return false;
+
+    close(st->idx_fd);
+    st->idx_fd = fd;
+    st->hdr = hdr;
+    return true;
+}
+
+/* return true if the record of the slot is stored for the given key */
+static bool slot_has_key(const struct store *st, const struct store_slot *slot,
+                         const char *key, bool *perr)
+{
+    const int fd = open_seg(st, slot->seg, O_RDONLY);
+    if (fd < 0) {
+        *perr = true;
+        return false;
+    }
+
+    bool match = false;
+    const size_t key_len = strlen(key);
+    struct record_header rec;
+    bool ok = read_at(fd, &rec, sizeof rec, slot->off);
+    if (ok && key_len == rec.key_len) {
+        char *buf = malloc(key_len + 1U);
+        ok = buf && read_at(fd, buf, key_len, slot->off + sizeof rec);
+        match = ok && !memcmp(buf, key, key_len);
+        free(buf);
+    }
+
+    close(fd);
+    *perr = !ok;
+    return match;
+}
+
+/* find the slot of the given key, or the slot to store it to */
+static bool find_slot(const struct store *st, uint64_t hash, const char *key,
+                      uint64_t *pidx, struct store_slot *slot)
+{
+    uint64_t free_idx = UINT64_MAX;
+    uint64_t i = hash & (st->hdr.cap - 1U);
+    for (;; i = (i + 1U) & (st->hdr.cap - 1U)) {
+        if (!read_at(st->idx_fd, slot, sizeof *slot, slot_off(i)))
+            return false;
+
+        if (hash == slot->hash) {
+            /* the hashes of different keys may collide */
+            bool err;
+            if (slot_has_key(st, slot, key, &err))
+                break;
+            if (err)
+                return false;
+        }
+
+        if (SLOT_DELETED == slot->hash && UINT64_MAX == free_idx)
+            free_idx = i;
+
+        if (SLOT_EMPTY == slot->hash) {
+            /* not found, reuse a tombstone on the way if there is one */
+            if (UINT64_MAX != free_idx)
+                i = free_idx;
+            break;
+        }
+    }
+
+    *pidx = i;
+    return true;
+}
+
+/* copy len bytes from one file to another */
+static bool copy_range(int dst, off_t dst_off, int src, off_t src_off,
+                       size_t len)
+{
+    char buf[0x10000];
+    while (len) {
+        const size_t chunk = (len < sizeof buf) ? len : sizeof buf;
+        if (!read_at(src, buf, chunk, src_off)
+                || !write_at(dst, buf, chunk, dst_off))
+            return false;
+
+        src_off += chunk;
+        dst_off += chunk;
+        len -= chunk;
+    }
+
+    return true;
+}
+
+/* order slots by their position in segments for sequential reads */
+static int slot_pos_cmp(const void *a, const void *b)
+{
+    const struct store_slot *sa = a;
+    const struct store_slot *sb = b;
+    if (sa->seg != sb->seg)
+        return (sa->seg < sb->seg) ? -1 : 1;
+
+    return (sa->off > sb->off) - (sa->off < sb->off);
+}
+
+/* collect live slots sorted by their position, return their count */
+static struct store_slot *live_slots(const struct store *st, uint64_t *pcnt)
+{
+    struct store_slot *slots = load_slots(st);
+    if (!slots)
+        return NULL;
+
+    uint64_t i, cnt = 0U;
+    for (i = 0U; i < st->hdr.cap; ++i)
+        if (SLOT_DELETED < slots[i].hash)
+            slots[cnt++] = slots[i];
+
+    qsort(slots, cnt, sizeof *slots, slot_pos_cmp);
+    *pcnt = cnt;
+    return slots;
+}
+
+/* copy live records to a new segment and remove the old segments */
+static bool compact(struct store *st)
+{
+    uint64_t cnt;
+    struct store_slot *slots = live_slots(st, &cnt);
+    if (!slots)
+        return false;
+
+    const uint32_t old_seg = st->hdr.seg;
+    const uint32_t new_seg = old_seg + 1U;
+    const int dst = open_seg(st, new_seg, O_RDWR | O_CREAT | O_TRUNC);
+    bool ok = 0 <= dst;
+
+    /* records of the same segment are next to each other after sorting */
+    int src = -1;
+    uint32_t src_seg = UINT32_MAX;
+    uint64_t i, off = 0U;
+    for (i = 0U; ok && i < cnt; ++i) {
+        struct store_slot *slot = &slots[i];
+        if (src_seg != slot->seg) {
+            if (0 <= src)
+                close(src);
+            src_seg = slot->seg;
+            src = open_seg(st, src_seg, O_RDONLY);
+        }
+
+        ok = 0 <= src && copy_range(dst, off, src, slot->off, slot->len);
+        slot->seg = new_seg;
+        slot->off = off;
+        off += slot->len;
+    }
+
+    if (0 <= src)
+        close(src);
+
+    struct store_header hdr = st->hdr;
+    hdr.seg = new_seg;
+    hdr.used = hdr.live = cnt;
+    hdr.live_bytes = off;
+    hdr.dead_bytes = 0U;
+    while (hdr.cap / 4U > cnt && 1024U < hdr.cap)
+        /* shrink the table as well */
+        hdr.cap /= 2U;
+
+    struct store_slot *table = NULL;
+    if (ok && !fdatasync(dst))
+        table = calloc(hdr.cap, sizeof *table);
+
+    int fd = -1;
+    if (table) {
+        for (i = 0U; i < cnt; ++i)
+            insert_slot(table, hdr.cap, &slots[i]);
+
+        /* the index is switched to the new segment atomically */
+        fd = create_index(st, &hdr, table);
+        free(table);
+    }
+
+    free(slots);
+    if (0 <= dst)
+        close(dst);
+
+    if (fd < 0) {
+        /* keep the store as it was */
+        unlink_seg(st, new_seg);
+        return false;
+    }
+
+    close(st->idx_fd);
+    st->idx_fd = fd;
+    st->hdr = hdr;
+
+    uint32_t seg;
+    for (seg = 0U; seg <= old_seg; ++seg)
+        unlink_seg(st, seg);
+
+    return true;
+}
+
+bool cap_store_put(const char *dir, const char *key, const char *data,
+                   size_t len)
+{
+    uint64_t hash = hash_bytes(HASH_INIT, key, strlen(key));
+    if (hash <= SLOT_DELETED)
+        hash += 2U;
+
+    struct store st;
+    if (!store_open(&st, dir, /* write */ true))
+        return false;
+
+    if (st.hdr.cap / 2U <= st.hdr.used + 1U && !grow_index(&st))
+        goto fail;
+
+    uint64_t idx;
+    struct store_slot slot;
+    if (!find_slot(&st, hash, key, &idx, &slot))
+        goto fail;
+
+    /* find_slot() stops at a slot of this hash only if it holds the key */
+    const bool found = (hash == slot.hash);
+    if (!found && !len) {
+        /* nothing to store, nothing to supersede */
+        store_close(&st);
+        return true;
+    }
+
+    if (found) {
+        /* the previous record is superseded */
+        st.hdr.dead_bytes += slot.len;
+        st.hdr.live_bytes -= slot.len;
+        --st.hdr.live;
+    }
+    else if (SLOT_EMPTY == slot.hash)
+        ++st.hdr.used;
+
+    if (len) {
+        /* append the record to the current segment */
+        int fd = open_seg(&st, st.hdr.seg, O_RDWR | O_CREAT);
+        struct stat sb;
+        if (0 <= fd && !fstat(fd, &sb)
+                && (uint64_t) sb.st_size >= CAP_STORE_SEG_MAX) {
+            /* start a new segment */
+            close(fd);
+            fd = open_seg(&st, ++st.hdr.seg, O_RDWR | O_CREAT | O_TRUNC);
+            sb.st_size = 0;
+        }
+
+        const size_t key_len = strlen(key);
+        const struct record_header rec = {
+            .magic      = STORE_MAGIC,
+            .key_len    = key_len,
+            .data_len   = len
+        };
+
+        slot.hash = hash;
+        slot.seg = st.hdr.seg;
+        slot.off = sb.st_size;
+        slot.len = sizeof rec + key_len + len;
+        const bool ok = 0 <= fd
+            && write_at(fd, &rec, sizeof rec, slot.off)
+            && write_at(fd, key, key_len, slot.off + sizeof rec)
+            && write_at(fd, data, len, slot.off + sizeof rec + key_len);
+        if (0 <= fd)
+            close(fd);
+        if (!ok)
+            goto fail;
+
+        st.hdr.live_bytes += slot.len;
+        ++st.hdr.live;
+    }
+    else
+        /* no diagnostics anymore */
+        slot.hash = SLOT_DELETED;
+
+    if (!write_at(st.idx_fd, &slot, sizeof slot, slot_off(idx))
+            || !write_at(st.idx_fd, &st.hdr, sizeof st.hdr, 0))
+        goto fail;
+
+    if (CAP_STORE_COMPACT_MIN < st.hdr.dead_bytes
+            && st.hdr.live_bytes < st.hdr.dead_bytes)
+        /* best effort, the store stays consistent if compaction fails */
+        compact(&st);
+
+    store_close(&st);
+    return true;
+
+fail:
+    store_close(&st);
+    return false;
+}
+
+int cap_store_dump(const char *dir, FILE *fp)
+{
+    struct store st;
+    if (!store_open(&st, dir, /* write */ false)) {
+        fprintf(stderr, "cswrap: error: failed to open store in %s: %s\n",
+                dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    uint64_t cnt = 0U;
+    struct store_slot *slots = (0 <= st.idx_fd)
+        ? live_slots(&st, &cnt)
+        : calloc(1U, sizeof *slots);
+
+    bool ok = !!slots;
+    int fd = -1;
+    uint32_t seg = UINT32_MAX;
+    char *buf = NULL;
+    size_t buf_size = 0U;
+    uint64_t i;
+    for (i = 0U; ok && i < cnt; ++i) {
+        const struct store_slot *slot = &slots[i];
+        if (seg != slot->seg) {
+            if (0 <= fd)
+                close(fd);
+            seg = slot->seg;
+            fd = open_seg(&st, seg, O_RDONLY);
+        }
+
+        if (buf_size < slot->len) {
+            free(buf);
+            buf_size = slot->len;
+            buf = malloc(buf_size);
+        }
+
+        struct record_header rec;
+        ok = 0 <= fd && buf && read_at(fd, buf, slot->len, slot->off);
+        if (!ok)
+            break;
+
+        memcpy(&rec, buf, sizeof rec);
+        ok = STORE_MAGIC == rec.magic
+            && sizeof rec + rec.key_len + rec.data_len == slot->len;
+        if (ok)
+            fwrite(buf + sizeof rec + rec.key_len, 1U, rec.data_len, fp);
+    }
+
+    if (0 <= fd)
+        close(fd);
+    free(buf);
+    free(slots);
+    store_close(&st);
+
+    if (!ok) {
+        fprintf(stderr, "cswrap: error: failed to read store in %s\n", dir);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
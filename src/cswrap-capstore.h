@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_CAPSTORE_H
+#define CSWRAP_CAPSTORE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/* segments are not appended to once they reach this size */
+#define CAP_STORE_SEG_MAX (64UL << 20)
+
+/* compact the store once it holds more superseded data than this and more
+ * superseded data than live data */
+#define CAP_STORE_COMPACT_MIN (1UL << 20)
+
+/* replace diagnostics stored in dir for the given key by data, remove them
+ * from the store if len is zero, return false on error */
+bool cap_store_put(const char *dir, const char *key, const char *data,
+                   size_t len);
+
+/* write the current diagnostics in the store to fp, return exit status */
+int cap_store_dump(const char *dir, FILE *fp);
+
+#endif /* CSWRAP_CAPSTORE_H */
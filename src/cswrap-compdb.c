@@ -0,0 +1,664 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-compdb.h"
+#include "cswrap-json.h"
+#include "cswrap-runner.h"
+#include "cswrap-util.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>               /* for flock() */
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* per-process records are prefixed by this */
+static const char rec_prefix[] = "rec-";
+
+/* return the output file of the compiler invocation, NULL if not given */
+static const char *find_output(char **argv)
+{
+    const char *out = NULL;
+    for (; *argv; ++argv) {
+        if (STREQ(*argv, "-o") && argv[1])
+            out = argv[1];
+        else if (MATCH_PREFIX(*argv, "-o") && (*argv)[2])
+            out = *argv + 2;
+    }
+
+    return out;
+}
+
+/* write the arguments of the compiler invocation as a JSON array */
+static void write_args(FILE *fp, const char *compiler, char **argv)
+{
+    fputc('[', fp);
+    json_print_str(fp, compiler);
+
+    char **parg;
+    for (parg = argv + 1; *parg; ++parg) {
+        fputs(", ", fp);
+        json_print_str(fp, *parg);
+    }
+
+    fputc(']', fp);
+}
+
+/* write one entry of the compilation database as a single line */
+static void write_entry(FILE *fp, const char *cwd, const char *compiler,
+                        char **argv, char **orig_argv, const char *file,
+                        const char *out)
+{
+    fputs("{\"directory\": ", fp);
+    json_print_str(fp, cwd);
+    fputs(", \"arguments\": ", fp);
+    write_args(fp, compiler, argv);
+    fputs(", \"original_arguments\": ", fp);
+    write_args(fp, compiler, orig_argv);
+    fputs(", \"file\": ", fp);
+    json_print_str(fp, file);
+    if (out) {
+        fputs(", \"output\": ", fp);
+        json_print_str(fp, out);
+    }
+    fputs("}\n", fp);
+}
+
+bool compdb_record(const char *dir, const char *compiler, char **argv,
+                   char **orig_argv)
+{
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof cwd))
+        return false;
+
+    if (mkdir(dir, 0775) && EEXIST != errno)
+        return false;
+
+    /* write the record into a temporary file */
+    char *tmp_name;
+    if (-1 == asprintf(&tmp_name, "%s/.rec.XXXXXX", dir))
+        return false;
+
+    const int fd = mkstemp(tmp_name);
+    FILE *fp = (0 <= fd) ? fdopen(fd, "w") : NULL;
+    if (!fp) {
+        if (0 <= fd) {
+            close(fd);
+            unlink(tmp_name);
+        }
+        free(tmp_name);
+        return false;
+    }
+
+    const char *out = find_output(argv);
+    char **parg;
+    for (parg = argv + 1; *parg; ++parg)
+        if (is_input_file(*parg, /* enable_cxx */ true))
+            write_entry(fp, cwd, compiler, argv, orig_argv, *parg, out);
+
+    /* publish the record once it is completely written */
+    static unsigned seq;
+    char *name = NULL;
+    const bool ok = !fclose(fp)
+        && -1 != asprintf(&name, "%s/%s%lld-%d-%u.json", dir, rec_prefix,
+                (long long) time(NULL), (int) getpid(), seq++)
+        && !rename(tmp_name, name);
+
+    if (!ok)
+        unlink(tmp_name);
+
+    free(name);
+    free(tmp_name);
+    return ok;
+}
+
+/* entries of the database being merged, vals owns the parsed records */
+struct entry_list {
+    const struct json_value   **items;
+    size_t                      cnt;
+    size_t                      alloc;
+    struct json_value         **vals;
+    size_t                      n_vals;
+    size_t                      vals_alloc;
+};
+
+static void append_entry(struct entry_list *list, const struct json_value *val)
+{
+    if (JT_OBJECT != val->type || !json_get_str(val, "directory")
+            || !json_get_str(val, "file"))
+        /* not an entry of a compilation database */
+        return;
+
+    if (list->cnt == list->alloc) {
+        const size_t alloc = (list->alloc) ? (2U * list->alloc) : 0x100U;
+        const struct json_value **items = realloc(list->items,
+                alloc * sizeof *items);
+        if (!items)
+            return;
+
+        list->items = items;
+        list->alloc = alloc;
+    }
+
+    list->items[list->cnt++] = val;
+}
+
+/* append entries of one record (one JSON object per line) to the list */
+static void load_record(struct entry_list *list, const char *name)
+{
+    size_t size;
+    char *data = read_file(name, &size);
+    if (!data)
+        return;
+
+    char *line, *end;
+    for (line = data; line < data + size; line = end + 1) {
+        end = strchr(line, '\n');
+        if (!end)
+            end = data + size;
+
+        if (list->n_vals == list->vals_alloc) {
+            const size_t alloc = (list->vals_alloc)
+                ? (2U * list->vals_alloc)
+                : 0x100U;
+            struct json_value **vals = realloc(list->vals,
+                    alloc * sizeof *vals);
+            if (!vals)
+                break;
+
+            list->vals = vals;
+            list->vals_alloc = alloc;
+        }
+
+        struct json_value *val = json_parse(line, end - line);
+        if (!val)
+            continue;
+
+        list->vals[list->n_vals++] = val;
+        append_entry(list, val);
+    }
+
+    free(data);
+}
+
+/* position of an entry in the list, sorted to find duplicates */
+struct entry_ref {
+    const struct json_value    *entry;
+    size_t                      idx;
+};
+
+static int cmp_fields(const struct json_value *a, const struct json_value *b)
+{
+    static const char *fields[] = { "directory", "file", "output", NULL };
+
+    const char **pfield;
+    for (pfield = fields; *pfield; ++pfield) {
+        const char *sa = json_get_str(a, *pfield);
+        const char *sb = json_get_str(b, *pfield);
+        const int rv = strcmp((sa) ? sa : "", (sb) ? sb : "");
+        if (rv)
+            return rv;
+    }
+
+    return 0;
+}
+
+static int cmp_entry_refs(const void *a, const void *b)
+{
+    const struct entry_ref *ra = a;
+    const struct entry_ref *rb = b;
+    const int rv = cmp_fields(ra->entry, rb->entry);
+    if (rv)
+        return rv;
+
+    /* the newest entry goes first */
+    return (ra->idx < rb->idx) - (ra->idx > rb->idx);
+}
+
+/* keep only the newest entry for each directory/file/output */
+static void drop_duplicates(struct entry_list *list)
+{
+    struct entry_ref *refs = calloc(list->cnt, sizeof *refs);
+    if (!refs)
+        return;
+
+    size_t i;
+    for (i = 0U; i < list->cnt; ++i) {
+        refs[i].entry = list->items[i];
+        refs[i].idx = i;
+    }
+
+    qsort(refs, list->cnt, sizeof *refs, cmp_entry_refs);
+    for (i = 1U; i < list->cnt; ++i)
+        if (!cmp_fields(refs[i - 1U].entry, refs[i].entry))
+            list->items[refs[i].idx] = NULL;
+
+    free(refs);
+
+    /* preserve the original order of the entries */
+    size_t dst = 0U;
+    for (i = 0U; i < list->cnt; ++i)
+        if (list->items[i])
+            list->items[dst++] = list->items[i];
+
+    list->cnt = dst;
+}
+
+static int is_record_entry(const struct dirent *de)
+{
+    return MATCH_PREFIX(de->d_name, rec_prefix);
+}
+
+/* write the entries to dir/compile_commands.json atomically */
+static bool write_db(const char *dir, const struct entry_list *list)
+{
+    char *name, *tmp_name;
+    if (-1 == asprintf(&name, "%s/%s", dir, COMPDB_NAME))
+        return false;
+    if (-1 == asprintf(&tmp_name, "%s.XXXXXX", name)) {
+        free(name);
+        return false;
+    }
+
+    /* a shallow copy of the entries wrapped in an array */
+    struct json_value arr = {
+        .type   = JT_ARRAY,
+        .cnt    = list->cnt,
+        .items  = malloc((list->cnt + 1U) * sizeof *arr.items)
+    };
+
+    size_t i;
+    for (i = 0U; arr.items && i < list->cnt; ++i)
+        arr.items[i] = *list->items[i];
+
+    const int fd = (arr.items) ? mkstemp(tmp_name) : -1;
+    FILE *fp = (0 <= fd) ? fdopen(fd, "w") : NULL;
+    bool ok = false;
+    if (fp) {
+        json_print_value(fp, &arr, 2);
+        fputc('\n', fp);
+        ok = !fclose(fp) && !rename(tmp_name, name);
+    }
+    else if (0 <= fd)
+        close(fd);
+
+    if (!ok && 0 <= fd)
+        unlink(tmp_name);
+
+    free(arr.items);
+    free(tmp_name);
+    free(name);
+    return ok;
+}
+
+/* load the merged database from dir, NULL if there is none */
+static struct json_value *load_db(const char *dir)
+{
+    char *name;
+    if (-1 == asprintf(&name, "%s/%s", dir, COMPDB_NAME))
+        return NULL;
+
+    size_t size;
+    char *data = read_file(name, &size);
+    free(name);
+    if (!data)
+        return NULL;
+
+    struct json_value *db = json_parse(data, size);
+    free(data);
+    if (db && JT_ARRAY == db->type)
+        return db;
+
+    json_free(db);
+    return NULL;
+}
+
+int compdb_merge(const char *dir)
+{
+    /* serialize concurrent merges */
+    char *lock_name;
+    if (-1 == asprintf(&lock_name, "%s/.merge.lock", dir))
+        return -1;
+
+    const int lock_fd = open(lock_name, O_RDWR | O_CREAT | O_CLOEXEC, 0664);
+    free(lock_name);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX)) {
+        if (0 <= lock_fd)
+            close(lock_fd);
+        return -1;
+    }
+
+    /* start with the entries merged previously */
+    struct entry_list list;
+    memset(&list, 0, sizeof list);
+    struct json_value *db = load_db(dir);
+    size_t i;
+    for (i = 0U; db && i < db->cnt; ++i)
+        append_entry(&list, &db->items[i]);
+
+    /* then append entries of all records, oldest first */
+    struct dirent **names;
+    int n_rec = scandir(dir, &names, is_record_entry, alphasort);
+    char **rec_names = (0 < n_rec) ? calloc(n_rec, sizeof *rec_names) : NULL;
+    int r;
+    for (r = 0; r < n_rec; ++r) {
+        if (rec_names && -1 != asprintf(&rec_names[r], "%s/%s", dir,
+                    names[r]->d_name))
+            load_record(&list, rec_names[r]);
+        else if (rec_names)
+            rec_names[r] = NULL;
+
+        free(names[r]);
+    }
+    if (0 <= n_rec)
+        free(names);
+
+    drop_duplicates(&list);
+    const bool ok = write_db(dir, &list);
+    const int cnt = list.cnt;
+
+    /* the records are merged now */
+    for (r = 0; rec_names && r < n_rec; ++r) {
+        if (ok && rec_names[r])
+            unlink(rec_names[r]);
+        free(rec_names[r]);
+    }
+    free(rec_names);
+
+    for (i = 0U; i < list.n_vals; ++i)
+        json_free(list.vals[i]);
+    free(list.vals);
+    free(list.items);
+    json_free(db);
+    close(lock_fd);
+    return (ok) ? cnt : -1;
+}
+
+/* return the number of args of the original command that must be replaced
+ * so that the replay does not write any output files, set *prepl to the
+ * replacement (NULL to drop them) */
+static int replace_output_args(char **argv, const char **prepl)
+{
+    const char *arg = *argv;
+    *prepl = NULL;
+
+    if (STREQ(arg, "-MD") || STREQ(arg, "-MMD"))
+        return 1;
+
+    if (STREQ(arg, "-MF") || STREQ(arg, "-MT") || STREQ(arg, "-MQ"))
+        return (argv[1]) ? 2 : 1;
+
+    if (MATCH_PREFIX(arg, "-MF") || MATCH_PREFIX(arg, "-MT")
+            || MATCH_PREFIX(arg, "-MQ"))
+        return 1;
+
+    if (STREQ(arg, "-o")) {
+        *prepl = "-o/dev/null";
+        return (argv[1]) ? 2 : 1;
+    }
+
+    if (MATCH_PREFIX(arg, "-o")) {
+        *prepl = "-o/dev/null";
+        return 1;
+    }
+
+    return 0;
+}
+
+/* split a shell command into a heap-allocated vector of heap-allocated args */
+static char **split_command(const char *cmd)
+{
+    char **argv = NULL;
+    size_t argc = 0U;
+    for (;;) {
+        while (*cmd == ' ' || *cmd == '\t' || *cmd == '\n')
+            ++cmd;
+
+        char **tmp = realloc(argv, (argc + 2U) * sizeof *argv);
+        if (!tmp)
+            break;
+        argv = tmp;
+        argv[argc] = NULL;
+        if (!*cmd)
+            return argv;
+
+        /* unquote one argument */
+        char *arg = malloc(strlen(cmd) + 1U);
+        if (!arg)
+            break;
+
+        char *dst = arg;
+        char quote = '\0';
+        for (; *cmd; ++cmd) {
+            const char c = *cmd;
+            if (quote) {
+                if (c == quote)
+                    quote = '\0';
+                else if ('\\' == c && '"' == quote && cmd[1])
+                    *dst++ = *++cmd;
+                else
+                    *dst++ = c;
+            }
+            else if ('\'' == c || '"' == c)
+                quote = c;
+            else if ('\\' == c && cmd[1])
+                *dst++ = *++cmd;
+            else if (' ' == c || '\t' == c || '\n' == c)
+                break;
+            else
+                *dst++ = c;
+        }
+
+        *dst = '\0';
+        argv[argc++] = arg;
+    }
+
+    /* OOM */
+    if (argv) {
+        size_t i;
+        for (i = 0U; i < argc; ++i)
+            free(argv[i]);
+        free(argv);
+    }
+    return NULL;
+}
+
+/* construct heap-allocated argv[] to replay the entry by tool */
+static char **replay_argv(const struct json_value *entry, const char *tool)
+{
+    /* collect the original command, before cswrap has translated its args,
+     * so that the replaying wrapper applies the current flags and rules */
+    char **orig = NULL;
+    const struct json_value *args = json_get(entry, "original_arguments");
+    if (!args || JT_ARRAY != args->type)
+        args = json_get(entry, "arguments");
+    const char *cmd = json_get_str(entry, "command");
+    if (args && JT_ARRAY == args->type) {
+        orig = calloc(args->cnt + 1U, sizeof *orig);
+        size_t i;
+        for (i = 0U; orig && i < args->cnt; ++i) {
+            const char *str = (JT_STRING == args->items[i].type)
+                ? args->items[i].str
+                : "";
+            if (!(orig[i] = strdup(str)))
+                break;
+        }
+    }
+    else if (cmd)
+        orig = split_command(cmd);
+
+    if (!orig || !orig[0])
+        return NULL;
+
+    size_t argc = 0U;
+    while (orig[argc])
+        ++argc;
+
+    /* replace the compiler by tool, redirect output files to /dev/null */
+    char **argv = calloc(argc + 1U, sizeof *argv);
+    if (!argv)
+        return NULL;
+
+    size_t src, dst = 0U;
+    argv[dst++] = strdup(tool);
+    for (src = 1U; src < argc;) {
+        const char *repl;
+        const int cnt = replace_output_args(orig + src, &repl);
+        if (!cnt) {
+            argv[dst++] = orig[src++];
+            continue;
+        }
+
+        if (repl)
+            argv[dst++] = strdup(repl);
+
+        int i;
+        for (i = 0; i < cnt; ++i)
+            free(orig[src++]);
+    }
+
+    free(orig[0]);
+    free(orig);
+    return argv;
+}
+
+static void free_argv(char **argv)
+{
+    char **parg;
+    for (parg = argv; parg && *parg; ++parg)
+        free(*parg);
+    free(argv);
+}
+
+/* return true if the entry runs the same command in the same directory */
+static bool same_command(const struct runner_job *a, const struct runner_job *b)
+{
+    if (!STREQ(a->cwd, b->cwd))
+        return false;
+
+    size_t i;
+    for (i = 0U; a->argv[i] && b->argv[i]; ++i)
+        if (!STREQ(a->argv[i], b->argv[i]))
+            return false;
+
+    return !a->argv[i] && !b->argv[i];
+}
+
+/* hash of the directory and the command, which includes input/output files */
+static uint64_t command_hash(const struct runner_job *job)
+{
+    uint64_t hash = hash_bytes(HASH_INIT, job->cwd, strlen(job->cwd) + 1U);
+
+    char **parg;
+    for (parg = job->argv; *parg; ++parg)
+        hash = hash_bytes(hash, *parg, strlen(*parg) + 1U);
+
+    return hash;
+}
+
+int compdb_replay(const char *dir, const char *tool, unsigned max_jobs)
+{
+    if (compdb_merge(dir) < 0) {
+        fprintf(stderr, "cswrap: error: failed to merge records in %s: %s\n",
+                dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    char *db_name;
+    if (-1 == asprintf(&db_name, "%s/%s", dir, COMPDB_NAME))
+        return EXIT_FAILURE;
+
+    size_t size;
+    char *data = read_file(db_name, &size);
+    struct json_value *db = (data) ? json_parse(data, size) : NULL;
+    free(data);
+    if (!db || JT_ARRAY != db->type) {
+        fprintf(stderr, "cswrap: error: failed to load %s\n", db_name);
+        free(db_name);
+        json_free(db);
+        return EXIT_FAILURE;
+    }
+    free(db_name);
+
+    struct runner_job *jobs = calloc(db->cnt + 1U, sizeof *jobs);
+
+    /* open-addressed set of job indexes (shifted by one, zero marks an empty
+     * slot) with load factor below 1/2, and the hashes of the jobs */
+    size_t alloc = 4U;
+    while (alloc <= 2U * db->cnt)
+        alloc *= 2U;
+    size_t *slots = calloc(alloc, sizeof *slots);
+    uint64_t *hashes = calloc(db->cnt + 1U, sizeof *hashes);
+    if (!jobs || !slots || !hashes) {
+        free(hashes);
+        free(slots);
+        free(jobs);
+        json_free(db);
+        return EXIT_FAILURE;
+    }
+
+    /* one job per command, commands with more input files have more entries */
+    size_t cnt = 0U, i, j;
+    for (i = 0U; i < db->cnt; ++i) {
+        const struct json_value *entry = &db->items[i];
+        jobs[cnt].cwd = json_get_str(entry, "directory");
+        jobs[cnt].argv = replay_argv(entry, tool);
+        if (!jobs[cnt].cwd || !jobs[cnt].argv) {
+            free_argv(jobs[cnt].argv);
+            continue;
+        }
+
+        /* compare the full commands only if the hashes match */
+        hashes[cnt] = command_hash(&jobs[cnt]);
+        const size_t mask = alloc - 1U;
+        for (j = hashes[cnt] & mask; slots[j]; j = (j + 1U) & mask)
+            if (hashes[slots[j] - 1U] == hashes[cnt]
+                    && same_command(&jobs[slots[j] - 1U], &jobs[cnt]))
+                break;
+
+        if (slots[j])
+            free_argv(jobs[cnt].argv);
+        else
+            slots[j] = ++cnt;
+    }
+
+    free(hashes);
+    free(slots);
+
+    /* do not record the replayed invocations again */
+    unsetenv("CSWRAP_COMPDB_DIR");
+
+    struct runner_stats stats = { 0U, 0U };
+    run_jobs(jobs, cnt, max_jobs, NULL, NULL, &stats);
+    printf("%u commands replayed, %u failed\n", stats.total, stats.failed);
+
+    for (i = 0U; i < cnt; ++i)
+        free_argv(jobs[i].argv);
+    free(jobs);
+    json_free(db);
+    return (stats.failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_COMPDB_H
+#define CSWRAP_COMPDB_H
+
+#include <stdbool.h>
+
+/* name of the merged compilation database in the directory of records */
+#define COMPDB_NAME "compile_commands.json"
+
+/* write a record of the compiler invocation (one entry per input file)
+ * into dir, compiler is the path to the real compiler, argv are the args
+ * passed to it and orig_argv the args cswrap was invoked with */
+bool compdb_record(const char *dir, const char *compiler, char **argv,
+                   char **orig_argv);
+
+/* merge all records in dir into dir/compile_commands.json, return the number
+ * of entries in the database, -1 on error */
+int compdb_merge(const char *dir);
+
+/* run tool on all entries of the database in dir with up to max_jobs of them
+ * in parallel, output files of the original invocations are not written,
+ * return EXIT_FAILURE if any of them failed */
+int compdb_replay(const char *dir, const char *tool, unsigned max_jobs);
+
+#endif /* CSWRAP_COMPDB_H */
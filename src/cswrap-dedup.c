@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-dedup.h"
+#include "cswrap-util.h"
+
+#include <errno.h>
+#include <fcntl.h>                  /* for O_* constants */
+#include <stdio.h>                  /* for asprintf() */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* bump this whenever the layout of struct dedup_table changes */
+#define DEDUP_MAGIC 0x63736401U
+
+/* open-addressing hash set, zero marks a free slot */
+struct dedup_table {
+    unsigned            magic;
+    uint64_t            slots[DEDUP_SLOTS];
+};
+
+static struct dedup_table *table;
+
+/* construct name of the shared memory object, NULL if build_id is invalid */
+static char *shm_name(const char *build_id)
+{
+    const size_t len = strlen(build_id);
+    if (!len || 64U < len
+            || len != strspn(build_id, "abcdefghijklmnopqrstuvwxyz"
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789._-"))
+        return NULL;
+
+    char *name;
+    if (-1 == asprintf(&name, "/cswrap_dedup_%s", build_id))
+        return NULL;
+
+    return name;
+}
+
+bool dedup_attach(const char *build_id)
+{
+    char *name = shm_name(build_id);
+    if (!name)
+        return false;
+
+    const int fd = shm_open(name, O_RDWR | O_CREAT, 0660);
+    free(name);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) || (st.st_size < (off_t) sizeof *table
+                && ftruncate(fd, sizeof *table))) {
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(NULL, sizeof *table, PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == addr)
+        return false;
+
+    /* a freshly created table is zero-filled, stamp it */
+    table = addr;
+    unsigned expected = 0U;
+    __atomic_compare_exchange_n(&table->magic, &expected, DEDUP_MAGIC,
+            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+
+    if (DEDUP_MAGIC == __atomic_load_n(&table->magic, __ATOMIC_ACQUIRE))
+        return true;
+
+    /* table created by an incompatible version of cswrap */
+    munmap(table, sizeof *table);
+    table = NULL;
+    return false;
+}
+
+bool dedup_seen(uint64_t hash)
+{
+    if (!table)
+        return false;
+
+    /* zero is reserved for free slots */
+    hash |= 1U;
+
+    unsigned i;
+    for (i = 0U; i < DEDUP_PROBES; ++i) {
+        uint64_t *slot = &table->slots[(hash + i) & (DEDUP_SLOTS - 1U)];
+        uint64_t val = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+        if (!val && __atomic_compare_exchange_n(slot, &val, hash,
+                    false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            /* inserted by us */
+            return false;
+
+        /* the slot is taken, possibly by a concurrent insert of the hash */
+        if (val == hash)
+            return true;
+    }
+
+    /* the neighborhood is full, better to print a duplicate than to lose */
+    return false;
+}
+
+bool dedup_release(const char *build_id)
+{
+    char *name = shm_name(build_id);
+    if (!name) {
+        errno = EINVAL;
+        return false;
+    }
+
+    const int rv = shm_unlink(name);
+    free(name);
+    return !rv || ENOENT == errno;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_DEDUP_H
+#define CSWRAP_DEDUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* number of hashes the set can hold (8 MiB of shared memory) */
+#define DEDUP_SLOTS (1U << 20)
+
+/* number of slots probed before a hash is considered unseen */
+#define DEDUP_PROBES 32U
+
+/* map the set of hashes shared by all wrappers of the build */
+bool dedup_attach(const char *build_id);
+
+/* insert hash into the set, return true if it was already there */
+bool dedup_seen(uint64_t hash);
+
+/* remove the set of hashes of the given build, return false on error */
+bool dedup_release(const char *build_id);
+
+#endif /* CSWRAP_DEDUP_H */
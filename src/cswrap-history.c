@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-history.h"
+#include "cswrap-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* return heap-allocated name of the file storing history of key in dir */
+static char *history_file_name(const char *dir, const char *key)
+{
+    const uint64_t hash = hash_bytes(HASH_INIT, key, strlen(key));
+
+    char *name;
+    if (-1 == asprintf(&name, "%s/%016llx", dir, (unsigned long long) hash))
+        return NULL;
+
+    return name;
+}
+
+/* the file starts with the key on its own line, run times [ms] follow */
+static bool read_history(FILE *fp, const char *key, struct history *hist)
+{
+    char *line = NULL;
+    size_t size = 0U;
+    bool matched = false;
+    hist->cnt = 0U;
+
+    if (0 < getline(&line, &size, fp)) {
+        /* compare the key to detect collisions of the hash */
+        line[strcspn(line, "\n")] = '\0';
+        matched = STREQ(line, key);
+    }
+
+    while (matched && 0 < getline(&line, &size, fp)) {
+        unsigned long ms;
+        if (1 != sscanf(line, "%lu", &ms))
+            continue;
+
+        if (HISTORY_MAX == hist->cnt) {
+            /* keep only the most recent run times */
+            memmove(hist->ms, hist->ms + 1, (HISTORY_MAX - 1U) * sizeof ms);
+            --hist->cnt;
+        }
+
+        hist->ms[hist->cnt++] = ms;
+    }
+
+    free(line);
+    return matched;
+}
+
+bool history_load(const char *dir, const char *key, struct history *hist)
+{
+    hist->cnt = 0U;
+    char *name = history_file_name(dir, key);
+    if (!name)
+        return false;
+
+    FILE *fp = fopen(name, "r");
+    free(name);
+    if (!fp)
+        return false;
+
+    const bool ok = read_history(fp, key, hist);
+    fclose(fp);
+    return ok && hist->cnt;
+}
+
+void history_append(const char *dir, const char *key, unsigned long ms)
+{
+    char *name = history_file_name(dir, key);
+    char *tmp_name;
+    if (!name || -1 == asprintf(&tmp_name, "%s.XXXXXX", name)) {
+        free(name);
+        return;
+    }
+
+    struct history hist;
+    history_load(dir, key, &hist);
+    if (HISTORY_MAX == hist.cnt) {
+        /* drop the oldest run time */
+        memmove(hist.ms, hist.ms + 1, (HISTORY_MAX - 1U) * sizeof ms);
+        --hist.cnt;
+    }
+    hist.ms[hist.cnt++] = ms;
+
+    /* write a temporary file and atomically replace the original one */
+    const int fd = mkstemp(tmp_name);
+    FILE *fp = (0 <= fd) ? fdopen(fd, "w") : NULL;
+    if (fp) {
+        unsigned i;
+        fprintf(fp, "%s\n", key);
+        for (i = 0U; i < hist.cnt; ++i)
+            fprintf(fp, "%lu\n", hist.ms[i]);
+
+        if (!fclose(fp) && !rename(tmp_name, name))
+            goto done;
+    }
+    else if (0 <= fd)
+        close(fd);
+
+    unlink(tmp_name);
+done:
+    free(tmp_name);
+    free(name);
+}
+
+static int cmp_ms(const void *a, const void *b)
+{
+    const unsigned long x = *(const unsigned long *) a;
+    const unsigned long y = *(const unsigned long *) b;
+    return (x > y) - (x < y);
+}
+
+unsigned long history_percentile(const struct history *hist, unsigned pct)
+{
+    if (!hist->cnt)
+        return 0UL;
+
+    unsigned long sorted[HISTORY_MAX];
+    memcpy(sorted, hist->ms, hist->cnt * sizeof *sorted);
+    qsort(sorted, hist->cnt, sizeof *sorted, cmp_ms);
+
+    /* nearest-rank: the smallest value greater or equal to pct % of values */
+    unsigned rank = (pct * hist->cnt + 99U) / 100U;
+    if (!rank)
+        rank = 1U;
+
+    return sorted[rank - 1U];
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_HISTORY_H
+#define CSWRAP_HISTORY_H
+
+#include <stdbool.h>
+
+/* how many most recent run times are kept per key */
+#define HISTORY_MAX 16U
+
+/* run times [ms] of previous runs of a tool on the same input files */
+struct history {
+    unsigned            cnt;
+    unsigned long       ms[HISTORY_MAX];
+};
+
+/* load run times recorded for key in dir, return false if there are none */
+bool history_load(const char *dir, const char *key, struct history *hist);
+
+/* record a new run time for key in dir (best effort) */
+void history_append(const char *dir, const char *key, unsigned long ms);
+
+/* return the given percentile of the run times (nearest-rank method) */
+unsigned long history_percentile(const struct history *hist, unsigned pct);
+
+#endif /* CSWRAP_HISTORY_H */
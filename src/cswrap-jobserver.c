@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-jobserver.h"
+#include "cswrap-util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* we never hold more tokens than this */
+#define MAX_TOKENS 64U
+
+/* our own non-blocking file description of the jobserver pipe/fifo */
+static int js_fd = -1;
+
+/* tokens are returned exactly as they were read */
+static char tokens[MAX_TOKENS];
+static unsigned n_tokens;
+
+/* only the process that acquired the tokens can give them back */
+static pid_t owner;
+
+/* return pointer to the value of the last --jobserver-{auth,fds}= in flags */
+static const char *find_auth(const char *flags)
+{
+    static const char *names[] = {
+        "--jobserver-auth=",
+        "--jobserver-fds=",
+        NULL
+    };
+
+    const char *found = NULL;
+    const char **pname;
+    for (pname = names; *pname; ++pname) {
+        const size_t len = strlen(*pname);
+        const char *str;
+        for (str = flags; (str = strstr(str, *pname)); str += len)
+            if (!found || found < str + len)
+                found = str + len;
+    }
+
+    return found;
+}
+
+/* open a pipe given by its read/write ends inherited from make */
+static int open_pipe(int rfd, int wfd)
+{
+    /* make sure the fds really refer to both ends of the same pipe */
+    struct stat rst, wst;
+    if (fstat(rfd, &rst) || fstat(wfd, &wst) || !S_ISFIFO(rst.st_mode)
+            || rst.st_ino != wst.st_ino || rst.st_dev != wst.st_dev)
+        return -1;
+
+    /* obtain a file description of our own so that we can use O_NONBLOCK
+     * without affecting make and other jobs sharing the pipe */
+    char path[sizeof "/proc/self/fd/" + 3 * sizeof(int)];
+    snprintf(path, sizeof path, "/proc/self/fd/%d", rfd);
+    return open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+}
+
+/* open a named pipe given by its path (GNU make 4.4+) */
+static int open_fifo(const char *path)
+{
+    const int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (!fstat(fd, &st) && S_ISFIFO(st.st_mode))
+        return fd;
+
+    close(fd);
+    return -1;
+}
+
+bool jobserver_connect(void)
+{
+    if (0 <= js_fd)
+        /* already connected */
+        return true;
+
+    const char *flags = getenv("MAKEFLAGS");
+    if (!flags)
+        return false;
+
+    const char *auth = find_auth(flags);
+    if (!auth)
+        /* not running under a jobserver */
+        return false;
+
+    /* the value ends by the first white-space */
+    const size_t len = strcspn(auth, " \t");
+    char *value = strndup(auth, len);
+    if (!value)
+        return false;
+
+    int rfd, wfd;
+    char c;
+    if (MATCH_PREFIX(value, "fifo:"))
+        js_fd = open_fifo(value + sizeof "fifo:" - 1U);
+    else if (2 == sscanf(value, "%d,%d%c", &rfd, &wfd, &c))
+        js_fd = open_pipe(rfd, wfd);
+
+    free(value);
+    return 0 <= js_fd;
+}
+
+unsigned jobserver_acquire(unsigned cnt, volatile sig_atomic_t *interrupted)
+{
+    if (!jobserver_connect())
+        return 0U;
+
+    if (MAX_TOKENS - n_tokens < cnt)
+        cnt = MAX_TOKENS - n_tokens;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += JOBSERVER_WAIT_MAX;
+
+    unsigned got = 0U;
+    owner = getpid();
+    while (got < cnt && !*interrupted) {
+        const ssize_t rv = read(js_fd, &tokens[n_tokens], 1U);
+        if (1 == rv) {
+            ++n_tokens;
+            ++got;
+            continue;
+        }
+
+        if (rv < 0 && EINTR == errno)
+            continue;
+
+        if (rv == 0 || EAGAIN != errno)
+            /* the jobserver is gone */
+            break;
+
+        /* no token available, sleep till another job returns one */
+        const int ms = ms_until(&deadline);
+        if (!ms)
+            /* give up so that heavy jobs cannot deadlock each other */
+            break;
+
+        struct pollfd pfd = {
+            .fd = js_fd,
+            .events = POLLIN
+        };
+        poll(&pfd, 1U, ms);
+    }
+
+    return got;
+}
+
+void jobserver_release(void)
+{
+    if (js_fd < 0 || owner != getpid())
+        return;
+
+    while (n_tokens) {
+        const ssize_t rv = write(js_fd, &tokens[n_tokens - 1U], 1U);
+        if (1 == rv)
+            --n_tokens;
+        else if (rv < 0 && EINTR == errno)
+            continue;
+        else
+            /* tokens lost, nothing we can do about it */
+            break;
+    }
+
+    n_tokens = 0U;
+}
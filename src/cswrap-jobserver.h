@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_JOBSERVER_H
+#define CSWRAP_JOBSERVER_H
+
+#include <signal.h>
+#include <stdbool.h>
+
+/* maximal amount of time [s] to wait for job tokens before giving up */
+#define JOBSERVER_WAIT_MAX 60
+
+/* return true if $MAKEFLAGS refers to a jobserver we can talk to */
+bool jobserver_connect(void);
+
+/* acquire up to cnt tokens from the jobserver, return the count acquired */
+unsigned jobserver_acquire(unsigned cnt, volatile sig_atomic_t *interrupted);
+
+/* return all tokens acquired by this process back to the jobserver */
+void jobserver_release(void);
+
+#endif /* CSWRAP_JOBSERVER_H */
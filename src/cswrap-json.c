@@ -0,0 +1,617 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-json.h"
+#include "cswrap-util.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* nesting limit that keeps the recursive descent parser on a safe stack */
+#define JSON_DEPTH_MAX 64
+
+void json_print_str(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (; *str; ++str) {
+        const unsigned char c = *str;
+        if ('"' == c || '\\' == c)
+            fprintf(fp, "\\%c", c);
+        else if ('\n' == c)
+            fputs("\\n", fp);
+        else if ('\t' == c)
+            fputs("\\t", fp);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+/* write val to fp as JSON nested at the given level */
+static void print_value(FILE *fp, const struct json_value *val, int indent,
+                        int level)
+{
+    switch (val->type) {
+        case JT_NULL:
+            fputs("null", fp);
+            return;
+
+        case JT_BOOL:
+        case JT_NUMBER:
+            fputs(val->str, fp);
+            return;
+
+        case JT_STRING:
+            json_print_str(fp, val->str);
+            return;
+
+        case JT_ARRAY:
+        case JT_OBJECT:
+            break;
+    }
+
+    /* objects and arrays of containers are spread over lines, arrays of
+     * scalars (such as argv[]) are kept on a single line */
+    const bool object = (JT_OBJECT == val->type);
+    const bool spread = object || (val->cnt
+            && (JT_ARRAY == val->items[0].type
+                || JT_OBJECT == val->items[0].type));
+    fputc((object) ? '{' : '[', fp);
+
+    size_t i;
+    for (i = 0U; i < val->cnt; ++i) {
+        const struct json_value *item = &val->items[i];
+        if (i)
+            fputc(',', fp);
+
+        if (spread)
+            fprintf(fp, "\n%*s", indent * (level + 1), "");
+        else if (i)
+            fputc(' ', fp);
+
+        if (object) {
+            json_print_str(fp, item->key);
+            fputs(": ", fp);
+        }
+
+        print_value(fp, item, indent, level + 1);
+    }
+
+    if (spread && val->cnt)
+        fprintf(fp, "\n%*s", indent * level, "");
+
+    fputc((object) ? '}' : ']', fp);
+}
+
+void json_print_value(FILE *fp, const struct json_value *val, int indent)
+{
+    print_value(fp, val, indent, 0);
+}
+
+struct json_parser {
+    const char             *cur;
+    const char             *end;
+    int                     depth;
+};
+
+static void skip_ws(struct json_parser *p)
+{
+    while (p->cur < p->end && isspace((unsigned char) *p->cur))
+        ++p->cur;
+}
+
+/* append the UTF-8 encoding of the code point cp to the memstream */
+static void put_utf8(FILE *mem, unsigned cp)
+{
+    if (cp < 0x80U)
+        fputc(cp, mem);
+    else if (cp < 0x800U) {
+        fputc(0xC0U | (cp >> 6), mem);
+        fputc(0x80U | (cp & 0x3FU), mem);
+    }
+    else if (cp < 0x10000U) {
+        fputc(0xE0U | (cp >> 12), mem);
+        fputc(0x80U | ((cp >> 6) & 0x3FU), mem);
+        fputc(0x80U | (cp & 0x3FU), mem);
+    }
+    else {
+        fputc(0xF0U | (cp >> 18), mem);
+        fputc(0x80U | ((cp >> 12) & 0x3FU), mem);
+        fputc(0x80U | ((cp >> 6) & 0x3FU), mem);
+        fputc(0x80U | (cp & 0x3FU), mem);
+    }
+}
+
+/* parse 4 hex digits of a \u escape */
+static bool parse_hex4(struct json_parser *p, unsigned *pcp)
+{
+    if (p->end - p->cur < 4)
+        return false;
+
+    unsigned cp = 0U;
+    int i;
+    for (i = 0; i < 4; ++i) {
+        const unsigned char c = *p->cur++;
+        if (!isxdigit(c))
+            return false;
+        cp = (cp << 4) | (isdigit(c) ? (c - '0') : ((c | 0x20) - 'a' + 10));
+    }
+
+    *pcp = cp;
+    return true;
+}
+
+/* parse a string literal, return heap-allocated unescaped string */
+static char *parse_str(struct json_parser *p)
+{
+    if (p->end <= p->cur || '"' != *p->cur)
+        return NULL;
+    ++p->cur;
+
+    char *str = NULL;
+    size_t size = 0U;
+    FILE *mem = open_memstream(&str, &size);
+    if (!mem)
+        return NULL;
+
+    bool ok = false;
+    while (p->cur < p->end) {
+        const char c = *p->cur++;
+        if ('"' == c) {
+            ok = true;
+            break;
+        }
+
+        if ('\\' != c) {
+            fputc(c, mem);
+            continue;
+        }
+
+        if (p->end <= p->cur)
+            break;
+
+        unsigned cp;
+        switch (*p->cur++) {
+            case '"':   fputc('"', mem);    continue;
+            case '\\':  fputc('\\', mem);   continue;
+            case '/':   fputc('/', mem);    continue;
+            case 'b':   fputc('\b', mem);   continue;
+            case 'f':   fputc('\f', mem);   continue;
+            case 'n':   fputc('\n', mem);   continue;
+            case 'r':   fputc('\r', mem);   continue;
+            case 't':   fputc('\t', mem);   continue;
+            case 'u':
+                if (!parse_hex4(p, &cp))
+                    break;
+
+                if (0xD800U <= cp && cp < 0xDC00U) {
+                    /* surrogate pair */
+                    unsigned lo;
+                    if (p->end - p->cur < 6 || '\\' != p->cur[0]
+                            || 'u' != p->cur[1])
+                        break;
+                    p->cur += 2;
+                    if (!parse_hex4(p, &lo) || lo < 0xDC00U || 0xE000U <= lo)
+                        break;
+                    cp = 0x10000U + ((cp - 0xD800U) << 10) + (lo - 0xDC00U);
+                }
+
+                put_utf8(mem, cp);
+                continue;
+        }
+
+        /* invalid escape sequence */
+        break;
+    }
+
+    fclose(mem);
+    if (ok && !memchr(str, '\0', size))
+        return str;
+
+    free(str);
+    return NULL;
+}
+
+static bool parse_value(struct json_parser *p, struct json_value *val);
+
+/* parse items of an array or object till the closing bracket */
+static bool parse_items(struct json_parser *p, struct json_value *val,
+                        bool object)
+{
+    const char close = (object) ? '}' : ']';
+    size_t alloc = 0U;
+
+    skip_ws(p);
+    if (p->cur < p->end && close == *p->cur) {
+        ++p->cur;
+        return true;
+    }
+
+    for (;;) {
+        if (val->cnt == alloc) {
+            alloc = (alloc) ? (2U * alloc) : 8U;
+            struct json_value *items = realloc(val->items,
+                    alloc * sizeof *items);
+            if (!items)
+                return false;
+            val->items = items;
+        }
+
+        struct json_value *item = &val->items[val->cnt];
+        memset(item, 0, sizeof *item);
+        ++val->cnt;
+
+        skip_ws(p);
+        if (object) {
+            item->key = parse_str(p);
+            if (!item->key)
+                return false;
+
+            skip_ws(p);
+            if (p->end <= p->cur || ':' != *p->cur++)
+                return false;
+        }
+
+        if (!parse_value(p, item))
+            return false;
+
+        skip_ws(p);
+        if (p->end <= p->cur)
+            return false;
+
+        const char c = *p->cur++;
+        if (close == c)
+            return true;
+        if (',' != c)
+            return false;
+    }
+}
+
+/* parse a literal (true, false, null) or a number, store it as a string */
+static bool parse_atom(struct json_parser *p, struct json_value *val)
+{
+    const char *beg = p->cur;
+    while (p->cur < p->end && (isalnum((unsigned char) *p->cur)
+                || strchr("+-.", *p->cur)))
+        ++p->cur;
+
+    const size_t len = p->cur - beg;
+    if (!len)
+        return false;
+
+    if (4U == len && !strncmp(beg, "null", len)) {
+        val->type = JT_NULL;
+        return true;
+    }
+
+    if ((4U == len && !strncmp(beg, "true", len))
+            || (5U == len && !strncmp(beg, "false", len)))
+        val->type = JT_BOOL;
+    else if ('-' == *beg || isdigit((unsigned char) *beg))
+        val->type = JT_NUMBER;
+    else
+        return false;
+
+    val->str = strndup(beg, len);
+    return !!val->str;
+}
+
+static bool parse_value(struct json_parser *p, struct json_value *val)
+{
+    skip_ws(p);
+    if (p->end <= p->cur)
+        return false;
+
+    switch (*p->cur) {
+        case '"':
+            val->type = JT_STRING;
+            val->str = parse_str(p);
+            return !!val->str;
+
+        case '[':
+        case '{':
+            if (JSON_DEPTH_MAX < ++p->depth)
+                return false;
+
+            val->type = ('{' == *p->cur++) ? JT_OBJECT : JT_ARRAY;
+            if (!parse_items(p, val, JT_OBJECT == val->type))
+                return false;
+
+            --p->depth;
+            return true;
+
+        default:
+            return parse_atom(p, val);
+    }
+}
+
+/* release all memory owned by val, but not val itself */
+static void free_value(struct json_value *val)
+{
+    size_t i;
+    for (i = 0U; i < val->cnt; ++i)
+        free_value(&val->items[i]);
+
+    free(val->items);
+    free(val->str);
+    free(val->key);
+}
+
+struct json_value *json_parse(const char *text, size_t len)
+{
+    struct json_value *val = calloc(1U, sizeof *val);
+    if (!val)
+        return NULL;
+
+    struct json_parser p = {
+        .cur    = text,
+        .end    = text + len,
+        .depth  = 0
+    };
+
+    if (parse_value(&p, val)) {
+        skip_ws(&p);
+        if (p.cur == p.end)
+            return val;
+    }
+
+    json_free(val);
+    return NULL;
+}
+
+void json_free(struct json_value *val)
+{
+    if (!val)
+        return;
+
+    free_value(val);
+    free(val);
+}
+
+const struct json_value *json_get(const struct json_value *obj,
+                                  const char *key)
+{
+    if (!obj || JT_OBJECT != obj->type)
+        return NULL;
+
+    size_t i;
+    for (i = 0U; i < obj->cnt; ++i)
+        if (STREQ(obj->items[i].key, key))
+            return &obj->items[i];
+
+    return NULL;
+}
+
+const char *json_get_str(const struct json_value *obj, const char *key)
+{
+    const struct json_value *val = json_get(obj, key);
+    return (val && JT_STRING == val->type) ? val->str : NULL;
+}
+
+/* bounds on the state kept by the streaming rewriter */
+#define RW_DEPTH_MAX    256
+#define RW_KEY_MAX      32
+#define RW_VALUE_MAX    8192
+
+enum rw_state {
+    RW_TEXT = 0,        /* outside of string literals */
+    RW_STRING,          /* inside of a string literal */
+    RW_ESCAPE           /* right after a backslash in a string literal */
+};
+
+struct json_rewriter {
+    const char *const      *keys;
+    json_rewrite_fn         fn;
+    void                   *ctx;
+    enum rw_state           state;
+    int                     depth;
+    bool                    started;
+    bool                    expect_key;
+    bool                    in_key;
+    bool                    capture;        /* buffering a value to rewrite */
+    char                    objects[RW_DEPTH_MAX];  /* object or array? */
+    char                    key[RW_KEY_MAX];
+    size_t                  key_len;        /* RW_KEY_MAX if too long */
+    char                    value[RW_VALUE_MAX + 2];
+    size_t                  value_len;
+};
+
+struct json_rewriter *json_rewriter_create(const char *const *keys,
+                                          json_rewrite_fn fn, void *ctx)
+{
+    struct json_rewriter *rw = calloc(1U, sizeof *rw);
+    if (!rw)
+        return NULL;
+
+    rw->keys = keys;
+    rw->fn = fn;
+    rw->ctx = ctx;
+    return rw;
+}
+
+void json_rewriter_free(struct json_rewriter *rw)
+{
+    free(rw);
+}
+
+bool json_rewriter_busy(const struct json_rewriter *rw)
+{
+    return rw->started;
+}
+
+/* return true if the innermost container is an object */
+static bool rw_in_object(const struct json_rewriter *rw)
+{
+    return 0 < rw->depth && rw->depth <= RW_DEPTH_MAX
+        && rw->objects[rw->depth - 1];
+}
+
+/* return true if values of the current key are to be rewritten */
+static bool rw_key_wanted(const struct json_rewriter *rw)
+{
+    if (!rw_in_object(rw) || RW_KEY_MAX <= rw->key_len)
+        return false;
+
+    const char *const *pkey;
+    for (pkey = rw->keys; *pkey; ++pkey)
+        if (STREQ(*pkey, rw->key))
+            return true;
+
+    return false;
+}
+
+/* write the captured string value to fp, rewritten if fn says so */
+static void rw_flush_value(struct json_rewriter *rw, FILE *fp)
+{
+    /* decode the literal using the parser, quotes included */
+    memmove(rw->value + 1, rw->value, rw->value_len);
+    rw->value[0] = '"';
+    rw->value[rw->value_len + 1U] = '"';
+    struct json_parser p = {
+        .cur = rw->value,
+        .end = rw->value + rw->value_len + 2U
+    };
+
+    char *str = parse_str(&p);
+
+    char *repl = (str) ? rw->fn(rw->key, str, rw->ctx) : NULL;
+    if (repl)
+        json_print_str(fp, repl);
+    else
+        fwrite(rw->value, 1U, rw->value_len + 2U, fp);
+
+    free(repl);
+    free(str);
+    rw->capture = false;
+    rw->value_len = 0U;
+}
+
+/* handle one byte of a string literal */
+static void rw_string_char(struct json_rewriter *rw, char c, FILE *fp)
+{
+    const bool end = (RW_STRING == rw->state && '"' == c);
+    if (RW_ESCAPE == rw->state)
+        rw->state = RW_STRING;
+    else if ('\\' == c)
+        rw->state = RW_ESCAPE;
+    else if (end)
+        rw->state = RW_TEXT;
+
+    if (rw->in_key) {
+        fputc(c, fp);
+        if (end) {
+            rw->in_key = false;
+            rw->key[(rw->key_len < RW_KEY_MAX) ? rw->key_len : 0U] = '\0';
+        }
+        else if (rw->key_len < RW_KEY_MAX - 1U)
+            rw->key[rw->key_len++] = c;
+        else
+            /* too long to be one of the keys we rewrite */
+            rw->key_len = RW_KEY_MAX;
+        return;
+    }
+
+    if (!rw->capture) {
+        fputc(c, fp);
+        return;
+    }
+
+    if (end) {
+        rw_flush_value(rw, fp);
+        return;
+    }
+
+    if (rw->value_len < RW_VALUE_MAX) {
+        rw->value[rw->value_len++] = c;
+        return;
+    }
+
+    /* too long, give up rewriting and pass the rest through */
+    fputc('"', fp);
+    fwrite(rw->value, 1U, rw->value_len, fp);
+    fputc(c, fp);
+    rw->capture = false;
+    rw->value_len = 0U;
+}
+
+size_t json_rewriter_feed(struct json_rewriter *rw, const char *buf,
+                          size_t len, FILE *fp)
+{
+    size_t i;
+    for (i = 0U; i < len; ++i) {
+        const char c = buf[i];
+        if (RW_TEXT != rw->state) {
+            rw_string_char(rw, c, fp);
+            continue;
+        }
+
+        switch (c) {
+            case '{':
+            case '[':
+                if (rw->depth < RW_DEPTH_MAX)
+                    rw->objects[rw->depth] = ('{' == c);
+                ++rw->depth;
+                rw->started = true;
+                rw->expect_key = ('{' == c);
+                break;
+
+            case '}':
+            case ']':
+                --rw->depth;
+                rw->expect_key = false;
+                break;
+
+            case ',':
+                rw->expect_key = rw_in_object(rw);
+                break;
+
+            case '"':
+                rw->state = RW_STRING;
+                if (rw->expect_key) {
+                    /* a key of an object */
+                    rw->in_key = true;
+                    rw->expect_key = false;
+                    rw->key_len = 0U;
+                }
+                else if (rw_key_wanted(rw)) {
+                    /* a value of a key we want to rewrite */
+                    rw->capture = true;
+                    rw->value_len = 0U;
+                    continue;
+                }
+                break;
+        }
+
+        fputc(c, fp);
+        if (rw->started && rw->depth <= 0) {
+            /* the top-level value is complete */
+            rw->started = false;
+            rw->depth = 0;
+            return i + 1U;
+        }
+    }
+
+    return len;
+}
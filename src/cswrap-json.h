@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_JSON_H
+#define CSWRAP_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+enum json_type {
+    JT_NULL = 0,
+    JT_BOOL,
+    JT_NUMBER,
+    JT_STRING,
+    JT_ARRAY,
+    JT_OBJECT
+};
+
+/* parsed JSON value, items of objects have keys, items of arrays do not */
+struct json_value {
+    enum json_type          type;
+    char                   *str;    /* string, number, or "true"/"false" */
+    char                   *key;    /* key of this value in its object */
+    size_t                  cnt;    /* number of items of array/object */
+    struct json_value      *items;
+};
+
+/* write str to fp as a JSON string literal */
+void json_print_str(FILE *fp, const char *str);
+
+/* write val to fp as JSON, objects are indented by indent spaces per level */
+void json_print_value(FILE *fp, const struct json_value *val, int indent);
+
+/* parse len bytes of text as a single JSON value, NULL on error */
+struct json_value *json_parse(const char *text, size_t len);
+
+/* release a value returned by json_parse() */
+void json_free(struct json_value *val);
+
+/* return the item of obj with the given key, NULL if there is none */
+const struct json_value *json_get(const struct json_value *obj,
+                                  const char *key);
+
+/* return the string value of the given key of obj, NULL if there is none */
+const char *json_get_str(const struct json_value *obj, const char *key);
+
+/* return heap-allocated replacement of the string value of key, NULL to
+ * keep the value as it is */
+typedef char *(*json_rewrite_fn)(const char *key, const char *value,
+                                 void *ctx);
+
+/* streaming rewriter of string values of selected keys, it keeps a bounded
+ * amount of state regardless of the size of the JSON text */
+struct json_rewriter;
+
+/* create a rewriter of values of the NULL-terminated list of keys */
+struct json_rewriter *json_rewriter_create(const char *const *keys,
+                                          json_rewrite_fn fn, void *ctx);
+
+/* feed len bytes of JSON text, write the (rewritten) text to fp, return the
+ * number of bytes consumed, which is less than len if the top-level value
+ * ends before the end of buf */
+size_t json_rewriter_feed(struct json_rewriter *rw, const char *buf,
+                          size_t len, FILE *fp);
+
+/* return true if the rewriter is inside of a top-level value */
+bool json_rewriter_busy(const struct json_rewriter *rw);
+
+void json_rewriter_free(struct json_rewriter *rw);
+
+#endif /* CSWRAP_JSON_H */
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-pathset.h"
+#include "cswrap-util.h"
+
+#include <fnmatch.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* growable array of heap-allocated strings */
+struct str_array {
+    char              **items;
+    size_t              cnt;
+    size_t              alloc;
+};
+
+struct glob {
+    char               *pattern;
+    size_t              lit_len;    /* length of the leading literal part */
+};
+
+struct path_set {
+    struct str_array    exact;      /* sorted for bsearch() */
+    struct str_array    dirs;       /* sorted, without the trailing '/' */
+    struct glob        *globs;
+    size_t              n_globs;
+    size_t              globs_alloc;
+};
+
+struct path_set *path_set_create(void)
+{
+    return calloc(1U, sizeof(struct path_set));
+}
+
+static bool str_array_push(struct str_array *arr, char *str)
+{
+    if (!str)
+        return false;
+
+    if (arr->cnt == arr->alloc) {
+        const size_t alloc = (arr->alloc) ? (2U * arr->alloc) : 0x10U;
+        char **items = realloc(arr->items, alloc * sizeof *items);
+        if (!items) {
+            free(str);
+            return false;
+        }
+
+        arr->items = items;
+        arr->alloc = alloc;
+    }
+
+    arr->items[arr->cnt++] = str;
+    return true;
+}
+
+static bool add_glob(struct path_set *set, const char *pattern)
+{
+    if (set->n_globs == set->globs_alloc) {
+        const size_t alloc = (set->globs_alloc) ? (2U * set->globs_alloc) : 8U;
+        struct glob *globs = realloc(set->globs, alloc * sizeof *globs);
+        if (!globs)
+            return false;
+
+        set->globs = globs;
+        set->globs_alloc = alloc;
+    }
+
+    char *dup = strdup(pattern);
+    if (!dup)
+        return false;
+
+    struct glob *glob = &set->globs[set->n_globs++];
+    glob->pattern = dup;
+    glob->lit_len = strcspn(dup, "*?[\\");
+    return true;
+}
+
+bool path_set_add(struct path_set *set, const char *pattern)
+{
+    const size_t len = strlen(pattern);
+    if (!len)
+        return true;
+
+    if ('/' != pattern[0] && '*' != pattern[0]) {
+        /* relative patterns match anywhere in the tree */
+        char *glob;
+        if (-1 == asprintf(&glob, "*/%s%s", pattern,
+                    ('/' == pattern[len - 1U]) ? "*" : ""))
+            return false;
+
+        const bool ok = add_glob(set, glob);
+        free(glob);
+        return ok;
+    }
+
+    if (pattern[strcspn(pattern, "*?[")])
+        return add_glob(set, pattern);
+
+    if (1U < len && '/' == pattern[len - 1U])
+        return str_array_push(&set->dirs, strndup(pattern, len - 1U));
+
+    return str_array_push(&set->exact, strdup(pattern));
+}
+
+bool path_set_add_list(struct path_set *set, const char *list_file)
+{
+    FILE *fp = fopen(list_file, "r");
+    if (!fp)
+        return false;
+
+    /* relative paths are resolved against the directory of the list */
+    char *dir_buf = strdup(list_file);
+    const char *dir = (dir_buf) ? dirname(dir_buf) : ".";
+    char *abs_dir = canonicalize_file_name(dir);
+
+    bool ok = !!abs_dir;
+    char *line = NULL;
+    size_t line_size = 0U;
+    ssize_t len;
+    while (ok && 0 < (len = getline(&line, &line_size, fp))) {
+        if ('\n' == line[len - 1])
+            line[--len] = '\0';
+        if (!len)
+            continue;
+
+        char *path = NULL;
+        if ('/' == line[0])
+            path = strdup(line);
+        else if (-1 == asprintf(&path, "%s/%s", abs_dir, line))
+            path = NULL;
+
+        /* resolve symlinks if the file exists */
+        char *real = (path) ? canonicalize_file_name(path) : NULL;
+        if (real) {
+            free(path);
+            path = real;
+        }
+
+        ok = str_array_push(&set->exact, path);
+    }
+
+    free(line);
+    free(abs_dir);
+    free(dir_buf);
+    fclose(fp);
+    return ok;
+}
+
+static int cmp_str_ptrs(const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+void path_set_finish(struct path_set *set)
+{
+    qsort(set->exact.items, set->exact.cnt, sizeof(char *), cmp_str_ptrs);
+    qsort(set->dirs.items, set->dirs.cnt, sizeof(char *), cmp_str_ptrs);
+}
+
+static bool str_array_find(const struct str_array *arr, const char *str)
+{
+    return arr->cnt && bsearch(&str, arr->items, arr->cnt, sizeof(char *),
+            cmp_str_ptrs);
+}
+
+bool path_set_match(const struct path_set *set, const char *path)
+{
+    if (str_array_find(&set->exact, path))
+        return true;
+
+    if (set->dirs.cnt) {
+        /* look up each parent directory of the path */
+        char *buf = strdup(path);
+        char *slash;
+        bool found = false;
+        while (buf && !found && (slash = strrchr(buf, '/')) && slash != buf) {
+            *slash = '\0';
+            found = str_array_find(&set->dirs, buf);
+        }
+
+        free(buf);
+        if (found)
+            return true;
+    }
+
+    size_t i;
+    for (i = 0U; i < set->n_globs; ++i) {
+        const struct glob *glob = &set->globs[i];
+        if (strncmp(path, glob->pattern, glob->lit_len))
+            /* the literal prefix does not match */
+            continue;
+
+        if (!fnmatch(glob->pattern, path, /* flags */ 0))
+            return true;
+    }
+
+    return false;
+}
+
+void path_set_free(struct path_set *set)
+{
+    if (!set)
+        return;
+
+    size_t i;
+    for (i = 0U; i < set->exact.cnt; ++i)
+        free(set->exact.items[i]);
+    for (i = 0U; i < set->dirs.cnt; ++i)
+        free(set->dirs.items[i]);
+    for (i = 0U; i < set->n_globs; ++i)
+        free(set->globs[i].pattern);
+
+    free(set->exact.items);
+    free(set->dirs.items);
+    free(set->globs);
+    free(set);
+}
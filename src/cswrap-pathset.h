@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_PATHSET_H
+#define CSWRAP_PATHSET_H
+
+#include <stdbool.h>
+
+/* set of absolute paths matched by exact paths, directories, and globs */
+struct path_set;
+
+/* return a new empty set, NULL on OOM */
+struct path_set *path_set_create(void);
+
+/* add a pattern to the set, it is a directory if it ends by '/', a glob if
+ * it contains wildcards, and an exact path otherwise, patterns that start
+ * neither by '/' nor by '*' match anywhere in the tree, false on OOM */
+bool path_set_add(struct path_set *set, const char *pattern);
+
+/* add paths listed in the given file (one per line), relative paths are
+ * taken relative to the directory of the file, return false on error */
+bool path_set_add_list(struct path_set *set, const char *list_file);
+
+/* prepare the set for lookups, no patterns can be added afterwards */
+void path_set_finish(struct path_set *set);
+
+/* return true if the absolute path matches any pattern of the set */
+bool path_set_match(const struct path_set *set, const char *path);
+
+/* release the set */
+void path_set_free(struct path_set *set);
+
+#endif /* CSWRAP_PATHSET_H */
@@ -0,0 +1,486 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-ppcache.h"
+#include "cswrap-util.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* bump this whenever the key computation or the format of deps changes */
+static const char pp_magic[] = "cswrap-pp-2";
+
+/* return the number of args to be dropped when running the preprocessor */
+static int drop_for_preprocessing(char **argv)
+{
+    static const char *drop_with_operand[] = {
+        "-o", "-MF", "-MT", "-MQ", "-Xanalyzer", NULL
+    };
+
+    static const char *drop[] = {
+        "-c", "-S", "-E", "-M", "-MM", "-MD", "-MMD", "-MP",
+        "-fsyntax-only", "--analyze", NULL
+    };
+
+    const char *arg = *argv;
+    const char **pstr;
+    for (pstr = drop_with_operand; *pstr; ++pstr)
+        if (STREQ(arg, *pstr))
+            return (argv[1]) ? 2 : 1;
+
+    for (pstr = drop; *pstr; ++pstr)
+        if (STREQ(arg, *pstr))
+            return 1;
+
+    if (MATCH_PREFIX(arg, "-o") || MATCH_PREFIX(arg, "-MF")
+            || MATCH_PREFIX(arg, "-MT") || MATCH_PREFIX(arg, "-MQ")
+            || MATCH_PREFIX(arg, "-fanalyzer"))
+        return 1;
+
+    return 0;
+}
+
+/* the preprocessor being run, 0 if none */
+static volatile pid_t pp_pid;
+
+pid_t spawn_preprocessor(const char *exec_path, char **argv, int out_fd,
+                         int err_fd)
+{
+    /* construct argv[] for the preprocessor */
+    int argc = 0;
+    while (argv[argc])
+        ++argc;
+
+    char **pp_argv = malloc((argc + 2) * sizeof *pp_argv);
+    if (!pp_argv)
+        return -1;
+
+    int src, dst = 0;
+    pp_argv[dst++] = argv[0];
+    for (src = 1; src < argc;) {
+        const int drop = drop_for_preprocessing(argv + src);
+        if (drop)
+            src += drop;
+        else
+            pp_argv[dst++] = argv[src++];
+    }
+    pp_argv[dst++] = "-E";
+    pp_argv[dst] = NULL;
+
+    const pid_t pid = fork();
+    if (!pid) {
+        /* run the preprocessor with stdout redirected to out_fd */
+        if (err_fd < 0)
+            err_fd = open("/dev/null", O_WRONLY);
+        if (0 <= dup2(out_fd, STDOUT_FILENO)
+                && 0 <= dup2(err_fd, STDERR_FILENO))
+            execv(exec_path, pp_argv);
+        _exit(0x7F);
+    }
+
+    free(pp_argv);
+    if (0 < pid)
+        pp_pid = pid;
+
+    return pid;
+}
+
+bool wait_for_preprocessor(pid_t pid)
+{
+    int status;
+    int rv;
+    while (-1 == (rv = waitpid(pid, &status, 0)) && EINTR == errno)
+        ;
+
+    pp_pid = 0;
+    return -1 != rv && WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+void kill_preprocessor(int signum)
+{
+    const pid_t pid = pp_pid;
+    if (pid <= 0)
+        return;
+
+    const int saved_errno = errno;
+    kill(pid, signum);
+    errno = saved_errno;
+}
+
+/* compute key of the preprocessed file from the compiler and its args */
+static bool compute_key(uint64_t *pkey, const char *exec_path, char **argv,
+                        const char *src)
+{
+    uint64_t hash = hash_bytes(HASH_INIT, pp_magic, sizeof pp_magic);
+
+    /* identity of the compiler binary */
+    struct stat st;
+    if (stat(exec_path, &st))
+        return false;
+
+    const unsigned long long id[] = {
+        st.st_dev, st.st_ino, st.st_size, st.st_mtime
+    };
+    hash = hash_bytes(hash, id, sizeof id);
+
+    /* relative paths in line markers are resolved against cwd */
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof cwd))
+        return false;
+    hash = hash_bytes(hash, cwd, strlen(cwd) + 1U);
+    hash = hash_bytes(hash, src, strlen(src) + 1U);
+
+    /* flags that may affect output of the preprocessor, including its
+     * diagnostics, which are replayed for each consumer */
+    int i;
+    for (i = 1; argv[i];) {
+        const int drop = drop_for_preprocessing(argv + i);
+        if (drop) {
+            i += drop;
+            continue;
+        }
+
+        hash = hash_bytes(hash, argv[i], strlen(argv[i]) + 1U);
+        ++i;
+    }
+
+    *pkey = hash;
+    return true;
+}
+
+/* return true if the file still has the recorded size and mtime */
+static bool dep_up_to_date(const char *line)
+{
+    long long sec, nsec, size;
+    int off;
+    if (3 != sscanf(line, "%lld %lld %lld %n", &sec, &nsec, &size, &off))
+        return false;
+
+    char *name = strdup(line + off);
+    if (!name)
+        return false;
+
+    /* chop the trailing new-line */
+    name[strcspn(name, "\n")] = '\0';
+
+    struct stat st;
+    const bool ok = !stat(name, &st)
+        && st.st_mtim.tv_sec == sec
+        && st.st_mtim.tv_nsec == nsec
+        && st.st_size == size;
+
+    free(name);
+    return ok;
+}
+
+/* return true if none of the files listed in deps has changed */
+static bool deps_up_to_date(const char *deps)
+{
+    FILE *fp = fopen(deps, "r");
+    if (!fp)
+        return false;
+
+    char *buf = NULL;
+    size_t buf_size = 0;
+    bool ok = 0 < getline(&buf, &buf_size, fp)
+        && !strncmp(buf, pp_magic, sizeof pp_magic - 1U)
+        && '\n' == buf[sizeof pp_magic - 1U];
+
+    while (ok && 0 < getline(&buf, &buf_size, fp))
+        ok = dep_up_to_date(buf);
+
+    free(buf);
+    fclose(fp);
+    return ok;
+}
+
+static int cmp_str_ptr(const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/* return heap-allocated name of the file of the line marker, if any */
+static char *parse_line_marker(const char *line)
+{
+    /* # 42 "file.h" 1 3 4 */
+    if ('#' != line[0] || ' ' != line[1] || !isdigit((unsigned char) line[2]))
+        return NULL;
+
+    const char *beg = strchr(line, '"');
+    if (!beg || '<' == beg[1])
+        /* <built-in>, <command-line>, ... */
+        return NULL;
+
+    char *name = malloc(strlen(++beg) + 1U);
+    if (!name)
+        return NULL;
+
+    char *dst = name;
+    for (; *beg && '"' != *beg; ++beg) {
+        if ('\\' == *beg && beg[1])
+            ++beg;
+        *dst++ = *beg;
+    }
+    *dst = '\0';
+
+    if ('"' == *beg && name[0])
+        return name;
+
+    free(name);
+    return NULL;
+}
+
+/* write list of files included in the preprocessed file tu to fd */
+static bool write_deps(int fd, const char *tu)
+{
+    FILE *fp = fopen(tu, "r");
+    if (!fp)
+        return false;
+
+    /* collect names of all files from line markers */
+    char **names = NULL;
+    size_t cnt = 0U, alloc = 0U;
+    char *buf = NULL;
+    size_t buf_size = 0;
+    bool ok = true;
+    while (ok && 0 < getline(&buf, &buf_size, fp)) {
+        char *name = parse_line_marker(buf);
+        if (!name)
+            continue;
+
+        if (cnt && STREQ(names[cnt - 1U], name)) {
+            /* the most common case of a duplicate */
+            free(name);
+            continue;
+        }
+
+        if (cnt == alloc) {
+            alloc = (alloc) ? (2U * alloc) : 0x40U;
+            char **tmp = realloc(names, alloc * sizeof *names);
+            if (!tmp) {
+                free(name);
+                ok = false;
+                break;
+            }
+            names = tmp;
+        }
+
+        names[cnt++] = name;
+    }
+
+    free(buf);
+    fclose(fp);
+
+    FILE *out = (ok) ? fdopen(fd, "w") : NULL;
+    if (out) {
+        fprintf(out, "%s\n", pp_magic);
+        qsort(names, cnt, sizeof *names, cmp_str_ptr);
+    }
+    else
+        ok = false;
+
+    size_t i;
+    for (i = 0U; i < cnt; ++i) {
+        struct stat st;
+        if (ok && (!i || !STREQ(names[i - 1U], names[i]))) {
+            if (stat(names[i], &st) || strchr(names[i], '\n'))
+                ok = false;
+            else
+                fprintf(out, "%lld %lld %lld %s\n",
+                        (long long) st.st_mtim.tv_sec,
+                        (long long) st.st_mtim.tv_nsec,
+                        (long long) st.st_size, names[i]);
+        }
+    }
+
+    for (i = 0U; i < cnt; ++i)
+        free(names[i]);
+    free(names);
+
+    if (out && fclose(out))
+        ok = false;
+    else if (!out)
+        close(fd);
+
+    return ok;
+}
+
+/* run the preprocessor and store its output as tu, its diagnostics as err,
+ * and list of includes as deps */
+static bool produce_tu(const char *exec_path, char **argv, const char *tu,
+                       const char *err, const char *deps)
+{
+    char *tmp_tu = NULL, *tmp_err = NULL, *tmp_deps = NULL;
+    if (-1 == asprintf(&tmp_tu, "%s.XXXXXX", tu)
+            || -1 == asprintf(&tmp_err, "%s.XXXXXX", err)
+            || -1 == asprintf(&tmp_deps, "%s.XXXXXX", deps)) {
+        free(tmp_tu);
+        free(tmp_err);
+        return false;
+    }
+
+    bool ok = false;
+    int tu_fd = -1, err_fd = -1, deps_fd = -1;
+    pid_t pid;
+    if ((tu_fd = mkstemp(tmp_tu)) < 0)
+        goto out;
+    if ((err_fd = mkstemp(tmp_err)) < 0)
+        goto out;
+    if ((deps_fd = mkstemp(tmp_deps)) < 0)
+        goto out;
+    if ((pid = spawn_preprocessor(exec_path, argv, tu_fd, err_fd)) < 0)
+        goto out;
+
+    close(tu_fd);
+    tu_fd = -1;
+    close(err_fd);
+    err_fd = -1;
+    if (!wait_for_preprocessor(pid))
+        goto out;
+
+    /* the deps file is published last as it marks a complete entry */
+    ok = write_deps(deps_fd, tmp_tu);
+    deps_fd = -1;
+    ok = ok && !rename(tmp_tu, tu) && !rename(tmp_err, err)
+        && !rename(tmp_deps, deps);
+
+out:
+    if (0 <= tu_fd)
+        close(tu_fd);
+    if (0 <= err_fd)
+        close(err_fd);
+    if (0 <= deps_fd)
+        close(deps_fd);
+    if (!ok) {
+        unlink(tmp_tu);
+        unlink(tmp_err);
+        unlink(tmp_deps);
+    }
+
+    free(tmp_tu);
+    free(tmp_err);
+    free(tmp_deps);
+    return ok;
+}
+
+char *ppcache_get(const char *dir, const char *exec_path, char **argv,
+                  const char *src, char **perr)
+{
+    uint64_t key;
+    if (!compute_key(&key, exec_path, argv, src))
+        return NULL;
+
+    if (mkdir(dir, 0775) && EEXIST != errno)
+        return NULL;
+
+    const unsigned long long k = key;
+    char *tu = NULL, *err = NULL, *deps = NULL;
+    if (-1 == asprintf(&tu, "%s/%016llx.i", dir, k)
+            || -1 == asprintf(&err, "%s/%016llx.err", dir, k)
+            || -1 == asprintf(&deps, "%s/%016llx.deps", dir, k)) {
+        free(tu);
+        free(err);
+        return NULL;
+    }
+
+    if (!deps_up_to_date(deps)
+            && !produce_tu(exec_path, argv, tu, err, deps)) {
+        free(tu);
+        tu = NULL;
+        free(err);
+        err = NULL;
+    }
+
+    free(deps);
+    *perr = err;
+    return tu;
+}
+
+/* return the number of args that only the preprocessor is interested in */
+static int drop_for_consumer(char **argv)
+{
+    static const char *drop_with_operand[] = {
+        "-D", "-U", "-I", "-include", "-imacros", "-isystem", "-iquote",
+        "-idirafter", "-iprefix", "-iwithprefix", "-iwithprefixbefore",
+        NULL
+    };
+
+    const char *arg = *argv;
+    const char **pstr;
+    for (pstr = drop_with_operand; *pstr; ++pstr)
+        if (STREQ(arg, *pstr))
+            return (argv[1]) ? 2 : 1;
+
+    if (MATCH_PREFIX(arg, "-D") || MATCH_PREFIX(arg, "-U")
+            || MATCH_PREFIX(arg, "-I") || MATCH_PREFIX(arg, "-Wp,")
+            || MATCH_PREFIX(arg, "-nostdinc"))
+        return 1;
+
+    return 0;
+}
+
+char **ppcache_consumer_argv(char **argv, const char *src, const char *tu,
+                             const bool cxx)
+{
+    int argc = 0;
+    while (argv[argc])
+        ++argc;
+
+    /* -x LANG TU -x none replaces SRC */
+    char **new_argv = malloc((argc + 5) * sizeof *new_argv);
+    if (!new_argv)
+        return NULL;
+
+    int i, dst = 0;
+    new_argv[dst++] = argv[0];
+    for (i = 1; i < argc;) {
+        const int drop = drop_for_consumer(argv + i);
+        if (drop) {
+            i += drop;
+            continue;
+        }
+
+        if (argv[i] != src) {
+            new_argv[dst++] = argv[i++];
+            continue;
+        }
+
+        new_argv[dst++] = "-x";
+        new_argv[dst++] = (cxx) ? "c++-cpp-output" : "cpp-output";
+        new_argv[dst++] = (char *) tu;
+        new_argv[dst++] = "-x";
+        new_argv[dst++] = "none";
+        ++i;
+    }
+
+    new_argv[dst] = NULL;
+    return new_argv;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_PPCACHE_H
+#define CSWRAP_PPCACHE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* run the compiler as preprocessor writing to out_fd and its diagnostics to
+ * err_fd (discarded if negative), return PID or -1 */
+pid_t spawn_preprocessor(const char *exec_path, char **argv, int out_fd,
+                         int err_fd);
+
+/* wait for the preprocessor to exit, return true if it succeeded */
+bool wait_for_preprocessor(pid_t pid);
+
+/* send signum to the preprocessor being waited for (if any), this function
+ * is async-signal-safe */
+void kill_preprocessor(int signum);
+
+/* return heap-allocated path of the up-to-date preprocessed source file src,
+ * run the preprocessor if there is no such file in dir yet, NULL on error,
+ * *perr is set to heap-allocated path of the diagnostics of the preprocessor */
+char *ppcache_get(const char *dir, const char *exec_path, char **argv,
+                  const char *src, char **perr);
+
+/* return heap-allocated argv[] that reads the preprocessed file tu instead
+ * of src, with all preprocessor flags removed, NULL on error */
+char **ppcache_consumer_argv(char **argv, const char *src, const char *tu,
+                             bool cxx);
+
+#endif /* CSWRAP_PPCACHE_H */
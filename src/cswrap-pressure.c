@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-pressure.h"
+#include "cswrap-status.h"
+#include "cswrap-util.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* initial and maximal delay [ms] between two checks of the pressure */
+#define DELAY_MIN 250
+#define DELAY_MAX 8000
+
+/* read the file into buf as a NUL-terminated string, return its length */
+static ssize_t read_small_file(const char *path, char *buf, size_t size)
+{
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    const ssize_t len = read(fd, buf, size - 1U);
+    close(fd);
+    if (len < 0)
+        return -1;
+
+    buf[len] = '\0';
+    return len;
+}
+
+/* return path to the cgroup v2 directory we are running in (if any) */
+static const char *cgroup_dir(void)
+{
+    static char dir[PATH_MAX];
+    static bool done;
+    if (done)
+        return (dir[0]) ? dir : NULL;
+
+    done = true;
+    char buf[PATH_MAX];
+    if (read_small_file("/proc/self/cgroup", buf, sizeof buf) <= 0)
+        return NULL;
+
+    /* the unified hierarchy is described by a line starting with "0::" */
+    const char *line = (MATCH_PREFIX(buf, "0::")) ? buf : strstr(buf, "\n0::");
+    if (!line)
+        return NULL;
+
+    line += (line == buf) ? 3 : 4;
+    const int len = strcspn(line, "\n");
+    if (sizeof dir <= (size_t) snprintf(dir, sizeof dir, "/sys/fs/cgroup%.*s",
+                len, line))
+        dir[0] = '\0';
+
+    return (dir[0]) ? dir : NULL;
+}
+
+/* return the "some avg10" value of the given resource, negative if n/a */
+static double read_avg10(const char *resource)
+{
+    char path[PATH_MAX];
+    char buf[0x200];
+    ssize_t len = -1;
+
+    /* prefer the pressure of our cgroup if available */
+    const char *dir = cgroup_dir();
+    if (dir && (size_t) snprintf(path, sizeof path, "%s/%s.pressure", dir,
+                resource) < sizeof path)
+        len = read_small_file(path, buf, sizeof buf);
+
+    if (len <= 0) {
+        /* fall back to the system-wide pressure */
+        snprintf(path, sizeof path, "/proc/pressure/%s", resource);
+        len = read_small_file(path, buf, sizeof buf);
+    }
+
+    double avg10;
+    if (len <= 0 || 1 != sscanf(buf, "some avg10=%lf", &avg10))
+        /* PSI not supported by the kernel */
+        return -1.0;
+
+    return avg10;
+}
+
+/* return true if any of the limits is exceeded */
+static bool under_pressure(const struct pressure_limit *limit)
+{
+    if (0.0 < limit->memory && limit->memory <= read_avg10("memory"))
+        return true;
+
+    if (0.0 < limit->cpu && limit->cpu <= read_avg10("cpu"))
+        return true;
+
+    return false;
+}
+
+bool wait_for_pressure_relief(const struct pressure_limit *limit,
+                              volatile sig_atomic_t *interrupted)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += PRESSURE_WAIT_MAX;
+
+    bool waited = false;
+    int delay = DELAY_MIN;
+    for (;;) {
+        /* once the pressure drops, let the waiting wrappers in one by one */
+        if (!under_pressure(limit)
+                && (!waited || status_claim_admission(PRESSURE_ADMIT_SPACING)))
+            break;
+
+        const int remaining = ms_until(&deadline);
+        if (*interrupted || !remaining)
+            /* give up waiting */
+            break;
+
+        if (!waited) {
+            status_set_state(WS_WAIT_PRESSURE);
+            waited = true;
+        }
+
+        /* add some per-process jitter so that wrappers do not run in sync */
+        int ms = delay + (int) (getpid() % (delay / 4));
+        if (remaining < ms)
+            ms = remaining;
+
+        const struct timespec ts = {
+            /* tv_sec   */ ms / 1000,
+            /* tv_nsec  */ (ms % 1000) * 1000000L
+        };
+        nanosleep(&ts, NULL);
+
+        /* exponential back-off */
+        delay *= 2;
+        if (DELAY_MAX < delay)
+            delay = DELAY_MAX;
+    }
+
+    if (waited)
+        status_set_state(WS_STARTING);
+
+    return waited;
+}
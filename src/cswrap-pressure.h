@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_PRESSURE_H
+#define CSWRAP_PRESSURE_H
+
+#include <signal.h>
+#include <stdbool.h>
+
+/* maximal amount of time [s] to delay start of a tool due to pressure */
+#define PRESSURE_WAIT_MAX 600
+
+/* minimal delay [ms] between admissions of tools that had to wait */
+#define PRESSURE_ADMIT_SPACING 1000
+
+/* limits on the "some avg10" PSI metrics in percent, zero means no limit */
+struct pressure_limit {
+    double      memory;
+    double      cpu;
+};
+
+/* sleep with bounded back-off until the pressure drops below the limits,
+ * return true if we had to wait */
+bool wait_for_pressure_relief(const struct pressure_limit *limit,
+                              volatile sig_atomic_t *interrupted);
+
+#endif /* CSWRAP_PRESSURE_H */
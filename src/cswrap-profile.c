@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-profile.h"
+#include "cswrap-util.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct tool_profile builtin_profiles[] = {
+    { "cppcheck",   TP_KEEP_ARGS,                           NULL, NULL },
+    { "smatch",     TP_CAPTURE_STDOUT,                      NULL, NULL },
+    { "clang",      TP_PROCESS_GROUP | TP_ANALYZER_NOTES,   "--analyze", NULL },
+    { "clang++",    TP_PROCESS_GROUP | TP_ANALYZER_NOTES,   "--analyze", NULL },
+    { "gcc",        0,                                      "-fanalyzer", NULL },
+    { "gclang",     TP_CONFIGURE_ONLY,                      NULL, NULL },
+    { "gclang++",   TP_CONFIGURE_ONLY,                      NULL, NULL },
+};
+
+#define N_BUILTIN (sizeof builtin_profiles / sizeof builtin_profiles[0])
+
+/* profiles loaded from a file */
+static struct tool_profile *loaded;
+static size_t n_loaded;
+
+/* perfect hash table of all profiles, built on the first lookup */
+static const struct tool_profile **table;
+static uint64_t table_seed;
+static size_t table_mask;
+
+static const struct tool_profile empty_profile;
+
+/* parse one option of a profile, return false if it is not recognized */
+static bool parse_option(struct tool_profile *prof, const char *opt)
+{
+    static const struct {
+        const char     *name;
+        unsigned        flag;
+    } flags[] = {
+        { "keep-args",          TP_KEEP_ARGS        },
+        { "capture-stdout",     TP_CAPTURE_STDOUT   },
+        { "process-group",      TP_PROCESS_GROUP    },
+        { "analyzer-notes",     TP_ANALYZER_NOTES   },
+        { "configure-only",     TP_CONFIGURE_ONLY   },
+        { "no-cache",           TP_NO_CACHE         },
+        { NULL,                 0U                  }
+    };
+
+    int i;
+    for (i = 0; flags[i].name; ++i) {
+        if (STREQ(opt, flags[i].name)) {
+            prof->flags |= flags[i].flag;
+            return true;
+        }
+    }
+
+    char **pvalue = NULL;
+    if (MATCH_PREFIX(opt, "analyzer-arg="))
+        pvalue = &prof->analyzer_arg;
+    else if (MATCH_PREFIX(opt, "bypass-arg="))
+        pvalue = &prof->bypass_arg;
+
+    const char *value = strchr(opt, '=');
+    if (!pvalue || !value || !*++value)
+        return false;
+
+    free(*pvalue);
+    *pvalue = strdup(value);
+    return !!*pvalue;
+}
+
+/* parse a non-empty line "TOOL OPTION..." into prof */
+static bool parse_profile(struct tool_profile *prof, char *line)
+{
+    static const char delim[] = " \t";
+    char *save;
+    prof->name = strdup(strtok_r(line, delim, &save));
+    if (!prof->name)
+        return false;
+
+    const char *opt;
+    while ((opt = strtok_r(NULL, delim, &save)))
+        if (!parse_option(prof, opt))
+            return false;
+
+    return true;
+}
+
+static void free_profile(struct tool_profile *prof)
+{
+    free(prof->name);
+    free(prof->analyzer_arg);
+    free(prof->bypass_arg);
+}
+
+bool profiles_load(const char *file, unsigned *perr_line)
+{
+    *perr_line = 0U;
+    FILE *fp = fopen(file, "r");
+    if (!fp)
+        return false;
+
+    bool ok = true;
+    unsigned line_no = 0U;
+    char *line = NULL;
+    size_t line_size = 0U;
+    ssize_t len;
+    while (ok && 0 < (len = getline(&line, &line_size, fp))) {
+        ++line_no;
+        if ('\n' == line[len - 1])
+            line[--len] = '\0';
+
+        char *str = line + strspn(line, " \t");
+        if (!*str || '#' == *str)
+            /* empty line or comment */
+            continue;
+
+        struct tool_profile *profs =
+            realloc(loaded, (n_loaded + 1U) * sizeof *profs);
+        if (!profs) {
+            ok = false;
+            break;
+        }
+
+        loaded = profs;
+        struct tool_profile *prof = &loaded[n_loaded];
+        memset(prof, 0, sizeof *prof);
+        if (parse_profile(prof, str)) {
+            ++n_loaded;
+            continue;
+        }
+
+        free_profile(prof);
+        *perr_line = line_no;
+        ok = false;
+    }
+
+    free(line);
+    fclose(fp);
+
+    /* the table is built again on the next lookup */
+    free(table);
+    table = NULL;
+    return ok;
+}
+
+static size_t slot_of(const char *name, uint64_t seed)
+{
+    return hash_bytes(seed, name, strlen(name)) & table_mask;
+}
+
+/* try to place all profiles into the table without collisions, profiles
+ * loaded later win over those of the same name, return false on collision */
+static bool fill_table(uint64_t seed)
+{
+    memset(table, 0, (table_mask + 1U) * sizeof *table);
+
+    size_t i;
+    for (i = 0U; i < N_BUILTIN + n_loaded; ++i) {
+        const struct tool_profile *prof = (i < N_BUILTIN)
+            ? &builtin_profiles[i]
+            : &loaded[i - N_BUILTIN];
+
+        const size_t idx = slot_of(prof->name, seed);
+        if (table[idx] && !STREQ(table[idx]->name, prof->name))
+            return false;
+
+        table[idx] = prof;
+    }
+
+    table_seed = seed;
+    return true;
+}
+
+/* find a seed that maps the names to distinct slots, grow the table if no
+ * seed is good enough */
+static bool build_table(void)
+{
+    size_t size = 16U;
+    while (size < 4U * (N_BUILTIN + n_loaded))
+        size <<= 1;
+
+    for (;; size <<= 1) {
+        const struct tool_profile **tab = realloc(table, size * sizeof *tab);
+        if (!tab)
+            return false;
+
+        table = tab;
+        table_mask = size - 1U;
+
+        uint64_t seed;
+        for (seed = HASH_INIT; seed < HASH_INIT + 256U; ++seed)
+            if (fill_table(seed))
+                return true;
+    }
+}
+
+const struct tool_profile *profile_lookup(const char *base_name)
+{
+    if (!table && !build_table())
+        return &empty_profile;
+
+    const struct tool_profile *prof = table[slot_of(base_name, table_seed)];
+    if (prof && STREQ(prof->name, base_name))
+        return prof;
+
+    /* unknown tool */
+    return &empty_profile;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_PROFILE_H
+#define CSWRAP_PROFILE_H
+
+#include <stdbool.h>
+
+/* flags of a tool profile */
+enum {
+    TP_KEEP_ARGS        = (1 << 0), /* do not add/del flags of the tool */
+    TP_CAPTURE_STDOUT   = (1 << 1), /* the tool writes diagnostics to stdout */
+    TP_PROCESS_GROUP    = (1 << 2), /* run the tool in its own process group */
+    TP_ANALYZER_NOTES   = (1 << 3), /* drop notes if running as the analyzer */
+    TP_CONFIGURE_ONLY   = (1 << 4), /* set $WLLVM_CONFIGURE_ONLY if bypassed */
+    TP_NO_CACHE         = (1 << 5)  /* never cache diagnostics of the tool */
+};
+
+/* behavior of cswrap specific to a tool, looked up by its base name */
+struct tool_profile {
+    char                   *name;
+    unsigned                flags;
+    char                   *analyzer_arg;   /* the tool runs as an analyzer
+                                               (and can be timed out) only if
+                                               this arg is given */
+    char                   *bypass_arg;     /* exec the tool directly if this
+                                               arg is given */
+};
+
+/* add profiles from file to the built-in ones, a profile in the file replaces
+ * the built-in profile of the same name, return false on error and set
+ * *perr_line to the line that could not be parsed (zero if the file could not
+ * be read) */
+bool profiles_load(const char *file, unsigned *perr_line);
+
+/* return the profile of the tool, a profile with no flags if it is unknown */
+const struct tool_profile *profile_lookup(const char *base_name);
+
+#endif /* CSWRAP_PROFILE_H */
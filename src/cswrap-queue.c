@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-queue.h"
+#include "cswrap-history.h"
+#include "cswrap-runner.h"
+#include "cswrap-util.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* bump this whenever the format of job files changes */
+static const char job_magic[] = "cswrap-job-1";
+
+/* queued jobs are prefixed by this, claimed jobs are moved to run/ */
+static const char job_prefix[] = "job-";
+
+/* one invocation of a tool recorded by queue_push() */
+struct job {
+    char                   *name;
+    char                   *data;
+    const char             *cwd;
+    const char             *tool;
+    const char             *history_key;
+    const char             *input_hash;
+    char                  **argv;
+    char                  **envp;
+    unsigned long           expected_ms;
+};
+
+/* environment variables that must not be propagated to the queued job */
+static bool is_env_dropped(const char *var)
+{
+    static const char *dropped[] = {
+        /* the job must run inline once it is drained */
+        "CSWRAP_DEFER_FOR=",
+        "CSWRAP_DEFER_QUEUE=",
+
+        /* argv[] of the job has been translated already */
+        "CSWRAP_ADD_CFLAGS=",
+        "CSWRAP_ADD_CXXFLAGS=",
+        "CSWRAP_DEL_CFLAGS=",
+        "CSWRAP_DEL_CXXFLAGS=",
+        "CSWRAP_RULES=",
+
+        /* file descriptors of the jobserver are not valid any more */
+        "MAKEFLAGS=",
+        "MFLAGS=",
+        NULL
+    };
+
+    const char **pstr;
+    for (pstr = dropped; *pstr; ++pstr)
+        if (!strncmp(var, *pstr, strlen(*pstr)))
+            return true;
+
+    return false;
+}
+
+/* return hash of names and contents of the input files as a hex string */
+static void hash_input_files(char buf[17], char **argv)
+{
+    uint64_t hash = HASH_INIT;
+    for (; *argv; ++argv) {
+        const char *arg = *argv;
+        if (!is_input_file(arg, /* enable_cxx */ true))
+            continue;
+
+        hash = hash_bytes(hash, arg, strlen(arg) + 1U);
+        const int fd = open(arg, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        char data[0x10000];
+        ssize_t len;
+        while (0 < (len = read(fd, data, sizeof data)))
+            hash = hash_bytes(hash, data, len);
+
+        close(fd);
+    }
+
+    snprintf(buf, 17U, "%016llx", (unsigned long long) hash);
+}
+
+/* write a NUL-terminated string to fp */
+static void put_str(FILE *fp, const char *str)
+{
+    fputs(str, fp);
+    fputc('\0', fp);
+}
+
+/* write a NULL-terminated vector of strings preceded by their count */
+static void put_vec(FILE *fp, char **vec, bool (*skip)(const char *))
+{
+    size_t cnt = 0U;
+    char **it;
+    for (it = vec; *it; ++it)
+        if (!skip || !skip(*it))
+            ++cnt;
+
+    fprintf(fp, "%zu", cnt);
+    fputc('\0', fp);
+    for (it = vec; *it; ++it)
+        if (!skip || !skip(*it))
+            put_str(fp, *it);
+}
+
+bool queue_push(const char *dir, const char *tool, char **argv,
+                const char *history_key)
+{
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof cwd))
+        return false;
+
+    if (mkdir(dir, 0775) && EEXIST != errno)
+        return false;
+
+    /* write the job into a temporary file */
+    char *tmp_name;
+    if (-1 == asprintf(&tmp_name, "%s/.job.XXXXXX", dir))
+        return false;
+
+    const int fd = mkstemp(tmp_name);
+    FILE *fp = (0 <= fd) ? fdopen(fd, "w") : NULL;
+    if (!fp) {
+        if (0 <= fd) {
+            close(fd);
+            unlink(tmp_name);
+        }
+        free(tmp_name);
+        return false;
+    }
+
+    char input_hash[17];
+    hash_input_files(input_hash, argv);
+
+    put_str(fp, job_magic);
+    put_str(fp, cwd);
+    put_str(fp, tool);
+    put_str(fp, (history_key) ? history_key : "");
+    put_str(fp, input_hash);
+    put_vec(fp, argv, NULL);
+    put_vec(fp, environ, is_env_dropped);
+
+    /* publish the job once it is completely written */
+    static unsigned seq;
+    char *name = NULL;
+    const bool ok = !fclose(fp)
+        && -1 != asprintf(&name, "%s/%s%lld-%d-%u", dir, job_prefix,
+                (long long) time(NULL), (int) getpid(), seq++)
+        && !rename(tmp_name, name);
+
+    if (!ok)
+        unlink(tmp_name);
+
+    free(name);
+    free(tmp_name);
+    return ok;
+}
+
+/* return the next NUL-terminated string from the job data, NULL at the end */
+static char *next_str(char **pcursor, const char *end)
+{
+    char *str = *pcursor;
+    if (end <= str)
+        return NULL;
+
+    *pcursor = str + strlen(str) + 1U;
+    return str;
+}
+
+/* parse a vector of strings preceded by their count */
+static char **next_vec(char **pcursor, const char *end)
+{
+    const char *str_cnt = next_str(pcursor, end);
+    size_t cnt;
+    char c;
+    if (!str_cnt || 1 != sscanf(str_cnt, "%zu%c", &cnt, &c)
+            || (size_t) (end - *pcursor) < cnt)
+        return NULL;
+
+    char **vec = calloc(cnt + 1U, sizeof *vec);
+    if (!vec)
+        return NULL;
+
+    size_t i;
+    for (i = 0U; i < cnt; ++i) {
+        if (!(vec[i] = next_str(pcursor, end))) {
+            free(vec);
+            return NULL;
+        }
+    }
+
+    return vec;
+}
+
+/* load the job file and estimate how long the job runs */
+static bool load_job(struct job *job, const char *dir, const char *name,
+                     const char *history_dir)
+{
+    memset(job, 0, sizeof *job);
+    job->name = strdup(name);
+    if (!job->name)
+        return false;
+
+    char *path;
+    if (-1 == asprintf(&path, "%s/%s", dir, name))
+        return false;
+
+    size_t size;
+    job->data = read_file(path, &size);
+    free(path);
+    if (!job->data || !size || job->data[size - 1U])
+        /* not a complete job file */
+        return false;
+
+    char *cursor = job->data;
+    const char *end = job->data + size;
+    const char *magic = next_str(&cursor, end);
+    if (!magic || !STREQ(magic, job_magic))
+        return false;
+
+    job->cwd = next_str(&cursor, end);
+    job->tool = next_str(&cursor, end);
+    job->history_key = next_str(&cursor, end);
+    job->input_hash = next_str(&cursor, end);
+    job->argv = next_vec(&cursor, end);
+    job->envp = next_vec(&cursor, end);
+    if (!job->envp || !job->argv || !job->argv[0])
+        return false;
+
+    /* jobs with unknown run time go first as they might be the longest */
+    job->expected_ms = ULONG_MAX;
+    struct history hist;
+    if (history_dir && job->history_key[0]
+            && history_load(history_dir, job->history_key, &hist))
+        job->expected_ms = history_percentile(&hist, 90U);
+
+    return true;
+}
+
+static void free_job(struct job *job)
+{
+    free(job->name);
+    free(job->data);
+    free(job->argv);
+    free(job->envp);
+}
+
+static int cmp_jobs_longest_first(const void *a, const void *b)
+{
+    const struct job *ja = a;
+    const struct job *jb = b;
+    return (ja->expected_ms < jb->expected_ms)
+        - (ja->expected_ms > jb->expected_ms);
+}
+
+/* return true if the name of a directory entry refers to a queued job */
+static int is_job_entry(const struct dirent *de)
+{
+    return MATCH_PREFIX(de->d_name, job_prefix);
+}
+
+/* load all jobs currently queued in dir, return their count */
+static size_t load_jobs(const char *dir, const char *history_dir,
+                        struct job **pjobs, unsigned *pfailed)
+{
+    struct dirent **names;
+    const int cnt = scandir(dir, &names, is_job_entry, alphasort);
+    if (cnt <= 0)
+        return 0U;
+
+    struct job *jobs = calloc(cnt, sizeof *jobs);
+    size_t loaded = 0U;
+    int i;
+    for (i = 0; i < cnt; ++i) {
+        const char *name = names[i]->d_name;
+        if (jobs && load_job(&jobs[loaded], dir, name, history_dir))
+            ++loaded;
+        else if (jobs) {
+            fprintf(stderr, "cswrap: warning: invalid job %s/%s removed\n",
+                    dir, name);
+            free_job(&jobs[loaded]);
+            char *path;
+            if (-1 != asprintf(&path, "%s/%s", dir, name)) {
+                unlink(path);
+                free(path);
+            }
+            ++*pfailed;
+        }
+
+        free(names[i]);
+    }
+
+    free(names);
+    *pjobs = jobs;
+    return loaded;
+}
+
+/* move the job to run/ so that no other drainer runs it */
+static bool claim_job(struct runner_job *rjob, FILE *err, void *ctx)
+{
+    const char *dir = ctx;
+    const struct job *job = rjob->data;
+    char *src, *dst;
+    if (-1 == asprintf(&src, "%s/%s", dir, job->name))
+        return false;
+    if (-1 == asprintf(&dst, "%s/run/%s", dir, job->name)) {
+        free(src);
+        return false;
+    }
+
+    const bool claimed = !rename(src, dst);
+    free(src);
+    free(dst);
+    if (!claimed)
+        /* taken by another drainer */
+        return false;
+
+    char input_hash[17];
+    hash_input_files(input_hash, job->argv);
+    if (!STREQ(input_hash, job->input_hash))
+        fprintf(err, "cswrap: warning: input files of %s have changed "
+                "since the job was queued\n", job->tool);
+
+    return true;
+}
+
+/* remove the finished job from run/ */
+static void remove_job(struct runner_job *rjob, void *ctx)
+{
+    const char *dir = ctx;
+    const struct job *job = rjob->data;
+    char *path;
+    if (-1 != asprintf(&path, "%s/run/%s", dir, job->name)) {
+        unlink(path);
+        free(path);
+    }
+}
+
+/* run the jobs longest first with up to max_jobs of them in parallel */
+static void drain_jobs(const char *dir, struct job *jobs, size_t cnt,
+                       unsigned max_jobs, struct runner_stats *stats)
+{
+    qsort(jobs, cnt, sizeof *jobs, cmp_jobs_longest_first);
+
+    struct runner_job *rjobs = calloc(cnt, sizeof *rjobs);
+    if (!rjobs)
+        return;
+
+    size_t i;
+    for (i = 0U; i < cnt; ++i) {
+        rjobs[i].cwd = jobs[i].cwd;
+        rjobs[i].argv = jobs[i].argv;
+        rjobs[i].envp = jobs[i].envp;
+        rjobs[i].data = &jobs[i];
+    }
+
+    static const struct runner_ops ops = {
+        .claim  = claim_job,
+        .done   = remove_job
+    };
+
+    run_jobs(rjobs, cnt, max_jobs, &ops, (void *) dir, stats);
+    free(rjobs);
+}
+
+int queue_drain(const char *dir, unsigned max_jobs, const char *history_dir)
+{
+    char *run_dir;
+    if (-1 == asprintf(&run_dir, "%s/run", dir))
+        return EXIT_FAILURE;
+
+    const int rv = mkdir(run_dir, 0775);
+    free(run_dir);
+    if (rv && EEXIST != errno) {
+        fprintf(stderr, "cswrap: error: failed to open queue in %s: %s\n",
+                dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* repeat until no jobs are queued, new ones may arrive meanwhile */
+    struct runner_stats stats = { 0U, 0U };
+    for (;;) {
+        struct job *jobs = NULL;
+        const size_t cnt = load_jobs(dir, history_dir, &jobs, &stats.failed);
+        if (!cnt) {
+            free(jobs);
+            break;
+        }
+
+        const unsigned total_before = stats.total;
+        drain_jobs(dir, jobs, cnt, max_jobs, &stats);
+
+        size_t i;
+        for (i = 0U; i < cnt; ++i)
+            free_job(&jobs[i]);
+        free(jobs);
+
+        if (stats.total == total_before)
+            /* no progress, jobs are taken by other drainers */
+            break;
+    }
+
+    printf("%u jobs drained, %u failed\n", stats.total, stats.failed);
+    return (stats.failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_QUEUE_H
+#define CSWRAP_QUEUE_H
+
+#include <stdbool.h>
+
+/* record invocation of the tool into the queue in dir to be run later on,
+ * history_key (if not NULL) is used to estimate how long the tool runs */
+bool queue_push(const char *dir, const char *tool, char **argv,
+                const char *history_key);
+
+/* run all jobs queued in dir using up to max_jobs processes in parallel,
+ * longest expected jobs first as per run times recorded in history_dir */
+int queue_drain(const char *dir, unsigned max_jobs, const char *history_dir);
+
+#endif /* CSWRAP_QUEUE_H */
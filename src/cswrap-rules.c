@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-rules.h"
+#include "cswrap-pathset.h"
+#include "cswrap-util.h"
+
+#include <errno.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* append str to the NULL-terminated array *parr */
+static bool append_str(char ***parr, const char *str)
+{
+    size_t cnt = 0U;
+    while (*parr && (*parr)[cnt])
+        ++cnt;
+
+    char **arr = realloc(*parr, (cnt + 2U) * sizeof *arr);
+    if (!arr)
+        return false;
+
+    *parr = arr;
+    arr[cnt] = strdup(str);
+    arr[cnt + 1U] = NULL;
+    return !!arr[cnt];
+}
+
+/* append colon-separated tools to the list *plist */
+static bool append_tools(char **plist, const char *tools)
+{
+    char *list;
+    if (*plist) {
+        if (-1 == asprintf(&list, "%s:%s", *plist, tools))
+            return false;
+    }
+    else if (!(list = strdup(tools)))
+        return false;
+
+    free(*plist);
+    *plist = list;
+    return true;
+}
+
+/* add the pattern to the path set of the rule, base_dir is used to resolve
+ * relative names of the lists of paths */
+static bool add_pattern(struct path_set *paths, const char *pattern,
+                        const char *base_dir)
+{
+    if ('@' == pattern[0]) {
+        /* list of paths, e.g. files changed by a patch */
+        const char *name = pattern + 1;
+        char *path = NULL;
+        if ('/' != name[0] && -1 != asprintf(&path, "%s/%s", base_dir, name))
+            name = path;
+
+        const bool ok = path_set_add_list(paths, name);
+        free(path);
+        return ok;
+    }
+
+    return path_set_add(paths, pattern);
+}
+
+/* parse one action of a rule, return false if it is not recognized */
+static bool parse_action(struct rule *rule, const char *action)
+{
+    const char *value = strchr(action, '=');
+    if (!value || !*++value)
+        return false;
+
+    if (MATCH_PREFIX(action, "add="))
+        return append_str(&rule->add, value);
+    if (MATCH_PREFIX(action, "del="))
+        return append_str(&rule->del, value);
+    if (MATCH_PREFIX(action, "enable="))
+        return append_tools(&rule->enable, value);
+    if (MATCH_PREFIX(action, "disable="))
+        return append_tools(&rule->disable, value);
+
+    return false;
+}
+
+/* parse a non-empty line "PATTERN ACTION..." into rule */
+static bool parse_rule(struct rule *rule, char *line, const char *base_dir)
+{
+    static const char delim[] = " \t";
+    char *save;
+    const char *pattern = strtok_r(line, delim, &save);
+
+    rule->paths = path_set_create();
+    if (!rule->paths || !add_pattern(rule->paths, pattern, base_dir))
+        return false;
+
+    path_set_finish(rule->paths);
+
+    const char *action;
+    bool has_action = false;
+    while ((action = strtok_r(NULL, delim, &save))) {
+        if (!parse_action(rule, action))
+            return false;
+
+        has_action = true;
+    }
+
+    return has_action;
+}
+
+static void free_rule(struct rule *rule)
+{
+    char **parg;
+    for (parg = rule->add; parg && *parg; ++parg)
+        free(*parg);
+    for (parg = rule->del; parg && *parg; ++parg)
+        free(*parg);
+
+    path_set_free(rule->paths);
+    free(rule->add);
+    free(rule->del);
+    free(rule->enable);
+    free(rule->disable);
+}
+
+struct rule *rules_load(const char *file, unsigned *perr_line)
+{
+    *perr_line = 0U;
+    FILE *fp = fopen(file, "r");
+    if (!fp)
+        return NULL;
+
+    char *dir_buf = strdup(file);
+    const char *base_dir = (dir_buf) ? dirname(dir_buf) : ".";
+
+    struct rule *rules = calloc(1U, sizeof *rules);
+    size_t cnt = 0U;
+    unsigned line_no = 0U;
+    char *line = NULL;
+    size_t line_size = 0U;
+    ssize_t len;
+    while (rules && 0 < (len = getline(&line, &line_size, fp))) {
+        ++line_no;
+        if ('\n' == line[len - 1])
+            line[--len] = '\0';
+
+        const char *str = line + strspn(line, " \t");
+        if (!*str || '#' == *str)
+            /* empty line or comment */
+            continue;
+
+        struct rule *tmp = realloc(rules, (cnt + 2U) * sizeof *rules);
+        if (!tmp) {
+            *perr_line = line_no;
+            break;
+        }
+
+        rules = tmp;
+        memset(&rules[cnt], 0, 2U * sizeof *rules);
+        if (!parse_rule(&rules[cnt], line, base_dir)) {
+            free_rule(&rules[cnt]);
+            memset(&rules[cnt], 0, sizeof *rules);
+            *perr_line = line_no;
+            break;
+        }
+
+        ++cnt;
+    }
+
+    free(line);
+    free(dir_buf);
+    fclose(fp);
+
+    if (*perr_line || !rules) {
+        rules_free(rules);
+        return NULL;
+    }
+
+    return rules;
+}
+
+bool rule_matches(const struct rule *rule, const char *path)
+{
+    return path_set_match(rule->paths, path);
+}
+
+void rules_free(struct rule *rules)
+{
+    struct rule *rule;
+    for (rule = rules; rule && rule->paths; ++rule)
+        free_rule(rule);
+
+    free(rules);
+}
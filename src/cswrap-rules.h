@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_RULES_H
+#define CSWRAP_RULES_H
+
+#include <stdbool.h>
+
+/* one line of $CSWRAP_RULES: what to do with input files matching paths */
+struct rule {
+    struct path_set        *paths;
+    char                  **add;        /* NULL-terminated flags to add */
+    char                  **del;        /* NULL-terminated globs to delete */
+    char                   *enable;     /* colon-separated tools or NULL */
+    char                   *disable;    /* colon-separated tools or NULL */
+};
+
+/* load rules from file, the array is terminated by a rule with no paths,
+ * return NULL on error and set *perr_line to the line that could not be
+ * parsed (zero if the file could not be read) */
+struct rule *rules_load(const char *file, unsigned *perr_line);
+
+/* return true if the rule applies to the given absolute path */
+bool rule_matches(const struct rule *rule, const char *path);
+
+/* release rules returned by rules_load() */
+void rules_free(struct rule *rules);
+
+#endif /* CSWRAP_RULES_H */
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-runner.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* start the job through cswrap itself, return false if it has not started */
+static bool start_job(struct runner_job *job, const struct runner_ops *ops,
+                      void *ctx)
+{
+    job->pid = 0;
+    job->status = 0x7F << 8;
+
+    /* output of each job is printed at once when the job finishes */
+    job->err = tmpfile();
+    if (!job->err)
+        return false;
+
+    if (ops && ops->claim && !ops->claim(job, job->err, ctx)) {
+        fclose(job->err);
+        job->err = NULL;
+        return false;
+    }
+
+    fflush(job->err);
+    job->pid = fork();
+    if (0 < job->pid)
+        return true;
+
+    if (job->pid < 0) {
+        job->pid = 0;
+        fclose(job->err);
+        job->err = NULL;
+        return false;
+    }
+
+    /* run the job with stdin from /dev/null and stderr to the temp file */
+    const int err_fd = fileno(job->err);
+    if (job->cwd && chdir(job->cwd)) {
+        dprintf(err_fd, "cswrap: error: failed to enter %s: %s\n",
+                job->cwd, strerror(errno));
+        _exit(0x7F);
+    }
+
+    const int null_fd = open("/dev/null", O_RDONLY);
+    if (dup2(null_fd, STDIN_FILENO) < 0 || dup2(err_fd, STDERR_FILENO) < 0)
+        _exit(0x7F);
+
+    execve("/proc/self/exe", job->argv, (job->envp) ? job->envp : environ);
+    fprintf(stderr, "cswrap: error: failed to run %s: %s\n", job->argv[0],
+            strerror(errno));
+    _exit(0x7F);
+}
+
+/* print output of the finished job to stderr */
+static void print_output(struct runner_job *job)
+{
+    if (!job->err)
+        return;
+
+    rewind(job->err);
+    char buf[0x1000];
+    size_t len;
+    while (0 < (len = fread(buf, 1U, sizeof buf, job->err)))
+        fwrite(buf, 1U, len, stderr);
+
+    fclose(job->err);
+    job->err = NULL;
+}
+
+void run_jobs(struct runner_job *jobs, size_t cnt, unsigned max_jobs,
+              const struct runner_ops *ops, void *ctx,
+              struct runner_stats *stats)
+{
+    const bool ordered = ops && ops->ordered;
+    size_t next = 0U, printed = 0U;
+    unsigned running = 0U;
+    while (next < cnt || running) {
+        const int signum = (ops && ops->interrupted) ? *ops->interrupted : 0;
+        if (next < cnt && running < max_jobs && !signum) {
+            /* start the next job in the order given by the caller */
+            struct runner_job *job = &jobs[next];
+            if (start_job(job, ops, ctx)) {
+                ++running;
+
+                /* the signal might have missed the job while it started */
+                if (ops && ops->interrupted && *ops->interrupted)
+                    kill(job->pid, *ops->interrupted);
+            }
+
+            ++next;
+            continue;
+        }
+
+        if (!running)
+            /* interrupted before all jobs have started */
+            break;
+
+        /* wait for any of the running jobs to finish */
+        int status;
+        const pid_t pid = wait(&status);
+        if (pid < 0) {
+            if (EINTR == errno)
+                continue;
+            break;
+        }
+
+        size_t i;
+        for (i = 0U; i < next; ++i) {
+            struct runner_job *job = &jobs[i];
+            if (job->pid != pid)
+                continue;
+
+            job->pid = 0;
+            job->status = status;
+            if (!ordered)
+                print_output(job);
+
+            if (ops && ops->done)
+                ops->done(job, ctx);
+
+            if (!WIFEXITED(status) || WEXITSTATUS(status))
+                ++stats->failed;
+
+            ++stats->total;
+            --running;
+            break;
+        }
+
+        /* print output of the leading jobs that have finished */
+        for (; ordered && printed < next && !jobs[printed].pid; ++printed)
+            print_output(&jobs[printed]);
+    }
+
+    /* the jobs left are not going to finish */
+    for (; printed < next; ++printed)
+        print_output(&jobs[printed]);
+}
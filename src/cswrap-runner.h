@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_RUNNER_H
+#define CSWRAP_RUNNER_H
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/* one tool to be run through cswrap as if it was invoked by the build */
+struct runner_job {
+    const char         *cwd;
+    char              **argv;       /* argv[0] names the tool to wrap */
+    char              **envp;       /* NULL means the current environment */
+    void               *data;       /* owned by the caller */
+    int                 status;     /* wait status once the job finished */
+
+    /* private to the runner */
+    pid_t               pid;
+    FILE               *err;
+};
+
+struct runner_ops {
+    /* called before the job starts, returning false skips the job, it may
+     * print a message for the job to err, which is printed with its output */
+    bool (*claim)(struct runner_job *job, FILE *err, void *ctx);
+
+    /* called once the job has finished */
+    void (*done)(struct runner_job *job, void *ctx);
+
+    /* print output of the jobs in the given order, not as they finish */
+    bool ordered;
+
+    /* once it holds a signal number, no more jobs are started and the jobs
+     * started afterwards are sent the signal, too */
+    volatile sig_atomic_t *interrupted;
+};
+
+/* statistics of jobs run by run_jobs() */
+struct runner_stats {
+    unsigned            total;
+    unsigned            failed;
+};
+
+/* run the jobs in the given order with up to max_jobs of them in parallel,
+ * output of each job is printed to stderr at once when the job finishes
+ * (or when all jobs before it have finished if ops->ordered is set) */
+void run_jobs(struct runner_job *jobs, size_t cnt, unsigned max_jobs,
+              const struct runner_ops *ops, void *ctx,
+              struct runner_stats *stats);
+
+#endif /* CSWRAP_RUNNER_H */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-stats.h"
+#include "cswrap-json.h"
+#include "cswrap-util.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+static struct timespec wrap_start;
+static pid_t owner;
+
+static unsigned long long lock_wait_us;
+static unsigned lock_waits;
+static unsigned long lines;
+
+static unsigned long long us_since(const struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000ULL
+        + (now.tv_nsec - since->tv_nsec) / 1000L;
+}
+
+static unsigned long long tv_to_us(const struct timeval *tv)
+{
+    return tv->tv_sec * 1000000ULL + tv->tv_usec;
+}
+
+void stats_start(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &wrap_start);
+    owner = getpid();
+}
+
+void stats_lock_wait(const struct timespec *since)
+{
+    lock_wait_us += us_since(since);
+    ++lock_waits;
+}
+
+void stats_count_line(void)
+{
+    ++lines;
+}
+
+void stats_write(const char *file, const char *tool, int status)
+{
+    if (owner != getpid())
+        /* called from a child process after fork() */
+        return;
+
+    /* CPU time consumed by the wrapper itself, not by the tool */
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru))
+        return;
+
+    char *rec = NULL;
+    size_t len = 0U;
+    FILE *mem = open_memstream(&rec, &len);
+    if (!mem)
+        return;
+
+    fprintf(mem, "{\"pid\": %d, \"tool\": ", (int) owner);
+    json_print_str(mem, tool);
+    fprintf(mem, ", \"status\": %d, \"wall_us\": %llu, \"cpu_us\": %llu, "
+            "\"lock_wait_us\": %llu, \"lock_waits\": %u, \"lines\": %lu}\n",
+            status, us_since(&wrap_start),
+            tv_to_us(&ru.ru_utime) + tv_to_us(&ru.ru_stime),
+            lock_wait_us, lock_waits, lines);
+    fclose(mem);
+
+    /* a single write() to an O_APPEND file keeps records of concurrent
+     * wrappers from interleaving */
+    const int fd = open(file, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (0 <= fd) {
+        if (write(fd, rec, len) != (ssize_t) len)
+            fprintf(stderr, "cswrap: warning: failed to write %s\n", file);
+        close(fd);
+    }
+
+    free(rec);
+}
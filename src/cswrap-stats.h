@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_STATS_H
+#define CSWRAP_STATS_H
+
+#include <time.h>
+
+/* remember when the wrapper started and which process writes the record */
+void stats_start(void);
+
+/* account a wait for the capture file lock that began at since */
+void stats_lock_wait(const struct timespec *since);
+
+/* count one more line of the tool's output */
+void stats_count_line(void);
+
+/* append a JSON Lines record of this invocation of the wrapper to file */
+void stats_write(const char *file, const char *tool, int status);
+
+#endif /* CSWRAP_STATS_H */
@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-status.h"
+#include "cswrap-json.h"
+#include "cswrap-util.h"
+
+#include <errno.h>
+#include <fcntl.h>                  /* for O_* constants */
+#include <signal.h>                 /* for kill() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char status_shm_name[] = "/cswrap_status";
+
+/* bump this whenever the layout of struct status_table changes */
+#define STATUS_MAGIC 0x63737702U
+
+#define STATUS_SLOTS 256U
+
+/* one running wrapper, owned by the process whose PID is stored in pid */
+struct status_slot {
+    pid_t               pid;
+    pid_t               child;
+    int                 state;
+    time_t              start;
+    unsigned long       lines;
+    char                tool[32];
+    char                files[216];
+};
+
+struct status_table {
+    unsigned            magic;
+    long long           admitted_ms;
+    struct status_slot  slots[STATUS_SLOTS];
+};
+
+static struct status_table *table;
+static struct status_slot *self;
+static unsigned long self_lines;
+
+static const char *state_names[] = {
+    [WS_FREE]           = "free",
+    [WS_STARTING]       = "starting",
+    [WS_WAIT_JOBS]      = "jobs",
+    [WS_WAIT_PRESSURE]  = "pressure",
+    [WS_WAIT_LOCK]      = "locking",
+    [WS_RUNNING]        = "running",
+    [WS_WAIT_CHILD]     = "waiting"
+};
+
+/* map the shared status table, create it if it does not exist yet */
+static bool map_table(bool create)
+{
+    const int flags = (create) ? (O_RDWR | O_CREAT) : O_RDONLY;
+    const int fd = shm_open(status_shm_name, flags, 0660);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) || (st.st_size < (off_t) sizeof *table
+                && (!create || ftruncate(fd, sizeof *table)))) {
+        close(fd);
+        return false;
+    }
+
+    const int prot = (create) ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *addr = mmap(NULL, sizeof *table, prot, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == addr)
+        return false;
+
+    table = addr;
+    if (create) {
+        /* a freshly created table is zero-filled, stamp it */
+        unsigned expected = 0U;
+        __atomic_compare_exchange_n(&table->magic, &expected, STATUS_MAGIC,
+                false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+
+    if (STATUS_MAGIC == __atomic_load_n(&table->magic, __ATOMIC_ACQUIRE))
+        return true;
+
+    /* table created by an incompatible version of cswrap */
+    munmap(table, sizeof *table);
+    table = NULL;
+    return false;
+}
+
+/* return true if the process owning the slot no longer exists */
+static bool slot_is_stale(pid_t pid)
+{
+    return kill(pid, 0) && ESRCH == errno;
+}
+
+/* claim a free slot, reclaim a stale one if all slots are taken */
+static struct status_slot *claim_slot(void)
+{
+    const pid_t pid = getpid();
+    unsigned i;
+    for (i = 0U; i < STATUS_SLOTS; ++i) {
+        pid_t expected = 0;
+        struct status_slot *slot = &table->slots[i];
+        if (__atomic_compare_exchange_n(&slot->pid, &expected, pid,
+                    false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return slot;
+    }
+
+    for (i = 0U; i < STATUS_SLOTS; ++i) {
+        struct status_slot *slot = &table->slots[i];
+        pid_t owner = __atomic_load_n(&slot->pid, __ATOMIC_RELAXED);
+        if (owner && slot_is_stale(owner)
+                && __atomic_compare_exchange_n(&slot->pid, &owner, pid,
+                    false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return slot;
+    }
+
+    /* the table is full */
+    return NULL;
+}
+
+/* store the space-separated list of input files into the slot */
+static void store_files(char *dst, size_t size, char **argv)
+{
+    size_t len = 0U;
+    for (; *argv; ++argv) {
+        const char *arg = *argv;
+        if (!is_input_file(arg, /* enable_cxx */ true))
+            continue;
+
+        const char *fmt = (len) ? " %s" : "%s";
+        const int rv = snprintf(dst + len, size - len, fmt, arg);
+        if (rv < 0 || size - len <= (size_t) rv)
+            /* list truncated */
+            break;
+
+        len += rv;
+    }
+}
+
+void status_register(const char *tool, char **argv)
+{
+    if (!map_table(/* create */ true))
+        return;
+
+    self = claim_slot();
+    if (!self)
+        return;
+
+    /* the slot is ours now, fill it before announcing it via state */
+    __atomic_store_n(&self->state, WS_FREE, __ATOMIC_RELAXED);
+    self->child = 0;
+    self->start = time(NULL);
+    self->lines = 0UL;
+    snprintf(self->tool, sizeof self->tool, "%s", tool);
+    memset(self->files, 0, sizeof self->files);
+    store_files(self->files, sizeof self->files, argv);
+    __atomic_store_n(&self->state, WS_STARTING, __ATOMIC_RELEASE);
+}
+
+void status_set_child(pid_t pid)
+{
+    if (self)
+        __atomic_store_n(&self->child, pid, __ATOMIC_RELAXED);
+}
+
+void status_set_state(enum wrap_state state)
+{
+    if (self)
+        __atomic_store_n(&self->state, state, __ATOMIC_RELEASE);
+}
+
+void status_count_line(void)
+{
+    if (self)
+        __atomic_store_n(&self->lines, ++self_lines, __ATOMIC_RELAXED);
+}
+
+bool status_claim_admission(long spacing_ms)
+{
+    if (!table)
+        /* nobody to coordinate with */
+        return true;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const long long now = ts.tv_sec * 1000LL + ts.tv_nsec / 1000000L;
+
+    long long last = __atomic_load_n(&table->admitted_ms, __ATOMIC_RELAXED);
+    if (last && now - last < spacing_ms)
+        /* someone else has just been admitted */
+        return false;
+
+    return __atomic_compare_exchange_n(&table->admitted_ms, &last, now,
+            false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+void status_unregister(void)
+{
+    if (!self || self->pid != getpid())
+        /* not registered or called from a child process after fork() */
+        return;
+
+    __atomic_store_n(&self->state, WS_FREE, __ATOMIC_RELEASE);
+    __atomic_store_n(&self->pid, 0, __ATOMIC_RELEASE);
+    self = NULL;
+}
+
+int print_status(bool json)
+{
+    if (!map_table(/* create */ false)) {
+        /* no wrapper has run since boot */
+        puts((json) ? "[]" : "no wrappers running");
+        return EXIT_SUCCESS;
+    }
+
+    const time_t now = time(NULL);
+    if (json)
+        putchar('[');
+    else
+        printf("%8s %8s %-9s %8s %8s  %s\n",
+                "PID", "CHILD", "STATE", "ELAPSED", "LINES", "TOOL [FILES]");
+
+    unsigned i;
+    bool first = true;
+    for (i = 0U; i < STATUS_SLOTS; ++i) {
+        /* take a snapshot of the slot so that we print consistent data */
+        const struct status_slot *slot = &table->slots[i];
+        const int state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+        struct status_slot snap = *slot;
+        snap.pid = __atomic_load_n(&slot->pid, __ATOMIC_RELAXED);
+        snap.tool[sizeof snap.tool - 1U] = '\0';
+        snap.files[sizeof snap.files - 1U] = '\0';
+        if (!snap.pid || state <= WS_FREE || WS_WAIT_CHILD < state
+                || slot_is_stale(snap.pid))
+            continue;
+
+        const long elapsed = (long) (now - snap.start);
+        if (!json) {
+            printf("%8d %8d %-9s %7lds %8lu  %s %s\n",
+                    snap.pid, snap.child, state_names[state], elapsed,
+                    snap.lines, snap.tool, snap.files);
+            continue;
+        }
+
+        printf("%s\n  {\"pid\": %d, \"child\": %d, \"state\": \"%s\", "
+                "\"start\": %lld, \"elapsed\": %ld, \"lines\": %lu, "
+                "\"tool\": ", (first) ? "" : ",", snap.pid, snap.child,
+                state_names[state], (long long) snap.start, elapsed,
+                snap.lines);
+        json_print_str(stdout, snap.tool);
+        printf(", \"files\": ");
+        json_print_str(stdout, snap.files);
+        putchar('}');
+        first = false;
+    }
+
+    if (json)
+        printf("%s]\n", (first) ? "" : "\n");
+
+    munmap(table, sizeof *table);
+    table = NULL;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSWRAP_STATUS_H
+#define CSWRAP_STATUS_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* what a running wrapper is doing, as shown by cswrap --status */
+enum wrap_state {
+    WS_FREE = 0,
+    WS_STARTING,
+    WS_WAIT_JOBS,
+    WS_WAIT_PRESSURE,
+    WS_WAIT_LOCK,
+    WS_RUNNING,
+    WS_WAIT_CHILD
+};
+
+/* claim a slot in the shared status table (best effort, silent on failure) */
+void status_register(const char *tool, char **argv);
+
+/* record PID of the wrapped tool */
+void status_set_child(pid_t pid);
+
+/* record what the wrapper is currently doing */
+void status_set_state(enum wrap_state state);
+
+/* count one more line of the tool's output read by the wrapper */
+void status_count_line(void);
+
+/* return true if no other wrapper was admitted within the last spacing_ms */
+bool status_claim_admission(long spacing_ms);
+
+/* release the slot claimed by status_register() */
+void status_unregister(void);
+
+/* print the list of running wrappers to stdout, return exit status */
+int print_status(bool json);
+
+#endif /* CSWRAP_STATUS_H */
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "cswrap-translate.h"
+#include "cswrap-util.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CSWRAP_API __attribute__((visibility("default")))
+
+struct cswrap_translator {
+    char               *cwd;
+    char               *tool;
+    unsigned            flags;
+
+    /* how many non-translated lines should not be shown */
+    int                 suppress_plain_lines;
+
+    /* incomplete line fed so far */
+    char               *in_buf;
+    size_t              in_len;
+    size_t              in_alloc;
+
+    /* translated lines, each of them terminated by NUL */
+    FILE               *out;
+    char               *out_buf;
+    size_t              out_len;
+    size_t              out_pos;
+
+    /* capture sink */
+    cswrap_sink_fn      cap_fn;
+    void               *cap_ctx;
+    FILE               *cap;
+    char               *cap_buf;
+    size_t              cap_len;
+};
+
+struct str_item {
+    const char *str;
+    size_t      len;
+};
+
+#define STR_ITEM(str) { str, sizeof(str) - 1U }
+
+static const struct str_item msg_prefixes[] = {
+    STR_ITEM("In file included from "),
+    STR_ITEM("                 from "),
+    { NULL, 0U }
+};
+
+CSWRAP_API
+struct cswrap_translator *cswrap_translator_new(const char *cwd,
+                                                const char *tool,
+                                                unsigned flags)
+{
+    struct cswrap_translator *tr = calloc(1U, sizeof *tr);
+    if (!tr)
+        return NULL;
+
+    tr->flags = flags;
+    tr->tool = strdup(tool);
+    if (cwd && '/' == cwd[0])
+        tr->cwd = strdup(cwd);
+    else if (cwd)
+        /* resolve the relative path now, it would not work later on */
+        tr->cwd = canonicalize_file_name(cwd);
+
+    if (!tr->tool || (cwd && !tr->cwd)) {
+        cswrap_translator_free(tr);
+        return NULL;
+    }
+
+    return tr;
+}
+
+CSWRAP_API
+void cswrap_translator_free(struct cswrap_translator *tr)
+{
+    if (!tr)
+        return;
+
+    if (tr->out)
+        fclose(tr->out);
+    if (tr->cap)
+        fclose(tr->cap);
+
+    free(tr->out_buf);
+    free(tr->cap_buf);
+    free(tr->in_buf);
+    free(tr->tool);
+    free(tr->cwd);
+    free(tr);
+}
+
+CSWRAP_API
+void cswrap_set_capture(struct cswrap_translator *tr, cswrap_sink_fn fn,
+                        void *ctx)
+{
+    tr->cap_fn = fn;
+    tr->cap_ctx = ctx;
+}
+
+/* return true if msg matches "[0-9:] note: " and the tool is clang analyzer */
+static bool clang_analyzer_note(const struct cswrap_translator *tr,
+                                const char *msg)
+{
+    if (!(tr->flags & CSWRAP_ANALYZER_NOTES))
+        return false;
+
+    for (; *msg; ++msg) {
+        const unsigned char c = *msg;
+        if (':' == c || isdigit(c))
+            continue;
+
+        if (' ' == c)
+            return !strncmp(msg, " note: ", sizeof " note: " - 1U);
+    }
+
+    return false;
+}
+
+/* return heap-allocated absolute path of the file if it can be read */
+static char *resolve_path(const struct cswrap_translator *tr,
+                          const char *file)
+{
+    char *path = NULL;
+    if (tr->cwd && '/' != file[0]) {
+        /* the tool does not run in our working directory */
+        if (-1 == asprintf(&path, "%s/%s", tr->cwd, file))
+            return NULL;
+
+        file = path;
+    }
+
+    char *abs_path = NULL;
+    if (0 == access(file, R_OK)) {
+        abs_path = canonicalize_file_name(file);
+        if (!abs_path && (ENOENT == errno) && (0 == access(file, R_OK)))
+            /* work around glibc/valgrind bug that causes realpath() to
+             * occasionally fail with ENOENT for no reason */
+            abs_path = canonicalize_file_name(file);
+    }
+
+    free(path);
+    return abs_path;
+}
+
+CSWRAP_API
+bool cswrap_translate_line(struct cswrap_translator *tr, const char *line,
+                           struct cswrap_line *res)
+{
+    memset(res, 0, sizeof *res);
+
+    const char *buf = line;
+    const struct str_item *item;
+    for (item = msg_prefixes; item->str; ++item) {
+        if (!strncmp(buf, item->str, item->len)) {
+            buf += item->len;
+            break;
+        }
+    }
+
+    const char *colon = strchr(buf, ':');
+    char *file = (colon) ? strndup(buf, colon - buf) : NULL;
+    if (file && !STREQ(file, tr->tool)) {
+        if ((tr->flags & CSWRAP_ANALYZER_NOTES)
+                && STREQ(file, "<scratch space>"))
+            /* clang uses <scratch space> as a placeholder for path in notes */
+            res->path = strdup(file);
+        else
+            res->path = resolve_path(tr, file);
+    }
+
+    free(file);
+    if (!res->path) {
+        /* the part up to the colon does not specify a file we can access */
+        if (0 < tr->suppress_plain_lines) {
+            --tr->suppress_plain_lines;
+            res->suppressed = true;
+        }
+
+        return false;
+    }
+
+    res->prefix_len = buf - line;
+    res->rest = colon;
+    if (clang_analyzer_note(tr, colon)) {
+        /* suppress the code snippet that follows immediately after the note */
+        tr->suppress_plain_lines = 2;
+        res->suppressed = true;
+    }
+    else
+        tr->suppress_plain_lines = 0;
+
+    return true;
+}
+
+CSWRAP_API
+void cswrap_write_line(FILE *fp, const char *line,
+                       const struct cswrap_line *res, const char *tool)
+{
+    if (!res->path) {
+        fputs(line, fp);
+        return;
+    }
+
+    /* write the prefix if any and absolute path */
+    fwrite(line, 1U, res->prefix_len, fp);
+    fputs(res->path, fp);
+
+    const size_t len = strlen(res->rest);
+    if (!len || res->rest[len - 1U] != '\n')
+        /* nothing useful remains to be printed */
+        return;
+
+    /* write the rest of the message without the trailing new-line */
+    fwrite(res->rest, 1U, len - 1U, fp);
+
+    /* write the " <--[tool]" suffix */
+    fprintf(fp, " <--[%s]\n", tool);
+}
+
+CSWRAP_API
+void cswrap_line_free(struct cswrap_line *res)
+{
+    free(res->path);
+    res->path = NULL;
+}
+
+/* translate one complete line and queue the result */
+static bool process_line(struct cswrap_translator *tr, const char *line)
+{
+    if (!tr->out && !(tr->out = open_memstream(&tr->out_buf, &tr->out_len)))
+        return false;
+
+    struct cswrap_line res;
+    cswrap_translate_line(tr, line, &res);
+    if (!res.suppressed) {
+        cswrap_write_line(tr->out, line, &res, tr->tool);
+        fputc('\0', tr->out);
+    }
+
+    if (tr->cap_fn) {
+        if (!tr->cap)
+            tr->cap = open_memstream(&tr->cap_buf, &tr->cap_len);
+
+        if (tr->cap) {
+            /* hand the captured line over to the sink */
+            rewind(tr->cap);
+            cswrap_write_line(tr->cap, line, &res, tr->tool);
+            fflush(tr->cap);
+            tr->cap_fn(tr->cap_buf, tr->cap_len, tr->cap_ctx);
+        }
+    }
+
+    cswrap_line_free(&res);
+    return !ferror(tr->out);
+}
+
+CSWRAP_API
+bool cswrap_feed(struct cswrap_translator *tr, const char *buf, size_t len)
+{
+    while (len) {
+        const char *nl = memchr(buf, '\n', len);
+        const size_t chunk = (nl) ? (size_t) (nl - buf + 1) : len;
+
+        /* append the chunk to the incomplete line */
+        if (tr->in_alloc < tr->in_len + chunk + 1U) {
+            size_t alloc = (tr->in_alloc) ? tr->in_alloc : 256U;
+            while (alloc < tr->in_len + chunk + 1U)
+                alloc <<= 1;
+
+            char *in_buf = realloc(tr->in_buf, alloc);
+            if (!in_buf)
+                return false;
+
+            tr->in_buf = in_buf;
+            tr->in_alloc = alloc;
+        }
+
+        memcpy(tr->in_buf + tr->in_len, buf, chunk);
+        tr->in_len += chunk;
+        tr->in_buf[tr->in_len] = '\0';
+        buf += chunk;
+        len -= chunk;
+
+        if (!nl)
+            /* wait for the rest of the line */
+            break;
+
+        tr->in_len = 0U;
+        if (!process_line(tr, tr->in_buf))
+            return false;
+    }
+
+    return true;
+}
+
+CSWRAP_API
+bool cswrap_finish(struct cswrap_translator *tr)
+{
+    if (!tr->in_len)
+        return true;
+
+    tr->in_len = 0U;
+    return process_line(tr, tr->in_buf);
+}
+
+CSWRAP_API
+const char *cswrap_next_line(struct cswrap_translator *tr, size_t *plen)
+{
+    if (!tr->out || fflush(tr->out) || tr->out_len <= tr->out_pos) {
+        if (tr->out && tr->out_pos) {
+            /* all lines have been read, reuse the buffer */
+            rewind(tr->out);
+            tr->out_pos = 0U;
+        }
+
+        return NULL;
+    }
+
+    const char *line = tr->out_buf + tr->out_pos;
+    const size_t len = strlen(line);
+    tr->out_pos += len + 1U;
+    if (plen)
+        *plen = len;
+
+    return line;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This file is part of cswrap.
+ *
+ * cswrap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cswrap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cswrap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* public API of libcswrap, which translates relative paths in diagnostic
+ * messages to absolute paths in the same way as the cswrap executable */
+
+#ifndef CSWRAP_TRANSLATE_H
+#define CSWRAP_TRANSLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct cswrap_translator;
+
+/* flags of cswrap_translator_new() */
+enum {
+    /* the tool runs as clang --analyze, drop its notes and their snippets
+     * from the translated output (they are still captured) */
+    CSWRAP_ANALYZER_NOTES = (1 << 0)
+};
+
+/* one line of output of the tool as seen by cswrap_translate_line() */
+struct cswrap_line {
+    size_t                  prefix_len; /* "In file included from " */
+    char                   *path;       /* absolute path, NULL if none */
+    const char             *rest;       /* ":1:2: warning: ..." */
+    bool                    suppressed; /* not to be shown */
+};
+
+/* callback receiving a NUL-terminated line of the capture, including the
+ * trailing new-line if there is one */
+typedef void (*cswrap_sink_fn)(const char *line, size_t len, void *ctx);
+
+/* create a translator of output of the tool running in cwd (the current
+ * working directory if NULL), return NULL on OOM */
+struct cswrap_translator *cswrap_translator_new(const char *cwd,
+                                                const char *tool,
+                                                unsigned flags);
+
+/* release the translator */
+void cswrap_translator_free(struct cswrap_translator *tr);
+
+/* send lines of the capture (with the " <--[tool]" suffix) to fn */
+void cswrap_set_capture(struct cswrap_translator *tr, cswrap_sink_fn fn,
+                        void *ctx);
+
+/* feed len bytes of output of the tool, return false on OOM */
+bool cswrap_feed(struct cswrap_translator *tr, const char *buf, size_t len);
+
+/* tell that the tool has finished, an incomplete line is processed as is */
+bool cswrap_finish(struct cswrap_translator *tr);
+
+/* return the next translated line, NULL if there is none, the line is valid
+ * until the next call of any function on tr */
+const char *cswrap_next_line(struct cswrap_translator *tr, size_t *plen);
+
+/* low-level API: translate one complete line, return true and fill *res if
+ * it refers to a file, res->suppressed is set in any case */
+bool cswrap_translate_line(struct cswrap_translator *tr, const char *line,
+                           struct cswrap_line *res);
+
+/* low-level API: write the line translated by cswrap_translate_line() */
+void cswrap_write_line(FILE *fp, const char *line,
+                       const struct cswrap_line *res, const char *tool);
+
+/* low-level API: release data of the line */
+void cswrap_line_free(struct cswrap_line *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CSWRAP_TRANSLATE_H */
@@ -21,7 +21,10 @@
 
 #include "cswrap-util.h"
 
-#include <limits.h>                 /* for PATH_MAX */
+#include <ctype.h>
+#include <fnmatch.h>
+#include <libgen.h>                 /* for basename() */
+#include <limits.h>                 /* for INT_MAX, PATH_MAX */
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -128,6 +131,152 @@ bool remove_self_from_path(const char *tool, char *path, const char *wrap)
     return found;
 }
 
+/* return heap-allocated canonicalized tool name, NULL if not found */
+static char* find_exe_in_dir(const char *base_name, const char *dir,
+                             const char *wrap, bool *self)
+{
+    /* concatenate dirname and basename */
+    char *raw_path;
+    if (-1 == asprintf(&raw_path, "%s/%s", dir, base_name))
+        return NULL;
+
+    /* canonicalize the resulting path */
+    char *exec_path = canonicalize_file_name(raw_path);
+    if (exec_path) {
+        /* check whether the file exists and we can execute it */
+        if (-1 == access(exec_path, X_OK))
+            goto fail;
+
+        if (STREQ(wrap, basename(exec_path))) {
+            /* do not execute self in order not to end up in an infinite loop */
+            *self = true;
+            goto fail;
+        }
+
+        free(exec_path);
+        return raw_path;
+    }
+
+fail:
+    free(exec_path);
+    free(raw_path);
+    return NULL;
+}
+
+char* find_tool_in_path(const char *base_name, char *path, const char *wrap)
+{
+    if (!path)
+        return NULL;
+
+    /* go through all paths in $PATH */
+    for (;;) {
+        char *term = strchr(path, ':');
+        if (term)
+            /* temporarily replace the separator by zero */
+            *term = '\0';
+
+        bool self = false;
+        char *exec_path = find_exe_in_dir(base_name, /* dir */ path, wrap,
+                &self);
+
+        if (term)
+            /* restore the original separator */
+            *term = ':';
+
+        if (exec_path)
+            /* found! */
+            return exec_path;
+
+        if (!term)
+            /* this was the last path in $PATH */
+            return NULL;
+
+        /* jump to the next path in $PATH */
+        char *const next = term + 1;
+
+        if (self)
+            /* remove self from $PATH */
+            memmove(path, next, strlen(next));
+        else
+            /* move the cursor */
+            path = next;
+    }
+}
+
+bool handle_flag(char ***pargv, const enum flag_op op, const char *flag)
+{
+    int argc = 0;
+    char **argv = *pargv;
+    while (*argv) {
+        if (FO_DEL == op && !fnmatch(flag, *argv, /* flags */ 0))
+            del_arg_from_argv(argv);
+        else {
+            ++argc;
+            ++argv;
+        }
+    }
+
+    if (FO_ADD != op)
+        /* unless we are adding a new flag, we are done */
+        return true;
+
+    argv = realloc(*pargv, (argc + 2) * sizeof(*argv));
+    if (argv)
+        *pargv = argv;
+    else {
+        /* out of memory */
+        free(*pargv);
+        return false;
+    }
+
+    char *flag_dup = strdup(flag);
+    if (!flag_dup)
+        /* out of memory */
+        return false;
+
+    argv[argc] = flag_dup;
+    argv[argc + 1] = NULL;
+    return true;
+}
+
+bool handle_cvar(
+        char                     ***pargv,
+        const enum flag_op          op,
+        const char                 *env_var_name)
+{
+    char *slist = getenv(env_var_name);
+    if (!slist || !slist[0])
+        return true;
+
+    /* go through all flags separated by ':' */
+    char *term;
+    for (;; /* jump to the next flag */ slist = term + 1) {
+        term = strchr(slist, ':');
+        if (term == slist)
+            /* flag resolved to an empty string, skip it! */
+            continue;
+
+        if (term)
+            /* temporarily replace the separator by zero */
+            *term = '\0';
+
+        /* go through the argument list */
+        const bool ok = handle_flag(pargv, op, slist);
+
+        if (term)
+            /* restore the original separator */
+            *term = ':';
+
+        if (!ok)
+            /* propagate the error back to the caller */
+            return false;
+
+        if (!term)
+            /* this was the last flag */
+            return true;
+    }
+}
+
 static bool is_input_file_suffix(const char *suffix, const bool enable_cxx)
 {
     if (STREQ(suffix, "c"))
@@ -249,6 +398,120 @@ bool is_ignored_file(const char *name)
     return false;
 }
 
+bool is_compiler_name(const char *base_name)
+{
+    return STREQ(base_name, "cc")
+        || STREQ(base_name, "c++")
+        || strstr(base_name, "gcc")
+        || strstr(base_name, "g++")
+        || strstr(base_name, "clang");
+}
+
+bool writes_output_files(char **argv, const bool compiler)
+{
+    bool analyze = false;
+    bool syntax_only = false;
+    bool text_output = false;
+    bool dev_null = false;
+
+    for (; *argv; ++argv) {
+        const char *arg = *argv;
+        const char *name = NULL;
+        if (STREQ(arg, "-o"))
+            name = (argv[1]) ? argv[1] : "";
+        else if (MATCH_PREFIX(arg, "--output-file="))
+            /* used by cppcheck */
+            name = strchr(arg, '=') + 1;
+        else if (compiler && MATCH_PREFIX(arg, "-o"))
+            name = arg + 2;
+
+        if (name) {
+            if (!STREQ(name, "/dev/null"))
+                return true;
+
+            dev_null = true;
+            continue;
+        }
+
+        if (MATCH_PREFIX(arg, "--plist-output")
+                || STREQ(arg, "-MD") || STREQ(arg, "-MMD")
+                || MATCH_PREFIX(arg, "-MF"))
+            /* dependency files and plist reports */
+            return true;
+
+        if (STREQ(arg, "--analyze"))
+            analyze = true;
+        else if (STREQ(arg, "-fsyntax-only"))
+            syntax_only = true;
+        else if (strstr(arg, "analyzer-output=text"))
+            text_output = true;
+    }
+
+    if (!compiler || syntax_only)
+        return false;
+
+    if (analyze)
+        /* clang --analyze writes *.plist files unless told otherwise */
+        return !dev_null && !text_output;
+
+    /* a compiler writes an object file, assembly, or a linked binary */
+    return !dev_null;
+}
+
+enum line_kind classify_line(const char *line)
+{
+    if (MATCH_PREFIX(line, "In file included from ")
+            || MATCH_PREFIX(line, "                 from "))
+        return LK_CONTEXT;
+
+    const char *colon = strchr(line, ':');
+    if (!colon)
+        return LK_PLAIN;
+
+    const char *str = colon + 1;
+    if (!isdigit((unsigned char) *str))
+        /* "f.c: In function 'main':" or "f.c: At top level:" */
+        return (MATCH_PREFIX(str, " In ") || MATCH_PREFIX(str, " At "))
+            ? LK_CONTEXT
+            : LK_PLAIN;
+
+    /* skip line and column numbers */
+    while (isdigit((unsigned char) *str) || ':' == *str)
+        ++str;
+
+    if (' ' != str[0])
+        return LK_PLAIN;
+
+    if (' ' == str[1] || MATCH_PREFIX(str, " note:"))
+        /* "f.c:1:2: note: ..." or "f.c:1:2:   required from here" */
+        return LK_NOTE;
+
+    return LK_PRIMARY;
+}
+
+char *read_file(const char *name, size_t *psize)
+{
+    FILE *fp = fopen(name, "r");
+    if (!fp)
+        return NULL;
+
+    char *data = NULL;
+    size_t size = 0U;
+    FILE *mem = open_memstream(&data, &size);
+    if (mem) {
+        char buf[0x1000];
+        size_t len;
+        while (0 < (len = fread(buf, 1U, sizeof buf, fp)))
+            fwrite(buf, 1U, len, mem);
+
+        fclose(mem);
+    }
+
+    fclose(fp);
+    *psize = size;
+    return data;
+}
+
 /* check that the only argument is @/tmp/... */
 bool invoked_by_lto_wrapper(char **argv)
 {
@@ -283,3 +546,41 @@ bool install_signal_handler(void (*hdl)(int), const int sig_list[])
     return true;
 }
 
+/* return the number of milliseconds remaining until the (monotonic) deadline */
+int ms_until(const struct timespec *deadline)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const long long ms = (deadline->tv_sec - now.tv_sec) * 1000LL
+        + (deadline->tv_nsec - now.tv_nsec) / 1000000L;
+
+    if (ms <= 0LL)
+        return 0;
+
+    return (INT_MAX < ms) ? INT_MAX : (int) ms;
+}
+
+/* return the number of milliseconds elapsed since the (monotonic) time */
+unsigned long ms_since(const struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const long long ms = (now.tv_sec - since->tv_sec) * 1000LL
+        + (now.tv_nsec - since->tv_nsec) / 1000000L;
+
+    return (ms < 0LL) ? 0UL : (unsigned long) ms;
+}
+
+/* update the hash by len bytes of data (64-bit FNV-1a) */
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *ptr = data;
+    const unsigned char *const end = ptr + len;
+    for (; ptr < end; ++ptr) {
+        hash ^= *ptr;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
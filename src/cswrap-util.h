@@ -21,11 +21,31 @@
 #define CSWRAP_UTIL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 
 #define STREQ(a, b) (!strcmp(a, b))
 
 #define MATCH_PREFIX(str, pref) (!strncmp(str, pref, sizeof(pref) - 1U))
 
+/* initial value of the hash computed by hash_bytes() */
+#define HASH_INIT 0xcbf29ce484222325ULL
+
+/* kind of a line of diagnostic output as seen by classify_line() */
+enum line_kind {
+    LK_PLAIN = 0,       /* code snippet, caret line, or anything else */
+    LK_CONTEXT,         /* "In file included from ...", "f.c: In function" */
+    LK_PRIMARY,         /* "f.c:1:2: warning: ..." */
+    LK_NOTE             /* "f.c:1:2: note: ..." */
+};
+
+/* operation on the argv array performed by handle_flag() */
+enum flag_op {
+    FO_ADD,
+    FO_DEL
+};
+
 /* delete the given argument from the argv array */
 void del_arg_from_argv(char **argv);
 
@@ -35,16 +55,47 @@ void tag_process_name(const char *prefix, const int argc, char *argv[]);
 /* remove all $PATH items where TOOL can be found after symlink dereference */
 bool remove_self_from_path(const char *tool, char *path, const char *wrap);
 
+/* return heap-allocated path of BASE_NAME found in PATH, NULL if not found;
+ * $PATH items where WRAP is found after symlink dereference are dropped */
+char* find_tool_in_path(const char *base_name, char *path, const char *wrap);
+
+/* add/del a single flag (or fnmatch() pattern) from the argv array */
+bool handle_flag(char ***pargv, enum flag_op op, const char *flag);
+
+/* add/del all ':'-separated flags found in ENV_VAR_NAME */
+bool handle_cvar(char ***pargv, enum flag_op op, const char *env_var_name);
+
 /* return true if the given arg looks like name of an input C/C++ file */
 bool is_input_file(const char *arg, bool enable_cxx);
 
 /* return true if the given input file name is ignored (e.g. autoconf test) */
 bool is_ignored_file(const char *name);
 
+/* return true if base_name looks like name of a C/C++ compiler driver */
+bool is_compiler_name(const char *base_name);
+
+/* return true if the tool writes files other than its diagnostic output */
+bool writes_output_files(char **argv, bool compiler);
+
+/* tell which part of a diagnostic block the line represents */
+enum line_kind classify_line(const char *line);
+
+/* read the whole file into a heap-allocated NUL-terminated buffer */
+char *read_file(const char *name, size_t *psize);
+
 /* return true if the arg vector indicates we are invoked by an LTO wrapper */
 bool invoked_by_lto_wrapper(char **argv);
 
 /* install signal handler hdl for signals in sig_list list terminated by 0 */
 bool install_signal_handler(void (*hdl)(int), const int sig_list[]);
 
+/* return the number of milliseconds remaining until the (monotonic) deadline */
+int ms_until(const struct timespec *deadline);
+
+/* return the number of milliseconds elapsed since the (monotonic) time */
+unsigned long ms_since(const struct timespec *since);
+
+/* update the hash by len bytes of data (64-bit FNV-1a) */
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t len);
+
 #endif /* CSWRAP_UTIL_H */
@@ -22,13 +22,31 @@
 /* for sem_timedwait() */
 #define _POSIX_C_SOURCE 200112L
 
+#include "cswrap-cache.h"
+#include "cswrap-capmerge.h"
+#include "cswrap-capstore.h"
+#include "cswrap-caprec.h"
+#include "cswrap-compdb.h"
+#include "cswrap-dedup.h"
+#include "cswrap-history.h"
+#include "cswrap-jobserver.h"
+#include "cswrap-json.h"
+#include "cswrap-pathset.h"
+#include "cswrap-ppcache.h"
+#include "cswrap-pressure.h"
+#include "cswrap-profile.h"
+#include "cswrap-queue.h"
+#include "cswrap-rules.h"
+#include "cswrap-runner.h"
+#include "cswrap-stats.h"
+#include "cswrap-status.h"
+#include "cswrap-translate.h"
 #include "cswrap-util.h"
 
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>           /* for O_* constants */
-#include <fnmatch.h>
 #include <libgen.h>
 #include <limits.h>
 #include <semaphore.h>       /* for named semaphores */
@@ -54,16 +72,34 @@ static const char prog_name[] = "cswrap";
 
 static unsigned tool_timeout;
 
+/* minimal count of recorded runs to derive the timeout from */
+#define HISTORY_MIN_RUNS 3U
+
+/* the timeout is this many times the 90th percentile of recorded run times */
+#define HISTORY_FACTOR 3U
+
+/* default of $CSWRAP_TIMEOUT_MIN [s] */
+#define HISTORY_FLOOR 60UL
+
+/* key of the run time history, NULL if $CSWRAP_TIMEOUT_HISTORY is not used */
+static char *history_key;
+
+/* count of recorded runs tool_timeout was derived from, zero if static */
+static unsigned history_runs;
+
+/* when the tool was started */
+static struct timespec tool_start;
+
 struct strlist {
     const char          *str;
     struct strlist      *next;
 };
 
-/* true if we are wrapping clang invoked with --analyze */
-static bool clang_analyzer;
+/* behavior specific to the tool being wrapped */
+static const struct tool_profile *profile;
 
-/* how many non-translated lines should not be written to stderr */
-static int suppress_plain_lines;
+/* translator of paths in output of the tool (libcswrap) */
+static struct cswrap_translator *translator;
 
 static struct strlist *file_list;
 
@@ -106,8 +142,26 @@ static int usage(char *argv[])
     \n\
     %s --help prints this text to standard error output.\n\
     \n\
-    %s --force-cap-file-unlock releases a stray lock (e.g. after crash)\n",
-    prog_name, prog_name, prog_name, prog_name, prog_name);
+    %s --force-cap-file-unlock releases a stray lock (e.g. after crash)\n\
+    \n\
+    %s --status [--json] lists wrappers that are currently running\n\
+    \n\
+    %s --cache-stats prints statistics of the cache in $CSWRAP_CACHE_DIR\n\
+    \n\
+    %s --dedup-release BUILD_ID frees memory used by $CSWRAP_DEDUP\n\
+    \n\
+    %s --drain-queue [-jN] runs the tools queued in $CSWRAP_DEFER_QUEUE\n\
+    \n\
+    %s --merge-compdb merges invocations recorded in $CSWRAP_COMPDB_DIR\n\
+    \n\
+    %s --replay TOOL [-jN] runs TOOL on invocations in $CSWRAP_COMPDB_DIR\n\
+    \n\
+    %s --merge-cap [--dedup] FILE... merges capture files to stdout\n\
+    \n\
+    %s --cap-store-dump prints current diagnostics in $CSWRAP_CAP_STORE\n",
+    prog_name, prog_name, prog_name, prog_name, prog_name, prog_name,
+    prog_name, prog_name, prog_name, prog_name, prog_name, prog_name,
+    prog_name);
 
     for (; *argv; ++argv)
         if (STREQ("--help", *argv))
@@ -121,14 +175,47 @@ static int usage(char *argv[])
 static FILE *cap_file;
 static const char *cap_file_name;
 
+/* write structured records to the capture file ($CSWRAP_CAP_FORMAT) */
+static bool cap_jsonl;
+
+/* diagnostics replace those of the previous run in $CSWRAP_CAP_STORE */
+static const char *cap_store_dir;
+static char *cap_store_key;
+static char *cap_store_buf;
+static size_t cap_store_len;
+static bool cap_store_armed;
+
+/* diagnostic blocks are buffered if deduplication, exclusion, or structured
+ * capture is enabled */
+static bool buffer_blocks;
+
 static sem_t *cap_file_lock;
 static const char cap_file_lock_name[] = "/cswrap_cap_file_lock";
 
 static void init_cap_file_name(void)
 {
     char *name = getenv("CSWRAP_CAP_FILE");
-    if (name && name[0])
+    if (cap_store_dir) {
+        /* the tool is about to produce its diagnostics */
+        cap_file_name = cap_store_dir;
+        cap_store_armed = true;
+    }
+    else if (name && name[0])
         cap_file_name = name;
+    else
+        return;
+
+    const char *format = getenv("CSWRAP_CAP_FORMAT");
+    if (!format || !format[0] || STREQ(format, "text"))
+        return;
+
+    if (STREQ(format, "jsonl")) {
+        /* records are written once the diagnostic block is complete */
+        cap_jsonl = true;
+        buffer_blocks = true;
+    }
+    else
+        warn("unknown value of $CSWRAP_CAP_FORMAT: %s", format);
 }
 
 static bool lock_cap_file(void)
@@ -149,7 +236,13 @@ static bool lock_cap_file(void)
             /* tv_sec   */ t_end,
             /* tv_nsec  */ 0L
         };
-        if (0 == sem_timedwait(cap_file_lock, &timeout))
+        struct timespec wait_start;
+        clock_gettime(CLOCK_MONOTONIC, &wait_start);
+        status_set_state(WS_WAIT_LOCK);
+        const int rv = sem_timedwait(cap_file_lock, &timeout);
+        status_set_state(WS_RUNNING);
+        stats_lock_wait(&wait_start);
+        if (0 == rv)
             /* semaphore successfully locked */
             return true;
 
@@ -206,6 +299,12 @@ static bool init_cap_file_once(void)
         /* capture file not enabled */
         return false;
 
+    if (cap_store_dir) {
+        /* collect the diagnostics, they are stored as a whole at the end */
+        cap_file = open_memstream(&cap_store_buf, &cap_store_len);
+        return !!cap_file;
+    }
+
     /* TODO: check there are no interferences between mock chroots */
     cap_file_lock = sem_open(cap_file_lock_name, O_CREAT, 0660, 1);
     if (!cap_file_lock) {
@@ -232,8 +331,33 @@ static bool init_cap_file_once(void)
     return true;
 }
 
+/* replace diagnostics of the previous run in $CSWRAP_CAP_STORE */
+static void release_cap_store(void)
+{
+    if (cap_file && fclose(cap_file))
+        fail("error writing diagnostics to %s", cap_store_dir);
+    cap_file = NULL;
+
+    /* no diagnostics means that those of the previous run are obsolete */
+    if (cap_store_armed && cap_store_key
+            && !cap_store_put(cap_store_dir, cap_store_key, cap_store_buf,
+                (cap_store_buf) ? cap_store_len : 0U))
+        fail("failed to store diagnostics in %s (%s)", cap_store_dir,
+                strerror(errno));
+
+    free(cap_store_buf);
+    cap_store_buf = NULL;
+    free(cap_store_key);
+    cap_store_key = NULL;
+}
+
 static void release_cap_file(void)
 {
+    if (cap_store_dir) {
+        release_cap_store();
+        return;
+    }
+
     if (!cap_file)
         /* nothing to close */
         return;
@@ -285,77 +409,6 @@ static int force_cap_file_unlock(void)
     return status;
 }
 
-/* return heap-allocated canonicalized tool name, NULL if not found */
-static char* find_exe_in_dir(const char *base_name, const char *dir, bool *self)
-{
-    /* concatenate dirname and basename */
-    char *raw_path;
-    if (-1 == asprintf(&raw_path, "%s/%s", dir, base_name))
-        return NULL;
-
-    /* canonicalize the resulting path */
-    char *exec_path = canonicalize_file_name(raw_path);
-    if (exec_path) {
-        /* check whether the file exists and we can execute it */
-        if (-1 == access(exec_path, X_OK))
-            goto fail;
-
-        if (STREQ(prog_name, basename(exec_path))) {
-            /* do not execute self in order not to end up in an infinite loop */
-            *self = true;
-            goto fail;
-        }
-
-        free(exec_path);
-        return raw_path;
-    }
-
-fail:
-    free(exec_path);
-    free(raw_path);
-    return NULL;
-}
-
-/* return heap-allocated canonicalized tool name, NULL if not found */
-static char* find_tool_in_path(const char *base_name, char *path)
-{
-    if (!path)
-        return NULL;
-
-    /* go through all paths in $PATH */
-    for (;;) {
-        char *term = strchr(path, ':');
-        if (term)
-            /* temporarily replace the separator by zero */
-            *term = '\0';
-
-        bool self = false;
-        char *exec_path = find_exe_in_dir(base_name, /* dir */ path, &self);
-
-        if (term)
-            /* restore the original separator */
-            *term = ':';
-
-        if (exec_path)
-            /* found! */
-            return exec_path;
-
-        if (!term)
-            /* this was the last path in $PATH */
-            return NULL;
-
-        /* jump to the next path in $PATH */
-        char *const next = term + 1;
-
-        if (self)
-            /* remove self from $PATH */
-            memmove(path, next, strlen(next));
-        else
-            /* move the cursor */
-            path = next;
-    }
-}
-
 static char** clone_argv(int argc, char *argv[])
 {
     size_t size = (argc + 1) * sizeof(*argv);
@@ -366,89 +419,9 @@ static char** clone_argv(int argc, char *argv[])
     return memcpy(dup, argv, size);
 }
 
-enum flag_op {
-    FO_ADD,
-    FO_DEL
-};
-
-/* add/del a single flag from the argv array */
-static bool handle_flag(char ***pargv, const enum flag_op op, const char *flag)
-{
-    int argc = 0;
-    char **argv = *pargv;
-    while (*argv) {
-        if (FO_DEL == op && !fnmatch(flag, *argv, /* flags */ 0))
-            del_arg_from_argv(argv);
-        else {
-            ++argc;
-            ++argv;
-        }
-    }
-
-    if (FO_ADD != op)
-        /* unless we are adding a new flag, we are done */
-        return true;
-
-    argv = realloc(*pargv, (argc + 2) * sizeof(*argv));
-    if (argv)
-        *pargv = argv;
-    else {
-        /* out of memory */
-        free(*pargv);
-        return false;
-    }
-
-    char *flag_dup = strdup(flag);
-    if (!flag_dup)
-        /* out of memory */
-        return false;
-
-    argv[argc] = flag_dup;
-    argv[argc + 1] = NULL;
-    return true;
-}
-
-static bool handle_cvar(
-        char                     ***pargv,
-        const enum flag_op          op,
-        const char                 *env_var_name)
-{
-    char *slist = getenv(env_var_name);
-    if (!slist || !slist[0])
-        return true;
-
-    /* go through all flags separated by ':' */
-    char *term;
-    for (;; /* jump to the next flag */ slist = term + 1) {
-        term = strchr(slist, ':');
-        if (term == slist)
-            /* flag resolved to an empty string, skip it! */
-            continue;
-
-        if (term)
-            /* temporarily replace the separator by zero */
-            *term = '\0';
-
-        /* go through the argument list */
-        const bool ok = handle_flag(pargv, op, slist);
-
-        if (term)
-            /* restore the original separator */
-            *term = ':';
-
-        if (!ok)
-            /* propagate the error back to the caller */
-            return false;
-
-        if (!term)
-            /* this was the last flag */
-            return true;
-    }
-}
-
 static bool translate_args(char ***pargv, const char *base_name)
 {
-    if (STREQ(base_name, "cppcheck"))
+    if (profile->flags & TP_KEEP_ARGS)
         /* do not translate args for cppcheck */
         return true;
 
@@ -482,282 +455,1333 @@ static bool seek_for_arg(const char *seek_arg, char **argv)
     return false;
 }
 
-/* return true if msg matches "[0-9:] note: " and clang_analyzer is true */
-static bool clang_analyzer_note(const char *msg)
+/* deduplication of diagnostic blocks across the build ($CSWRAP_DEDUP) */
+static bool dedup_enabled;
+static bool dedup_drop;
+
+/* diagnostic blocks located in excluded paths ($CSWRAP_EXCLUDE) */
+static struct path_set *exclude_set;
+static bool exclude_stderr;
+static unsigned long n_excluded;
+
+/* diagnostic block being buffered */
+static struct {
+    FILE       *err;
+    FILE       *cap;
+    char       *err_buf;
+    char       *cap_buf;
+    size_t      err_len;
+    size_t      cap_len;
+    long        err_prim[2];        /* range of the primary line in err_buf */
+    long        cap_prim[2];        /* range of the primary line in cap_buf */
+    bool        has_primary;
+    bool        in_primary;         /* the primary line is being written */
+    bool        excluded;           /* the primary line is in excluded path */
+    struct cap_record rec;          /* lines to capture as JSON Lines */
+} blk;
+
+/* return the stream translated messages are written to */
+static FILE *err_stream(void)
 {
-    if (!clang_analyzer)
-        return false;
-
-    for (; *msg; ++msg) {
-        const unsigned char c = *msg;
-        if (':' == c || isdigit(c))
-            continue;
+    if (!buffer_blocks)
+        return stderr;
 
-        if (' ' == c)
-            return MATCH_PREFIX(msg, " note: ");
-    }
+    if (!blk.err)
+        blk.err = open_memstream(&blk.err_buf, &blk.err_len);
 
-    return false;
+    return (blk.err) ? blk.err : stderr;
 }
 
-struct str_item {
-    const char *str;
-    size_t      len;
-};
-
-#define STR_ITEM(str) { str, sizeof(str) - 1U }
-
-static struct str_item msg_prefixes[] = {
-    STR_ITEM("In file included from "),
-    STR_ITEM("                 from "),
-    { NULL, 0U }
-};
-
-static void write_out(
-        FILE                       *fp,
-        char                       *buf_orig,
-        char                       *buf,
-        char                       *abs_path,
-        char                       *colon,
-        const char                 *tool)
+/* return the stream captured messages are written to, NULL if disabled */
+static FILE *cap_stream(void)
 {
-    /* write the prefix if any */
-    const char stash = buf[0];
-    buf[0] = '\0';
-    fputs(buf_orig, fp);
-    buf[0] = stash;
+    if (buffer_blocks && cap_file_name && !blk.cap)
+        blk.cap = open_memstream(&blk.cap_buf, &blk.cap_len);
 
-    /* write absolute path */
-    fputs(abs_path, fp);
+    if (blk.cap)
+        return blk.cap;
 
-    const size_t len = strlen(colon);
-    if (!len || colon[len - 1U] != '\n')
-        /* nothing useful remains to be printed */
-        return;
+    return (init_cap_file_once()) ? cap_file : NULL;
+}
 
-    /* write the rest of the message without the trailing new-line */
-    colon[len - 1U] = '\0';
-    fputs(colon, fp);
-    colon[len - 1U] = '\n';
+/* record the position in buffered output where the primary line starts/ends */
+static void mark_primary(int idx)
+{
+    blk.err_prim[idx] = (blk.err) ? ftell(blk.err) : 0L;
+    blk.cap_prim[idx] = (blk.cap) ? ftell(blk.cap) : 0L;
+    blk.has_primary = true;
+}
 
-    /* write the " <--[tool]" suffix */
-    fprintf(fp, " <--[%s]\n", tool);
+/* write the given range of a buffered block to fp */
+static void write_range(FILE *fp, const char *buf, long beg, long end)
+{
+    if (fp && buf && beg < end)
+        fwrite(buf + beg, 1U, end - beg, fp);
 }
 
-/* translate one line of a diagnostic message if an input file is matched */
-static bool translate_line(char *buf, const char *tool)
+/* write out the buffered block unless it has been already seen in the build
+ * or it is located in an excluded path */
+static void flush_block(void)
 {
-    char *const buf_orig = buf;
-    struct str_item *item;
-    for (item = msg_prefixes; item->str; ++item) {
-        if (!strncmp(buf, item->str, item->len)) {
-            buf += item->len;
-            break;
+    if (blk.err)
+        fclose(blk.err);
+    if (blk.cap)
+        fclose(blk.cap);
+
+    if (blk.excluded) {
+        /* keep the block only on stderr unless told otherwise */
+        ++n_excluded;
+        free(blk.cap_buf);
+        blk.cap_buf = NULL;
+        cap_record_clear(&blk.rec);
+        if (exclude_stderr) {
+            free(blk.err_buf);
+            blk.err_buf = NULL;
         }
     }
 
-    char *colon = strchr(buf, ':');
-    if (!colon)
-        /* no colon in this line, skip it! */
-        return false;
-
-    /* temporarily replace the colon by zero */
-    *colon = '\0';
-
-    if (STREQ(buf, tool)) {
-        /* explicitly excluded, skip this! */
-        *colon = ':';
-        return false;
+    bool dup = false;
+    if (dedup_enabled && blk.has_primary && blk.err_buf) {
+        /* the primary line and its notes, without the inclusion context */
+        const char *msg = blk.err_buf + blk.err_prim[0];
+        const size_t len = blk.err_len - blk.err_prim[0];
+        dup = dedup_seen(hash_bytes(HASH_INIT, msg, len));
     }
 
-    char *abs_path = NULL;
-    if (clang_analyzer && STREQ(buf, "<scratch space>"))
-        /* clang uses <scratch space> as a placeholder for path in note msgs */
-        abs_path = strdup(buf);
-
-    if (!abs_path && (-1 == access(buf, R_OK))) {
-        /* the part up to the colon does not specify a file we can access */
-        *colon = ':';
-        return false;
+    FILE *cap = ((blk.cap_buf || blk.rec.cnt) && init_cap_file_once())
+        ? cap_file
+        : NULL;
+    if (!dup) {
+        write_range(stderr, blk.err_buf, 0L, blk.err_len);
+        write_range(cap, blk.cap_buf, 0L, blk.cap_len);
+        if (cap && blk.rec.cnt)
+            cap_record_write(cap, &blk.rec, /* primary_only */ false);
+    }
+    else if (!dedup_drop) {
+        /* only the primary line refers to the duplicate */
+        write_range(stderr, blk.err_buf, blk.err_prim[0], blk.err_prim[1]);
+        write_range(cap, blk.cap_buf, blk.cap_prim[0], blk.cap_prim[1]);
+        if (cap && blk.rec.cnt)
+            cap_record_write(cap, &blk.rec, /* primary_only */ true);
     }
 
-    /* canonicalize the file name and restore the previously replaced colon */
-    if (!abs_path)
-        abs_path = canonicalize_file_name(buf);
-    if (!abs_path && (ENOENT == errno) && (0 == access(buf, R_OK)))
-        /* work around glibc/valgrind bug that causes realpath() to occasionally
-         * fail with ENOENT for no reason */
-        abs_path = canonicalize_file_name(buf);
+    cap_record_clear(&blk.rec);
+    free(blk.err_buf);
+    free(blk.cap_buf);
+    memset(&blk, 0, sizeof blk);
+}
 
-    *colon = ':';
-    if (!abs_path)
-        return false;
+/* write the line translated by libcswrap to stderr and the capture file */
+static void write_translated(const char *buf, const struct cswrap_line *res,
+                             const char *tool)
+{
+    if (blk.in_primary && exclude_set && path_set_match(exclude_set, res->path))
+        /* the whole block is going to be dropped */
+        blk.excluded = true;
 
-    if (clang_analyzer_note(colon))
-        /* suppress the code snippet that follows immediately after the note */
-        suppress_plain_lines = 2;
-    else {
+    if (!res->suppressed)
         /* write the translated message to stderr */
-        write_out(stderr, buf_orig, buf, abs_path, colon, tool);
-        suppress_plain_lines = 0;
+        cswrap_write_line(err_stream(), buf, res, tool);
+
+    if (cap_jsonl) {
+        /* keep the fields split out for the structured record */
+        cap_record_add(&blk.rec, tool, buf, res->prefix_len, res->path,
+                res->rest);
+        return;
     }
 
-    if (init_cap_file_once())
+    FILE *cap = cap_stream();
+    if (cap)
         /* write the message also to capture file if the feature is enabled */
-        write_out(cap_file, buf_orig, buf, abs_path, colon, tool);
-
-    free(abs_path);
-    return true;
+        cswrap_write_line(cap, buf, res, tool);
 }
 
-/* per-line handler of trans_paths_to_abs() */
-static void handle_line(char *buf, const char *tool)
+/* write one line of output of the tool, translated if possible */
+static void emit_line(char *buf, const char *tool)
 {
-    if (translate_line(buf, tool))
+    struct cswrap_line res;
+    if (cswrap_translate_line(translator, buf, &res)) {
+        write_translated(buf, &res, tool);
+        cswrap_line_free(&res);
         return;
+    }
 
-    if (0 < suppress_plain_lines)
-        --suppress_plain_lines;
-    else
-        fputs(buf, stderr);
+    if (!res.suppressed)
+        fputs(buf, err_stream());
 
-    if (init_cap_file_once())
+    if (cap_jsonl) {
+        cap_record_add(&blk.rec, tool, "", 0U, NULL, buf);
+        return;
+    }
+
+    FILE *cap = cap_stream();
+    if (cap)
         /* write the message also to capture file if the feature is enabled */
-        fputs(buf, cap_file);
+        fputs(buf, cap);
 }
 
-/* canonicalize paths the lines from stdin start with, write them to stderr */
-static void trans_paths_to_abs(const char *tool)
+/* rewriter of paths in structured diagnostics (-fdiagnostics-format=json) */
+static struct json_rewriter *json_rw;
+
+/* return heap-allocated "file://" URI of the absolute path */
+static char *path_to_uri(const char *path)
 {
-    /* handle the input from stdin line by line */
-    char *buf = NULL;
-    size_t buf_size = 0;
-    while (0 < getline(&buf, &buf_size, stdin))
-        handle_line(buf, tool);
+    char *uri = NULL;
+    size_t size = 0U;
+    FILE *mem = open_memstream(&uri, &size);
+    if (!mem)
+        return NULL;
 
-    /* release line buffer */
-    free(buf);
-}
+    fputs("file://", mem);
+    for (; *path; ++path) {
+        const unsigned char c = *path;
+        if (isalnum(c) || strchr("/-._~", c))
+            fputc(c, mem);
+        else
+            fprintf(mem, "%%%02X", c);
+    }
 
-static volatile pid_t tool_pid;
-static volatile sig_atomic_t timed_out;
+    fclose(mem);
+    return uri;
+}
 
-static void signal_handler(int signum)
+/* return heap-allocated path decoded from the relative or file:// URI */
+static char *uri_to_path(const char *uri)
 {
-    if (SIGCHLD == signum)
-        // SIGCHLD handler is only set for getline() to be interrupted by EINTR
-        return;
+    if (MATCH_PREFIX(uri, "file://"))
+        uri += sizeof "file://" - 1U;
+    else if (uri[strcspn(uri, ":/")] == ':')
+        /* a URI of another scheme */
+        return NULL;
 
-    if (!tool_pid)
-        return;
+    char *path = malloc(strlen(uri) + 1U);
+    if (!path)
+        return NULL;
 
-    if (SIGALRM == signum) {
-        /* timed out */
-        signum = SIGTERM;
-        timed_out = 1;
+    char *dst = path;
+    for (; *uri; ++uri) {
+        unsigned c;
+        if ('%' == uri[0] && isxdigit((unsigned char) uri[1])
+                && isxdigit((unsigned char) uri[2])
+                && 1 == sscanf(uri + 1, "%2x", &c)) {
+            *dst++ = c;
+            uri += 2;
+        }
+        else
+            *dst++ = *uri;
     }
 
-    const pid_t kill_pid = (use_pg)
-        ? /* clang process group */ -tool_pid
-        : tool_pid;
+    *dst = '\0';
+    return path;
+}
 
-    /* time elapsed, kill the tool now! */
-    const int saved_errno = errno;
-    kill(kill_pid, signum);
-    errno = saved_errno;
+/* json_rewrite_fn canonicalizing paths in GCC JSON and SARIF diagnostics */
+static char *rewrite_json_path(const char *key, const char *value, void *ctx)
+{
+    (void) ctx;
+    const bool uri = STREQ(key, "uri");
+    char *path = (uri) ? uri_to_path(value) : strdup(value);
+    if (!path)
+        return NULL;
+
+    char *abs_path = (access(path, R_OK)) ? NULL : canonicalize_file_name(path);
+    free(path);
+    if (!abs_path || !uri)
+        return abs_path;
+
+    char *result = path_to_uri(abs_path);
+    free(abs_path);
+    return result;
 }
 
-static bool install_signal_forwarder(void)
+/* enable rewriting of structured diagnostics if the tool is asked for them */
+static void init_json_rewriter(char *argv[])
 {
-    static int forwarded_signals[] = {
-        SIGALRM,
-        SIGCHLD,
-        SIGINT,
-        SIGPIPE,
-        SIGQUIT,
-        SIGTERM,
-        /* list terminator */ 0
+    static const char *const keys[] = {
+        "file",                     /* GCC JSON */
+        "uri",                      /* SARIF */
+        NULL
     };
 
-    return install_signal_handler(signal_handler, forwarded_signals);
+    /* the last -fdiagnostics-format= wins as it does with the compiler */
+    const char *fmt = NULL;
+    for (; *argv; ++argv)
+        if (MATCH_PREFIX(*argv, "-fdiagnostics-format="))
+            fmt = *argv + sizeof "-fdiagnostics-format=" - 1U;
+
+    if (fmt && (MATCH_PREFIX(fmt, "json") || MATCH_PREFIX(fmt, "sarif")))
+        json_rw = json_rewriter_create(keys, rewrite_json_path, NULL);
 }
 
-static bool timeout_disabled_for(const char *base_name, char *argv[])
+static void process_line(char *buf, const char *tool);
+
+/* pass the line through the JSON rewriter, the rest of the line that follows
+ * the end of the top-level JSON value is handled as a text line */
+static void handle_json_line(char *buf, const char *tool)
 {
-    const char *str_list = getenv("CSWRAP_TIMEOUT_FOR");
-    if (!str_list || !str_list[0])
-        /* CSWRAP_TIMEOUT_FOR is unset or empty */
-        return false;
+    /* JSON is not part of any diagnostic block */
+    flush_block();
 
-    if (STREQ(base_name, "clang") || STREQ(base_name, "clang++")) {
-        /* XXX: If $CSWRAP_TIMEOUT_FOR is set and we are wrapping clang or
-         * clang++, do not set the timeout unless it runs as the analyzer.
-         * Otherwise, we could unintententionally kill compiler or linker.
-         * FIXME: Implement the timeout in cscppc/csclng instead. */
-        if (!seek_for_arg("--analyze", argv))
-            /* --analyze not found in argv[] --> assume compiler/linker */
-            return true;
+    char *out = NULL;
+    size_t out_len = 0U;
+    FILE *mem = open_memstream(&out, &out_len);
+    if (!mem) {
+        fputs(buf, stderr);
+        return;
     }
 
-    if (STREQ(base_name, "gcc") && !seek_for_arg("-fanalyzer", argv))
-        /* CSWRAP_TIMEOUT_FOR="gcc" in fact means "gcc -fanalyzer" because
-         * we almost never want to kill the gcc compiler itself (and if we
-         * really wanted to, we would unset CSWRAP_TIMEOUT_FOR to override
-         * this quirk). */
-        return true;
+    const size_t len = strlen(buf);
+    size_t done = json_rewriter_feed(json_rw, buf, len, mem);
+    if (done < len && STREQ(buf + done, "\n")) {
+        /* keep the new-line that terminates the JSON text */
+        fputc('\n', mem);
+        ++done;
+    }
 
-    const size_t len = strlen(base_name);
+    fclose(mem);
+    FILE *cap = (init_cap_file_once()) ? cap_file : NULL;
+    write_range(stderr, out, 0L, out_len);
+    if (cap && cap_jsonl) {
+        /* JSON Lines cannot hold multi-line text, capture it line by line */
+        char *line, *save;
+        for (line = strtok_r(out, "\n", &save); line;
+                line = strtok_r(NULL, "\n", &save))
+            cap_record_write_text(cap, tool, line);
+    }
+    else
+        write_range(cap, out, 0L, out_len);
+    free(out);
 
-    /* go through colon-separated list of programs in $CSWRAP_TIMEOUT_FOR */
-    const char *prog = str_list;
-    for (;;) {
-        const char *term = strchr(prog, ':');
-        if (!term)
-            /* compare the last item in the list */
-            return !STREQ(prog, base_name);
+    if (done < len)
+        process_line(buf + done, tool);
+}
 
-        if ((prog + len == term) && !strncmp(prog, base_name, len))
-            /* timeout explicitly enabled for base_name */
-            return false;
+/* per-line handler of trans_paths_to_abs() */
+static void handle_line(char *buf, const char *tool)
+{
+    status_count_line();
+    stats_count_line();
 
-        prog = term + 1;
-    }
+    /* record the line as emitted by the tool if the cache is enabled */
+    cache_store_line(buf);
+    process_line(buf, tool);
 }
 
-static int install_timeout_handler(const char *base_name, char *argv[])
+/* translate the line, or buffer it as part of a diagnostic block */
+static void process_line(char *buf, const char *tool)
 {
-    const char *str_time = getenv("CSWRAP_TIMEOUT");
-    if (!str_time || !str_time[0] || timeout_disabled_for(base_name, argv))
-        /* no timeout requested */
-        return EXIT_SUCCESS;
+    if (json_rw && (json_rewriter_busy(json_rw) || '[' == buf[0]
+                || '{' == buf[0])) {
+        /* structured diagnostics */
+        handle_json_line(buf, tool);
+        return;
+    }
 
-    /* parse the timeout value */
-    long timeout;
-    char c;
-    if (1 != sscanf(str_time, "%li%c", &timeout, &c))
-        return fail("unable to parse the value of $CSWRAP_TIMEOUT");
+    if (!buffer_blocks) {
+        emit_line(buf, tool);
+        return;
+    }
 
-    if (UINT_MAX < timeout || timeout <= 0L)
-        return fail("the value of $CSWRAP_TIMEOUT is out of range");
+    const enum line_kind kind = classify_line(buf);
+    if (blk.has_primary && (LK_CONTEXT == kind || LK_PRIMARY == kind))
+        /* the line starts a new diagnostic block */
+        flush_block();
 
-    /* activate the timeout! */
-    tool_timeout = timeout;
-    alarm(tool_timeout);
-    return EXIT_SUCCESS;
+    if (LK_PRIMARY != kind) {
+        emit_line(buf, tool);
+        return;
+    }
+
+    mark_primary(0);
+    blk.in_primary = true;
+    emit_line(buf, tool);
+    blk.in_primary = false;
+    mark_primary(1);
 }
 
-static void emit_kill_msg(int signum, const char *base_name, const char *file)
+/* enable deduplication of diagnostic blocks per $CSWRAP_DEDUP */
+static void init_dedup(void)
 {
-    char *msg;
-    static const char event[] = "internal warning";
-    const int rv = (timed_out)
-        ? asprintf(&msg, "%s: %s: child %d timed out after %us\n",
-                file, event, tool_pid, tool_timeout)
-        : asprintf(&msg, "%s: %s: child %d terminated by signal %d\n",
-                file, event, tool_pid, signum);
-
-    if (-1 == rv)
-        /* OOM */
+    const char *build_id = getenv("CSWRAP_DEDUP");
+    if (!build_id || !build_id[0])
+        /* deduplication not enabled */
+        return;
+
+    if (!dedup_attach(build_id)) {
+        warn("unable to deduplicate diagnostics of build %s", build_id);
+        return;
+    }
+
+    const char *drop = getenv("CSWRAP_DEDUP_DROP");
+    dedup_drop = drop && drop[0];
+    dedup_enabled = true;
+    buffer_blocks = true;
+}
+
+/* load the set of excluded paths from $CSWRAP_EXCLUDE */
+static void init_exclude(void)
+{
+    char *slist = getenv("CSWRAP_EXCLUDE");
+    if (!slist || !slist[0])
+        /* exclusion not enabled */
+        return;
+
+    exclude_set = path_set_create();
+    if (!exclude_set)
+        return;
+
+    /* go through all patterns separated by ':' */
+    char *term;
+    bool ok = true;
+    for (; ok; slist = term + 1) {
+        term = strchr(slist, ':');
+        if (term)
+            /* temporarily replace the separator by zero */
+            *term = '\0';
+
+        ok = path_set_add(exclude_set, slist);
+
+        if (!term)
+            /* this was the last pattern */
+            break;
+
+        /* restore the original separator */
+        *term = ':';
+    }
+
+    if (!ok) {
+        warn("insufficient memory to load $CSWRAP_EXCLUDE");
+        path_set_free(exclude_set);
+        exclude_set = NULL;
+        return;
+    }
+
+    path_set_finish(exclude_set);
+    const char *str_stderr = getenv("CSWRAP_EXCLUDE_STDERR");
+    exclude_stderr = str_stderr && str_stderr[0];
+    buffer_blocks = true;
+}
+
+/* report how many blocks have been dropped because of $CSWRAP_EXCLUDE */
+static void report_excluded(const char *base_name)
+{
+    if (!n_excluded)
+        return;
+
+    fprintf(stderr, "%s: note: %lu diagnostic%s in excluded paths not %s "
+            "<--[%s]\n", prog_name, n_excluded, (1UL == n_excluded) ? "" : "s",
+            (exclude_stderr) ? "shown" : "captured", base_name);
+}
+
+/* limits on the volume of output per invocation ($CSWRAP_MAX_{LINES,BYTES}) */
+static unsigned long max_lines;
+static unsigned long max_bytes;
+static unsigned long n_lines;
+static unsigned long n_bytes;
+
+/* lines and diagnostics drained without translation once a limit is hit */
+static unsigned long n_drained_lines;
+static unsigned long n_drained_diags;
+
+/* parse value of the given env var into *pval, zero means no limit */
+static void read_volume_limit(unsigned long *pval, const char *env_var_name)
+{
+    const char *str = getenv(env_var_name);
+    if (!str || !str[0])
+        return;
+
+    char c;
+    if (1 != sscanf(str, "%lu%c", pval, &c)) {
+        warn("unable to parse the value of $%s", env_var_name);
+        *pval = 0UL;
+    }
+}
+
+static void init_volume_limits(void)
+{
+    read_volume_limit(&max_lines, "CSWRAP_MAX_LINES");
+    read_volume_limit(&max_bytes, "CSWRAP_MAX_BYTES");
+}
+
+/* pass the line to handle_line() unless a volume limit has been reached */
+static void limit_line(char *buf, size_t len, const char *tool)
+{
+    if (!n_drained_lines) {
+        ++n_lines;
+        n_bytes += len;
+        if ((!max_lines || n_lines <= max_lines)
+                && (!max_bytes || n_bytes <= max_bytes)) {
+            handle_line(buf, tool);
+            return;
+        }
+
+        /* the output is incomplete from now on, do not cache it */
+        cache_store_abort();
+
+        /* write out the block that has been cut by the limit and release
+         * the capture file (and its lock) while the rest is drained */
+        flush_block();
+        if (!cap_store_dir)
+            release_cap_file();
+    }
+
+    /* only count what we drain so that the tool never blocks on the pipe */
+    ++n_drained_lines;
+    if (LK_PRIMARY == classify_line(buf))
+        ++n_drained_diags;
+}
+
+/* tell how much output has been suppressed, the capture file is locked
+ * again only to write the note */
+static void emit_volume_summary(const char *tool)
+{
+    if (!n_drained_lines)
+        return;
+
+    /* name the input file only if the output comes from a single one, the
+     * name of the tool is not translated so it is decorated here */
+    const bool one_file = file_list && !file_list->next;
+    char *msg;
+    if (-1 != asprintf(&msg, "%s: note: %lu further diagnostic%s "
+                "suppressed (%lu lines over the limit)%s%s%s\n",
+                (one_file) ? file_list->str : tool,
+                n_drained_diags, (1UL == n_drained_diags) ? "" : "s",
+                n_drained_lines, (one_file) ? "" : " <--[",
+                (one_file) ? "" : tool, (one_file) ? "" : "]")) {
+        handle_line(msg, tool);
+        free(msg);
+    }
+
+    n_drained_lines = 0UL;
+    n_drained_diags = 0UL;
+}
+
+/* canonicalize paths the lines from stdin start with, write them to stderr */
+static void trans_paths_to_abs(const char *tool)
+{
+    /* handle the input from stdin line by line */
+    char *buf = NULL;
+    size_t buf_size = 0;
+    ssize_t len;
+    while (0 < (len = getline(&buf, &buf_size, stdin)))
+        limit_line(buf, len, tool);
+
+    emit_volume_summary(tool);
+
+    /* release line buffer */
+    free(buf);
+}
+
+static volatile pid_t tool_pid;
+static volatile sig_atomic_t timed_out;
+
+/* signal received while there was no child to forward it to */
+static volatile sig_atomic_t pending_signum;
+
+/* jobs of fan_out_tool() while they run, signals are forwarded to them */
+static struct runner_job *volatile fanout_jobs;
+static volatile size_t fanout_cnt;
+
+/* forward the signal to all running jobs of fan_out_tool() */
+static void forward_to_fanout_jobs(int signum)
+{
+    struct runner_job *jobs = fanout_jobs;
+    if (!jobs)
+        return;
+
+    const int saved_errno = errno;
+    size_t i;
+    for (i = 0U; i < fanout_cnt; ++i) {
+        const pid_t pid = jobs[i].pid;
+        if (0 < pid)
+            kill(pid, signum);
+    }
+    errno = saved_errno;
+}
+
+static void signal_handler(int signum)
+{
+    if (SIGCHLD == signum)
+        // SIGCHLD handler is only set for getline() to be interrupted by EINTR
+        return;
+
+    if (!tool_pid) {
+        if (SIGALRM != signum) {
+            pending_signum = signum;
+            forward_to_fanout_jobs(signum);
+            kill_preprocessor(signum);
+        }
+        return;
+    }
+
+    if (SIGALRM == signum) {
+        /* timed out */
+        signum = SIGTERM;
+        timed_out = 1;
+    }
+
+    const pid_t kill_pid = (use_pg)
+        ? /* clang process group */ -tool_pid
+        : tool_pid;
+
+    /* time elapsed, kill the tool now! */
+    const int saved_errno = errno;
+    kill(kill_pid, signum);
+    errno = saved_errno;
+}
+
+static bool install_signal_forwarder(void)
+{
+    static int forwarded_signals[] = {
+        SIGALRM,
+        SIGCHLD,
+        SIGHUP,
+        SIGINT,
+        SIGPIPE,
+        SIGQUIT,
+        SIGTERM,
+        /* list terminator */ 0
+    };
+
+    return install_signal_handler(signal_handler, forwarded_signals);
+}
+
+/* return true if base_name is listed in str_list and runs as an analyzer */
+static bool tool_in_list(const char *str_list, const char *base_name,
+                         char *argv[])
+{
+    const struct tool_profile *prof = profile_lookup(base_name);
+    if (prof->analyzer_arg && !seek_for_arg(prof->analyzer_arg, argv))
+        /* XXX: If we are wrapping clang or clang++, do not treat it as
+         * listed unless it runs as the analyzer.  Otherwise, we could
+         * unintententionally kill (or throttle) compiler or linker.
+         * Similarly, "gcc" in the list in fact means "gcc -fanalyzer"
+         * because we almost never want to kill the gcc compiler itself (and
+         * if we really wanted to, we would unset CSWRAP_TIMEOUT_FOR to
+         * override this quirk).
+         * FIXME: Implement the timeout in cscppc/csclng instead. */
+        return false;
+
+    const size_t len = strlen(base_name);
+
+    /* go through colon-separated list of programs in str_list */
+    const char *prog = str_list;
+    for (;;) {
+        const char *term = strchr(prog, ':');
+        if (!term)
+            /* compare the last item in the list */
+            return STREQ(prog, base_name);
+
+        if ((prog + len == term) && !strncmp(prog, base_name, len))
+            /* base_name explicitly listed */
+            return true;
+
+        prog = term + 1;
+    }
+}
+
+static bool timeout_disabled_for(const char *base_name, char *argv[])
+{
+    const char *str_list = getenv("CSWRAP_TIMEOUT_FOR");
+    if (!str_list || !str_list[0])
+        /* CSWRAP_TIMEOUT_FOR is unset or empty */
+        return false;
+
+    return !tool_in_list(str_list, base_name, argv);
+}
+
+/* return true if the tool is listed in $CSWRAP_HEAVY_FOR */
+static bool is_heavy_tool(const char *base_name, char *argv[])
+{
+    const char *str_list = getenv("CSWRAP_HEAVY_FOR");
+    if (!str_list || !str_list[0])
+        /* CSWRAP_HEAVY_FOR is unset or empty */
+        return false;
+
+    return tool_in_list(str_list, base_name, argv);
+}
+
+/* delay start of a heavy tool while the system is under pressure */
+static int wait_for_low_pressure(void)
+{
+    const char *str_limit = getenv("CSWRAP_PRESSURE_LIMIT");
+    if (!str_limit || !str_limit[0])
+        /* no limit set */
+        return EXIT_SUCCESS;
+
+    /* parse the limits given as MEMORY[:CPU] */
+    struct pressure_limit limit = { 0.0, 0.0 };
+    char c;
+    const int rv = sscanf(str_limit, "%lf%c%lf%c",
+            &limit.memory, &c, &limit.cpu, &c);
+    if ((1 != rv && 3 != rv) || (3 == rv && ':' != c))
+        return fail("unable to parse the value of $CSWRAP_PRESSURE_LIMIT");
+
+    if (limit.memory < 0.0 || 100.0 < limit.memory
+            || limit.cpu < 0.0 || 100.0 < limit.cpu)
+        return fail("the value of $CSWRAP_PRESSURE_LIMIT is out of range");
+
+    wait_for_pressure_relief(&limit, &pending_signum);
+    if (!pending_signum)
+        return EXIT_SUCCESS;
+
+    fail("interrupted by signal %d while waiting for low pressure",
+            (int) pending_signum);
+    return 0x80 + pending_signum;
+}
+
+/* occupy $CSWRAP_HEAVY_JOBS job slots of make's jobserver */
+static int acquire_job_tokens(void)
+{
+    if (!jobserver_connect())
+        /* nothing to acquire */
+        return EXIT_SUCCESS;
+
+    long jobs = /* default */ 2L;
+    const char *str_jobs = getenv("CSWRAP_HEAVY_JOBS");
+    if (str_jobs && str_jobs[0]) {
+        char c;
+        if (1 != sscanf(str_jobs, "%li%c", &jobs, &c))
+            return fail("unable to parse the value of $CSWRAP_HEAVY_JOBS");
+
+        if (jobs < 1L || 64L < jobs)
+            return fail("the value of $CSWRAP_HEAVY_JOBS is out of range");
+    }
+
+    /* one job slot is already occupied by us on behalf of make */
+    status_set_state(WS_WAIT_JOBS);
+    jobserver_acquire(jobs - 1L, &pending_signum);
+    status_set_state(WS_STARTING);
+
+    if (!pending_signum)
+        return EXIT_SUCCESS;
+
+    /* interrupted while waiting for the job tokens */
+    jobserver_release();
+    fail("interrupted by signal %d while waiting for job tokens",
+            (int) pending_signum);
+    return 0x80 + pending_signum;
+}
+
+/* delay start of a heavy tool until the system can take it */
+static int admit_heavy_tool(const char *base_name, char *argv[])
+{
+    if (!is_heavy_tool(base_name, argv))
+        return EXIT_SUCCESS;
+
+    /* do not hold job tokens while waiting for the pressure to drop */
+    const int status = wait_for_low_pressure();
+    if (EXIT_SUCCESS != status)
+        return status;
+
+    return acquire_job_tokens();
+}
+
+/* preprocessed file the tool reads instead of its source file (if any) */
+static char *shared_tu;
+
+/* diagnostics of the preprocessor that produced shared_tu */
+static char *shared_tu_err;
+
+/* return the only source file of an analysis-only compiler invocation */
+static const char *find_analyzed_source(const char *base_name, char *argv[])
+{
+    if (!is_compiler_name(base_name)
+            || writes_output_files(argv, /* compiler */ true))
+        return NULL;
+
+    const char *src = NULL;
+    for (++argv; *argv; ++argv) {
+        const char *arg = *argv;
+        if (MATCH_PREFIX(arg, "-x"))
+            /* language given explicitly, better not to touch it */
+            return NULL;
+
+        if (!is_input_file(arg, /* enable_cxx */ true))
+            continue;
+
+        if (src)
+            /* more than one source file */
+            return NULL;
+
+        src = arg;
+    }
+
+    return src;
+}
+
+/* feed the tool with the preprocessed file in $CSWRAP_PP_CACHE_DIR */
+static void use_shared_tu(const char *base_name, const char *exec_path,
+                          char ***pargv)
+{
+    const char *dir = getenv("CSWRAP_PP_CACHE_DIR");
+    if (!dir || !dir[0])
+        /* sharing of preprocessed files not enabled */
+        return;
+
+    const char *src = find_analyzed_source(base_name, *pargv);
+    if (!src)
+        return;
+
+    /* look up the preprocessed file, run the preprocessor if not found */
+    shared_tu = ppcache_get(dir, exec_path, *pargv, src, &shared_tu_err);
+    if (!shared_tu)
+        /* failed to preprocess the file, let the tool report it */
+        return;
+
+    /* g++ and clang++ treat *.c files as C++ */
+    const bool cxx = strstr(base_name, "++")
+        || !is_input_file(src, /* enable_cxx */ false);
+
+    char **argv = ppcache_consumer_argv(*pargv, src, shared_tu, cxx);
+    if (!argv) {
+        free(shared_tu);
+        shared_tu = NULL;
+        free(shared_tu_err);
+        shared_tu_err = NULL;
+        return;
+    }
+
+    free(*pargv);
+    *pargv = argv;
+}
+
+/* replay diagnostics of the preprocessor as if the tool emitted them, the
+ * tool does not see the preprocessor flags to emit them by itself */
+static void replay_shared_tu_err(const char *tool)
+{
+    FILE *fp = (shared_tu_err) ? fopen(shared_tu_err, "r") : NULL;
+    if (!fp)
+        return;
+
+    char *buf = NULL;
+    size_t buf_size = 0;
+    ssize_t len;
+    while (0 < (len = getline(&buf, &buf_size, fp)))
+        limit_line(buf, len, tool);
+
+    free(buf);
+    fclose(fp);
+}
+
+/* parse $CSWRAP_CACHE_SIZE [MiB], store the limit in bytes to *plimit */
+static int read_cache_limit(unsigned long long *plimit)
+{
+    unsigned long long size = CACHE_SIZE_DEFAULT;
+    const char *str_size = getenv("CSWRAP_CACHE_SIZE");
+    if (str_size && str_size[0]) {
+        char c;
+        if (1 != sscanf(str_size, "%llu%c", &size, &c))
+            return fail("unable to parse the value of $CSWRAP_CACHE_SIZE");
+
+        if (!size || (ULLONG_MAX >> 20) < size)
+            return fail("the value of $CSWRAP_CACHE_SIZE is out of range");
+    }
+
+    *plimit = size << 20;
+    return EXIT_SUCCESS;
+}
+
+/* return the cache directory if diagnostics of the tool can be cached */
+static const char *cache_dir_for(const char *base_name, char *argv[],
+                                 char *argv_dup[])
+{
+    const char *dir = getenv("CSWRAP_CACHE_DIR");
+    if (!dir || !dir[0])
+        /* cache not enabled */
+        return NULL;
+
+    const char *str_list = getenv("CSWRAP_CACHE_FOR");
+    if (!str_list || !str_list[0] || !tool_in_list(str_list, base_name, argv))
+        return NULL;
+
+    if (profile->flags & TP_NO_CACHE)
+        return NULL;
+
+    if (writes_output_files(argv_dup, is_compiler_name(base_name)))
+        /* we could replay the diagnostics but not the output files */
+        return NULL;
+
+    return dir;
+}
+
+/* key of the cache entry to be stored once the tool exits */
+static const char *cache_dir;
+static uint64_t cache_key;
+static unsigned long long cache_limit;
+
+/* look up diagnostics of the tool in the cache, replay them on cache hit,
+ * return true if the tool should not run (*pstatus is the exit status) */
+static bool replay_from_cache(const char *base_name, const char *exec_path,
+                              char *argv[], char *argv_dup[], int *pstatus)
+{
+    *pstatus = EXIT_SUCCESS;
+    cache_dir = cache_dir_for(base_name, argv, argv_dup);
+    if (!cache_dir)
+        return false;
+
+    *pstatus = read_cache_limit(&cache_limit);
+    if (EXIT_SUCCESS != *pstatus)
+        return true;
+
+    /* compilers are keyed by the preprocessed translation unit, which is
+     * already among the input files if shared via $CSWRAP_PP_CACHE_DIR */
+    const bool preprocess = is_compiler_name(base_name) && !shared_tu;
+    if (!cache_compute_key(&cache_key, exec_path, argv_dup, preprocess)) {
+        /* unable to compute the key, run the tool as usual */
+        cache_dir = NULL;
+        return false;
+    }
+
+    FILE *fp = cache_lookup(cache_dir, cache_key, pstatus);
+    if (!fp)
+        /* cache miss */
+        return false;
+
+    /* lines are stored untranslated so that they go through the filter */
+    init_cap_file_name();
+    char *buf = NULL;
+    size_t buf_size = 0;
+    ssize_t len;
+    while (0 < (len = getline(&buf, &buf_size, fp)))
+        limit_line(buf, len, base_name);
+
+    emit_volume_summary(base_name);
+    free(buf);
+    fclose(fp);
+    cache_dir = NULL;
+    return true;
+}
+
+/* return heap-allocated key "TOOL FILE..." with canonicalized file names */
+static char *create_history_key(const char *base_name)
+{
+    if (!file_list)
+        /* no input files, nothing to key the history by */
+        return NULL;
+
+    char *key = strdup(base_name);
+    struct strlist *it;
+    for (it = file_list; key && it; it = it->next) {
+        char *abs_path = canonicalize_file_name(it->str);
+        char *next_key;
+        if (-1 == asprintf(&next_key, "%s %s", key,
+                    (abs_path) ? abs_path : it->str))
+            next_key = NULL;
+
+        free(abs_path);
+        free(key);
+        key = next_key;
+    }
+
+    return key;
+}
+
+/* shorten tool_timeout based on run times of the tool on the same files */
+static int adapt_timeout_per_history(const char *base_name)
+{
+    const char *dir = getenv("CSWRAP_TIMEOUT_HISTORY");
+    if (!dir || !dir[0])
+        /* history not enabled */
+        return EXIT_SUCCESS;
+
+    /* the derived timeout is never shorter than $CSWRAP_TIMEOUT_MIN */
+    unsigned long floor = HISTORY_FLOOR;
+    const char *str_floor = getenv("CSWRAP_TIMEOUT_MIN");
+    if (str_floor && str_floor[0]) {
+        char c;
+        if (1 != sscanf(str_floor, "%lu%c", &floor, &c))
+            return fail("unable to parse the value of $CSWRAP_TIMEOUT_MIN");
+    }
+
+    history_key = create_history_key(base_name);
+    if (!history_key)
+        return EXIT_SUCCESS;
+
+    struct history hist;
+    if (!history_load(dir, history_key, &hist) || hist.cnt < HISTORY_MIN_RUNS)
+        /* not enough data, keep the static timeout */
+        return EXIT_SUCCESS;
+
+    const unsigned long p90 = history_percentile(&hist, 90U);
+    unsigned long budget = (p90 * HISTORY_FACTOR + 999UL) / 1000UL;
+    if (budget < floor)
+        budget = floor;
+
+    if (budget && budget < tool_timeout) {
+        /* $CSWRAP_TIMEOUT is the cap */
+        tool_timeout = budget;
+        history_runs = hist.cnt;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* record run time of the tool that has just exited or has been killed */
+static void update_history(bool killed)
+{
+    const char *dir = getenv("CSWRAP_TIMEOUT_HISTORY");
+    if (!history_key || !dir || !dir[0])
+        return;
+
+    unsigned long ms = ms_since(&tool_start);
+    if (killed) {
+        if (!timed_out || !history_runs)
+            /* killed by a signal or by the static timeout */
+            return;
+
+        /* killed by the budget derived from the history, record it as a run
+         * of at least the budget so that the next budget grows (up to the
+         * static timeout) instead of killing the tool again and again */
+        const unsigned long budget_ms = tool_timeout * 1000UL;
+        if (ms < budget_ms)
+            ms = budget_ms;
+    }
+
+    history_append(dir, history_key, ms);
+}
+
+/* return heap-allocated absolute path of file, NULL on OOM */
+static char *abs_path_of(const char *file)
+{
+    char *path = canonicalize_file_name(file);
+    if (path || '/' == file[0])
+        return (path) ? path : strdup(file);
+
+    /* the file does not exist (yet) */
+    char *cwd = get_current_dir_name();
+    if (!cwd)
+        return NULL;
+
+    if (-1 == asprintf(&path, "%s/%s", cwd, file))
+        path = NULL;
+
+    free(cwd);
+    return path;
+}
+
+/* load tool profiles from $CSWRAP_PROFILES in addition to the built-in ones */
+static void init_profiles(void)
+{
+    const char *file = getenv("CSWRAP_PROFILES");
+    if (!file || !file[0])
+        return;
+
+    unsigned err_line;
+    if (profiles_load(file, &err_line))
+        return;
+
+    if (err_line)
+        warn("unable to parse %s at line %u, ignoring the rest", file,
+                err_line);
+    else
+        warn("unable to read %s (%s)", file, strerror(errno));
+}
+
+/* key diagnostics in $CSWRAP_CAP_STORE by the tool and its input files */
+static void init_cap_store(const char *base_name, char **argv)
+{
+    const char *dir = getenv("CSWRAP_CAP_STORE");
+    if (!dir || !dir[0])
+        return;
+
+    char *key = NULL;
+    size_t key_len = 0U;
+    FILE *fp = open_memstream(&key, &key_len);
+    if (!fp)
+        return;
+
+    fputs(base_name, fp);
+    const struct strlist *it;
+    for (it = file_list; it; it = it->next) {
+        char *path = abs_path_of(it->str);
+        if (path)
+            fprintf(fp, "\n%s", path);
+        free(path);
+    }
+
+    if (!file_list) {
+        /* no input files, key by the whole command in its directory */
+        char *cwd = get_current_dir_name();
+        fprintf(fp, "\n%s", (cwd) ? cwd : "");
+        free(cwd);
+        for (++argv; *argv; ++argv)
+            fprintf(fp, "\n%s", *argv);
+    }
+
+    if (fclose(fp)) {
+        free(key);
+        return;
+    }
+
+    cap_store_dir = dir;
+    cap_store_key = key;
+}
+
+/* add/del flags per $CSWRAP_RULES, set *pskip if the tool is disabled for all
+ * its input files and can be skipped, return false on OOM */
+static bool apply_rules(char ***pargv, const char *base_name, char *argv[],
+                        bool *pskip)
+{
+    const char *file = getenv("CSWRAP_RULES");
+    if (!file || !file[0] || !file_list)
+        return true;
+
+    unsigned err_line;
+    struct rule *rules = rules_load(file, &err_line);
+    if (!rules) {
+        if (err_line)
+            warn("unable to parse %s at line %u, ignoring it", file, err_line);
+        else
+            warn("unable to read %s (%s)", file, strerror(errno));
+        return true;
+    }
+
+    size_t n_rules = 0U;
+    while (rules[n_rules].paths)
+        ++n_rules;
+
+    /* evaluate the rules for each input file */
+    bool *matched = calloc(n_rules + 1U, sizeof *matched);
+    bool all_disabled = !!matched;
+    const struct strlist *it;
+    for (it = file_list; matched && it; it = it->next) {
+        char *path = abs_path_of(it->str);
+        bool disabled = false;
+        size_t i;
+        for (i = 0U; path && i < n_rules; ++i) {
+            const struct rule *rule = &rules[i];
+            if (!rule_matches(rule, path))
+                continue;
+
+            /* the last matching rule that names the tool decides */
+            matched[i] = true;
+            if (rule->disable && tool_in_list(rule->disable, base_name, argv))
+                disabled = true;
+            if (rule->enable && tool_in_list(rule->enable, base_name, argv))
+                disabled = false;
+        }
+
+        all_disabled &= disabled;
+        free(path);
+    }
+
+    /* apply flags of all rules matched by at least one input file */
+    bool ok = !!matched;
+    size_t i;
+    for (i = 0U; ok && i < n_rules; ++i) {
+        if (!matched[i] || (profile->flags & TP_KEEP_ARGS))
+            continue;
+
+        char **pflag;
+        for (pflag = rules[i].del; ok && pflag && *pflag; ++pflag)
+            ok = handle_flag(pargv, FO_DEL, *pflag);
+        for (pflag = rules[i].add; ok && pflag && *pflag; ++pflag)
+            ok = handle_flag(pargv, FO_ADD, *pflag);
+    }
+
+    /* the build may need the output files of a disabled tool */
+    *pskip = ok && all_disabled
+        && !writes_output_files(*pargv, is_compiler_name(base_name));
+
+    free(matched);
+    rules_free(rules);
+    return ok;
+}
+
+/* record the invocation into $CSWRAP_DEFER_QUEUE if the tool is listed in
+ * $CSWRAP_DEFER_FOR, return true if the tool should not run now */
+static bool defer_tool(const char *base_name, char *argv[], char *argv_dup[])
+{
+    const char *dir = getenv("CSWRAP_DEFER_QUEUE");
+    if (!dir || !dir[0])
+        /* deferred runs not enabled */
+        return false;
+
+    const char *str_list = getenv("CSWRAP_DEFER_FOR");
+    if (!str_list || !str_list[0] || !tool_in_list(str_list, base_name, argv))
+        return false;
+
+    if (writes_output_files(argv_dup, is_compiler_name(base_name)))
+        /* the build may need the output files right now */
+        return false;
+
+    char *key = create_history_key(base_name);
+    const bool ok = queue_push(dir, base_name, argv_dup, key);
+    free(key);
+    if (ok)
+        return true;
+
+    warn("unable to queue %s in %s, running it now", base_name, dir);
+    return false;
+}
+
+/* record the compiler invocation into $CSWRAP_COMPDB_DIR if requested */
+static void record_invocation(const char *base_name, char *argv[],
+                              char *argv_dup[])
+{
+    const char *dir = getenv("CSWRAP_COMPDB_DIR");
+    if (!dir || !dir[0] || !file_list || !is_compiler_name(base_name))
+        return;
+
+    if (!compdb_record(dir, base_name, argv_dup, argv))
+        warn("unable to record invocation of %s in %s", base_name, dir);
+}
+
+/* return true if each input file of the compiler invocation can be processed
+ * by a separate invocation with the same result */
+static bool can_fan_out(char *argv[])
+{
+    unsigned n_inputs = 0U;
+    bool per_file = false;
+    for (++argv; *argv; ++argv) {
+        const char *arg = *argv;
+        if (is_input_file(arg, /* enable_cxx */ true))
+            ++n_inputs;
+        else if (STREQ(arg, "-c") || STREQ(arg, "-S")
+                || STREQ(arg, "-fsyntax-only") || STREQ(arg, "--analyze"))
+            /* each input file is processed on its own */
+            per_file = true;
+        else if (MATCH_PREFIX(arg, "-o") || STREQ(arg, "-E")
+                || STREQ(arg, "-M") || STREQ(arg, "-MM")
+                || MATCH_PREFIX(arg, "-MF"))
+            /* output shared by all input files */
+            return false;
+    }
+
+    return per_file && 1U < n_inputs;
+}
+
+/* run the tool on each input file separately per $CSWRAP_FANOUT_FOR, return
+ * true if the tool has been run that way with the exit status in *pstatus */
+static bool fan_out_tool(const char *base_name, char *argv[], int *pstatus)
+{
+    const char *str_list = getenv("CSWRAP_FANOUT_FOR");
+    if (!str_list || !str_list[0] || !tool_in_list(str_list, base_name, argv)
+            || !is_compiler_name(base_name) || !can_fan_out(argv))
+        return false;
+
+    long max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *str_jobs = getenv("CSWRAP_FANOUT_JOBS");
+    if (str_jobs && str_jobs[0]) {
+        char c;
+        if (1 != sscanf(str_jobs, "%li%c", &max_jobs, &c) || max_jobs < 1L) {
+            warn("unable to parse the value of $CSWRAP_FANOUT_JOBS");
+            return false;
+        }
+    }
+    else if (max_jobs < 1L)
+        max_jobs = 1L;
+
+    size_t argc = 0U, n_inputs = 0U;
+    for (; argv[argc]; ++argc)
+        if (is_input_file(argv[argc], /* enable_cxx */ true))
+            ++n_inputs;
+
+    /* one job per input file, each of them without the other input files */
+    struct runner_job *jobs = calloc(n_inputs, sizeof *jobs);
+    char **args = calloc(n_inputs * (argc + 1U), sizeof *args);
+    if (!jobs || !args) {
+        free(jobs);
+        free(args);
+        return false;
+    }
+
+    size_t i, job = 0U;
+    for (i = 0U; i < argc; ++i) {
+        if (!is_input_file(argv[i], /* enable_cxx */ true))
+            continue;
+
+        char **job_argv = args + job * (argc + 1U);
+        size_t j, dst = 0U;
+        for (j = 0U; j < argc; ++j)
+            if (j == i || !is_input_file(argv[j], /* enable_cxx */ true))
+                job_argv[dst++] = argv[j];
+
+        jobs[job++].argv = job_argv;
+    }
+
+    /* the child processes must not fan out or record the invocation again */
+    unsetenv("CSWRAP_FANOUT_FOR");
+    unsetenv("CSWRAP_COMPDB_DIR");
+
+    /* signals received meanwhile are forwarded to the running jobs */
+    static const struct runner_ops ops = {
+        .ordered        = true,
+        .interrupted    = &pending_signum
+    };
+
+    status_set_state(WS_WAIT_CHILD);
+    struct runner_stats stats = { 0U, 0U };
+    fanout_cnt = n_inputs;
+    fanout_jobs = jobs;
+    run_jobs(jobs, n_inputs, max_jobs, &ops, NULL, &stats);
+    fanout_jobs = NULL;
+
+    /* report the status of the first input file that has failed */
+    int status = EXIT_SUCCESS;
+    for (i = 0U; i < n_inputs && EXIT_SUCCESS == status; ++i) {
+        const int ws = jobs[i].status;
+        if (WIFEXITED(ws))
+            status = WEXITSTATUS(ws);
+        else if (WIFSIGNALED(ws))
+            status = 0x80 + WTERMSIG(ws);
+    }
+
+    if (EXIT_SUCCESS == status && pending_signum)
+        status = 0x80 + pending_signum;
+
+    free(args);
+    free(jobs);
+    *pstatus = status;
+    return true;
+}
+
+static int install_timeout_handler(const char *base_name, char *argv[])
+{
+    const char *str_time = getenv("CSWRAP_TIMEOUT");
+    if (!str_time || !str_time[0] || timeout_disabled_for(base_name, argv))
+        /* no timeout requested */
+        return EXIT_SUCCESS;
+
+    /* parse the timeout value */
+    long timeout;
+    char c;
+    if (1 != sscanf(str_time, "%li%c", &timeout, &c))
+        return fail("unable to parse the value of $CSWRAP_TIMEOUT");
+
+    if (UINT_MAX < timeout || timeout <= 0L)
+        return fail("the value of $CSWRAP_TIMEOUT is out of range");
+
+    /* activate the timeout! */
+    tool_timeout = timeout;
+    const int status = adapt_timeout_per_history(base_name);
+    if (EXIT_SUCCESS != status)
+        return status;
+
+    alarm(tool_timeout);
+    return EXIT_SUCCESS;
+}
+
+static void emit_kill_msg(int signum, const char *base_name, const char *file)
+{
+    char *msg;
+    static const char event[] = "internal warning";
+    int rv;
+    if (timed_out && history_runs)
+        /* tell which budget was applied */
+        rv = asprintf(&msg, "%s: %s: child %d timed out after %us "
+                "(budget derived from %u previous runs)\n",
+                file, event, tool_pid, tool_timeout, history_runs);
+    else if (timed_out)
+        rv = asprintf(&msg, "%s: %s: child %d timed out after %us\n",
+                file, event, tool_pid, tool_timeout);
+    else
+        rv = asprintf(&msg, "%s: %s: child %d terminated by signal %d\n",
+                file, event, tool_pid, signum);
+
+    if (-1 == rv)
+        /* OOM */
         return;
 
     handle_line(msg, base_name);
@@ -809,8 +1833,117 @@ static void destroy_file_list(void)
     }
 }
 
+/* parse str_jobs ("-jN" or NULL) into *pjobs, return false on error */
+static bool parse_jobs(long *pjobs, const char *str_jobs)
+{
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (str_jobs) {
+        char c;
+        if (1 != sscanf(str_jobs, "-j%li%c", &jobs, &c)) {
+            fail("unable to parse the number of jobs: %s", str_jobs);
+            return false;
+        }
+
+        if (jobs < 1L || 1024L < jobs) {
+            fail("the number of jobs is out of range: %s", str_jobs);
+            return false;
+        }
+    }
+    else if (jobs < 1L)
+        jobs = 1L;
+
+    *pjobs = jobs;
+    return true;
+}
+
+/* run all jobs queued in $CSWRAP_DEFER_QUEUE, str_jobs is "-jN" or NULL */
+static int drain_queue(const char *str_jobs)
+{
+    const char *dir = getenv("CSWRAP_DEFER_QUEUE");
+    if (!dir || !dir[0])
+        return fail("$CSWRAP_DEFER_QUEUE is not set");
+
+    long jobs;
+    if (!parse_jobs(&jobs, str_jobs))
+        return EXIT_FAILURE;
+
+    const char *history_dir = getenv("CSWRAP_TIMEOUT_HISTORY");
+    if (history_dir && !history_dir[0])
+        history_dir = NULL;
+
+    return queue_drain(dir, jobs, history_dir);
+}
+
+/* return $CSWRAP_COMPDB_DIR, NULL (with an error printed) if not set */
+static const char *compdb_dir(void)
+{
+    const char *dir = getenv("CSWRAP_COMPDB_DIR");
+    if (dir && dir[0])
+        return dir;
+
+    fail("$CSWRAP_COMPDB_DIR is not set");
+    return NULL;
+}
+
+/* run tool on all invocations recorded in $CSWRAP_COMPDB_DIR */
+static int replay_compdb(const char *tool, const char *str_jobs)
+{
+    const char *dir = compdb_dir();
+    if (!dir)
+        return EXIT_FAILURE;
+
+    long jobs;
+    if (!parse_jobs(&jobs, str_jobs))
+        return EXIT_FAILURE;
+
+    return compdb_replay(dir, tool, jobs);
+}
+
+/* merge records in $CSWRAP_COMPDB_DIR into a compilation database */
+static int merge_compdb(void)
+{
+    const char *dir = compdb_dir();
+    if (!dir)
+        return EXIT_FAILURE;
+
+    const int cnt = compdb_merge(dir);
+    if (cnt < 0)
+        return fail("failed to merge records in %s (%s)", dir,
+                strerror(errno));
+
+    printf("%d entries written to %s/%s\n", cnt, dir, COMPDB_NAME);
+    return EXIT_SUCCESS;
+}
+
 static int handle_args(const int argc, char *argv[])
 {
+    if (argc == 3 && STREQ("--status", argv[1]) && STREQ("--json", argv[2]))
+        return print_status(/* json */ true);
+
+    if (argc == 3 && STREQ("--drain-queue", argv[1]))
+        return drain_queue(argv[2]);
+
+    if (argc == 3 && STREQ("--replay", argv[1]))
+        return replay_compdb(argv[2], NULL);
+
+    if (argc == 4 && STREQ("--replay", argv[1]))
+        return replay_compdb(argv[2], argv[3]);
+
+    if (argc >= 3 && STREQ("--merge-cap", argv[1])) {
+        const bool dedup = STREQ("--dedup", argv[2]);
+        if (dedup && argc == 3)
+            return usage(argv);
+
+        return cap_merge(argv + 2 + dedup, dedup, stdout);
+    }
+
+    if (argc == 3 && STREQ("--dedup-release", argv[1])) {
+        if (dedup_release(argv[2]))
+            return EXIT_SUCCESS;
+
+        return fail("failed to release %s (%s)", argv[2], strerror(errno));
+    }
+
     if (argc != 2)
         /* unsupported count of args for a direct invocation */
         return usage(argv);
@@ -818,6 +1951,36 @@ static int handle_args(const int argc, char *argv[])
     if (STREQ("--force-cap-file-unlock", argv[1]))
         return force_cap_file_unlock();
 
+    if (STREQ("--status", argv[1]))
+        return print_status(/* json */ false);
+
+    if (STREQ("--drain-queue", argv[1]))
+        return drain_queue(NULL);
+
+    if (STREQ("--merge-compdb", argv[1]))
+        return merge_compdb();
+
+    if (STREQ("--cap-store-dump", argv[1])) {
+        const char *dir = getenv("CSWRAP_CAP_STORE");
+        if (!dir || !dir[0])
+            return fail("$CSWRAP_CAP_STORE is not set");
+
+        return cap_store_dump(dir, stdout);
+    }
+
+    if (STREQ("--cache-stats", argv[1])) {
+        const char *dir = getenv("CSWRAP_CACHE_DIR");
+        if (!dir || !dir[0])
+            return fail("$CSWRAP_CACHE_DIR is not set");
+
+        unsigned long long limit;
+        const int status = read_cache_limit(&limit);
+        if (EXIT_SUCCESS != status)
+            return status;
+
+        return print_cache_stats(dir, limit);
+    }
+
     if (STREQ("--print-path-to-wrap", argv[1])) {
         printf("%s\n", path_to_wrap);
         return EXIT_SUCCESS;
@@ -832,6 +1995,9 @@ int main(int argc, char *argv[])
     if (argc < 1)
         return fail("argc < 1");
 
+    /* wall time of the wrapper is reported by $CSWRAP_STATS_FILE */
+    stats_start();
+
     /* obtain base name of the executable being run */
     char *base_name = basename(argv[0]);
     if (STREQ(base_name, prog_name))
@@ -850,20 +2016,26 @@ int main(int argc, char *argv[])
     remove_self_from_path(base_name, path, "cswrap");
 
     /* find the requested tool in $PATH */
-    char *exec_path = find_tool_in_path(base_name, path);
+    char *exec_path = find_tool_in_path(base_name, path, prog_name);
     if (!exec_path) {
         fail("executable not found: %s (%s)", base_name, argv[0]);
         free(base_name);
         return EXIT_FAILURE;
     }
 
+    /* look up behavior specific to the tool */
+    init_profiles();
+    profile = profile_lookup(base_name);
+
     /* do not change anything when compiling conftest.c */
-    if (find_conftest_in_args(argv) || invoked_by_lto_wrapper(argv)) {
+    if (find_conftest_in_args(argv) || invoked_by_lto_wrapper(argv)
+            || (profile->bypass_arg && seek_for_arg(profile->bypass_arg,
+                    argv))) {
         if (MATCH_PREFIX(argv[0], path_to_wrap))
             /* prevent LTO wrapper from picking cswrap again from argv[0] */
             argv[0] = exec_path;
 
-        if (STREQ(base_name, "gclang") || STREQ(base_name, "gclang++"))
+        if (profile->flags & TP_CONFIGURE_ONLY)
             /* prevent gllvm from creating bitcode files */
             if (-1 == setenv("WLLVM_CONFIGURE_ONLY", "1", false))
                 return fail("setenv() failed: %s", strerror(errno));
@@ -873,15 +2045,23 @@ int main(int argc, char *argv[])
     }
 
     /* create a process group for clang so that we can kill it later on */
-    use_pg = STREQ(base_name, "clang")
-        || STREQ(base_name, "clang++");
-    if (use_pg)
-        /* check whether clang is ivoked with --analyze */
-        clang_analyzer = seek_for_arg("--analyze", argv);
-    else
+    use_pg = !!(profile->flags & TP_PROCESS_GROUP);
+    unsigned tr_flags = 0U;
+    if ((profile->flags & TP_ANALYZER_NOTES) && profile->analyzer_arg
+            /* check whether clang is ivoked with --analyze */
+            && seek_for_arg(profile->analyzer_arg, argv))
+        tr_flags |= CSWRAP_ANALYZER_NOTES;
+    if (!use_pg)
         /* `gcc -fanalyzer` also seems to be difficult to kill on timeout */
         use_pg = seek_for_arg("-fanalyzer", argv);
 
+    /* translate paths in output of the tool relative to our cwd */
+    translator = cswrap_translator_new(NULL, base_name, tr_flags);
+    if (!translator) {
+        free(base_name);
+        return fail("insufficient memory to create translator");
+    }
+
     /* collect all input file names and create a list of them */
     collect_file_list(argv);
 
@@ -896,15 +2076,70 @@ int main(int argc, char *argv[])
         return fail("insufficient memory to append a flag");
     }
 
+    /* add/del flags and disable tools for input files per $CSWRAP_RULES */
+    bool skip_tool = false;
+    if (!apply_rules(&argv_dup, base_name, argv, &skip_tool)) {
+        free(base_name);
+        return fail("insufficient memory to apply rules");
+    }
+
+    /* share the set of diagnostics seen by other wrappers of the build */
+    init_dedup();
+
+    /* drop diagnostics located in excluded paths */
+    init_exclude();
+
+    /* limit the volume of diagnostic output */
+    init_volume_limits();
+
+    /* replace diagnostics of the previous run of the tool on the same files */
+    init_cap_store(base_name, argv);
+
+    /* canonicalize paths in structured diagnostics if requested */
+    init_json_rewriter(argv_dup);
+
+    /* announce ourselves to cswrap --status */
+    status_register(base_name, argv);
+
+    /* record the invocation for a later replay by other tools */
+    record_invocation(base_name, argv, argv_dup);
+
+    /* skip a disabled tool or take it off the critical path of the build */
+    int status = EXIT_SUCCESS;
+    if (skip_tool || defer_tool(base_name, argv, argv_dup))
+        goto cleanup;
+
+    /* process the input files by separate invocations of the tool */
+    if (fan_out_tool(base_name, argv, &status))
+        goto cleanup;
+
+    /* reuse output of the preprocessor shared with other invocations */
+    use_shared_tu(base_name, exec_path, &argv_dup);
+
+    /* replay diagnostics of the tool from the cache if available */
+    if (replay_from_cache(base_name, exec_path, argv, argv_dup, &status))
+        goto cleanup;
+
+    /* throttle heavy tools per system pressure and jobserver of make */
+    status = admit_heavy_tool(base_name, argv);
+    if (EXIT_SUCCESS != status)
+        goto cleanup;
+
+    /* do not start the tool if the build has been interrupted meanwhile */
+    if (pending_signum) {
+        fail("interrupted by signal %d before running the tool",
+                (int) pending_signum);
+        status = 0x80 + pending_signum;
+        goto cleanup;
+    }
+
     /* create a pipe from stderr of the compiler to stdin of the filter */
     int pipefd[2];
     if (-1 == pipe(pipefd)) {
-        free(exec_path);
-        free(base_name);
-        return fail("pipe() failed: %s", strerror(errno));
+        status = fail("pipe() failed: %s", strerror(errno));
+        goto cleanup;
     }
 
-    int status;
     tool_pid = fork();
     switch (tool_pid) {
         case -1:
@@ -923,7 +2158,7 @@ int main(int argc, char *argv[])
                 break;
             }
 
-            if (STREQ(base_name, "smatch")
+            if ((profile->flags & TP_CAPTURE_STDOUT)
                     /* smatch writes diagnostic messages to stdout */
                     && -1 == dup2(pipefd[/* wr */ 1], STDOUT_FILENO))
             {
@@ -949,18 +2184,27 @@ int main(int argc, char *argv[])
             /* once duplicated, no longer needed */
             close(pipefd[/* rd */ 0]);
 
+            clock_gettime(CLOCK_MONOTONIC, &tool_start);
             status = install_timeout_handler(base_name, argv);
             if (EXIT_SUCCESS != status)
                 break;
 
+            status_set_child(tool_pid);
+            status_set_state(WS_RUNNING);
+
+            if (cache_dir && !cache_store_begin(cache_dir, cache_key))
+                warn("unable to store diagnostics in %s", cache_dir);
+
             tag_process_name("[cswrap] ", argc, argv);
 
             /* check whether we should capture diagnostic messages to a file */
             init_cap_file_name();
 
+            replay_shared_tu_err(base_name);
             trans_paths_to_abs(/* tool */ base_name);
 
             /* wait for the child to exit */
+            status_set_state(WS_WAIT_CHILD);
             while (-1 == wait(&status)) {
                 if (EINTR != errno) {
                     status = fail("wait() failed: %s", strerror(errno));
@@ -971,11 +2215,15 @@ int main(int argc, char *argv[])
             /* deactivate alarm (if any) */
             alarm(0U);
 
-            if (WIFEXITED(status))
+            if (WIFEXITED(status)) {
                 /* propagate the exit status of the child */
                 status = WEXITSTATUS(status);
+                update_history(/* killed */ false);
+                cache_store_commit(status, cache_limit);
+            }
             else if WIFSIGNALED(status) {
                 const int signum = WTERMSIG(status);
+                update_history(/* killed */ true);
                 emit_kill_diagnostic(signum, base_name);
                 const char *msg = "";
                 if (timed_out)
@@ -989,10 +2237,28 @@ int main(int argc, char *argv[])
     }
 
 cleanup:
+    /* write out the last diagnostic block if it is being buffered */
+    flush_block();
+    report_excluded(base_name);
+
     /* close the capture file and release the lock in case it has been open */
     release_cap_file();
+    cache_store_abort();
+    jobserver_release();
+    status_unregister();
+
+    /* record the overhead of the wrapper if requested */
+    const char *stats_file = getenv("CSWRAP_STATS_FILE");
+    if (stats_file && stats_file[0])
+        stats_write(stats_file, base_name, status);
 
     destroy_file_list();
+    path_set_free(exclude_set);
+    free(shared_tu);
+    free(shared_tu_err);
+    free(history_key);
+    cswrap_translator_free(translator);
+    json_rewriter_free(json_rw);
     free(exec_path);
     free(base_name);
     return status;
@@ -0,0 +1,49 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that emits a diagnostic message and then hangs
+printf '#!/bin/bash
+printf "%%s: warning: still compiling\\n" "$1" >&2
+exec sleep 64\n' > compiler/cc-status
+chmod 0755 compiler/cc-status || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cc-status || exit $?
+
+# listing running wrappers should always succeed
+"$PATH_TO_CSWRAP" --status || exit $?
+"$PATH_TO_CSWRAP" --status --json || exit $?
+
+# run the wrapped compiler in background
+touch status-test.c
+cc-status status-test.c 2>cc-status.out &
+pid="$!"
+
+# wait till the wrapper appears in the list and reads the diagnostic message
+for i in $(seq 50); do
+    sleep .1
+    "$PATH_TO_CSWRAP" --status > status.txt || exit $?
+    grep "^ *$pid .* running .* 1  cc-status status-test.c\$" status.txt && break
+done
+grep "^ *$pid .* cc-status status-test.c\$" status.txt || exit 1
+
+# check the JSON output
+"$PATH_TO_CSWRAP" --status --json > status.json || exit $?
+grep "\"pid\": $pid, .*\"tool\": \"cc-status\", \"files\": \"status-test.c\"}" \
+    status.json || exit 1
+if python3 --version; then
+    python3 -m json.tool status.json || exit 1
+fi
+
+# terminate the wrapper, which should release its slot
+kill "$pid" || exit $?
+wait "$pid"
+test 143 = "$?" || exit 1
+"$PATH_TO_CSWRAP" --status > status.txt || exit $?
+grep "^ *$pid " status.txt && exit 1
+
+# all OK
+exit 0
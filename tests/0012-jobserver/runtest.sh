@@ -0,0 +1,74 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a named pipe to be used as the jobserver
+export JS_FIFO="$PWD/jobserver.fifo"
+rm -f "$JS_FIFO"
+mkfifo "$JS_FIFO" || exit $?
+exec 5<>"$JS_FIFO" || exit $?
+
+# create a faked analyzer that reports whether there is a free job token
+printf '#!/bin/bash
+exec 3<>"$JS_FIFO"
+if read -t .2 -N 1 -u 3 tok; then
+    printf "%%s" "$tok" >&3
+    echo "token available"
+else
+    echo "no token available"
+fi\n' > compiler/analyzer
+chmod 0755 compiler/analyzer || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/analyzer || exit $?
+
+# return true if the jobserver holds exactly one token
+check_one_token() {
+    read -t 1 -N 1 -u 5 tok || return 1
+    read -t .2 -N 1 -u 5 && return 1
+    printf "%s" "$tok" >&5
+}
+
+for auth in "fifo:$JS_FIFO" "5,5"; do
+    export MAKEFLAGS=" -j2 --jobserver-auth=$auth"
+
+    # put one token into the jobserver
+    printf + >&5
+
+    # the token is not taken unless the tool is listed in $CSWRAP_HEAVY_FOR
+    unset CSWRAP_HEAVY_FOR
+    test "token available" = "$(analyzer)" || exit 1
+    check_one_token || exit 1
+
+    # the heavy tool occupies the token while running and returns it on exit
+    export CSWRAP_HEAVY_FOR="cc:analyzer"
+    test "no token available" = "$(analyzer)" || exit 1
+    check_one_token || exit 1
+
+    # $CSWRAP_HEAVY_JOBS=1 means the tool only occupies the job slot from make
+    test "token available" = "$(CSWRAP_HEAVY_JOBS=1 analyzer)" || exit 1
+    check_one_token || exit 1
+
+    # invalid values of $CSWRAP_HEAVY_JOBS are rejected
+    CSWRAP_HEAVY_JOBS=0 analyzer && exit 1
+    CSWRAP_HEAVY_JOBS=x analyzer && exit 1
+    check_one_token || exit 1
+
+    # take the token back
+    read -t 1 -N 1 -u 5 || exit 1
+done
+
+# the wrapper waiting for a job token can be terminated
+analyzer 2>analyzer.out &
+pid="$!"
+sleep 1
+kill "$pid" || exit $?
+wait "$pid"
+test 143 = "$?" || exit 1
+grep '^cswrap: error: interrupted by signal 15 while waiting for job tokens$' \
+    analyzer.out || exit 1
+
+# all OK
+exit 0
@@ -0,0 +1,35 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked analyzer
+printf '#!/bin/bash\necho "$1: warning: analyzed" >&2\n' > compiler/analyzer
+chmod 0755 compiler/analyzer || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/analyzer || exit $?
+touch test.c
+
+# the limit is only checked for heavy tools
+export CSWRAP_PRESSURE_LIMIT="invalid"
+analyzer test.c || exit $?
+
+# invalid limits are rejected
+export CSWRAP_HEAVY_FOR="analyzer"
+for limit in invalid 10x 10:20x 10: -1 101 10:101; do
+    CSWRAP_PRESSURE_LIMIT="$limit" analyzer test.c 2>analyzer.out && exit 1
+    grep '^cswrap: error: .* \$CSWRAP_PRESSURE_LIMIT' analyzer.out || exit 1
+done
+
+# the analyzer is started without delay if the limits cannot be reached
+for limit in 0 100 100:100 0:100 100.0:0; do
+    CSWRAP_PRESSURE_LIMIT="$limit" timeout 5 analyzer test.c 2>analyzer.out \
+        || exit $?
+    grep '^.*/test.c: warning: analyzed <--\[analyzer\]$' analyzer.out \
+        || exit 1
+done
+
+# all OK
+exit 0
@@ -0,0 +1,63 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that sleeps for the given time
+printf '#!/bin/bash\nexec sleep "$1"\n' > compiler/cc-sleep
+chmod 0755 compiler/cc-sleep || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cc-sleep || exit $?
+
+# create an empty history
+export CSWRAP_TIMEOUT_HISTORY="$PWD/history"
+rm -rf "$CSWRAP_TIMEOUT_HISTORY"
+mkdir "$CSWRAP_TIMEOUT_HISTORY" || exit $?
+touch fast.c slow.c
+
+# nothing is recorded unless a timeout is set
+cc-sleep 0 fast.c || exit $?
+test -z "$(ls "$CSWRAP_TIMEOUT_HISTORY")" || exit 1
+
+# record three fast runs
+export CSWRAP_TIMEOUT=30
+export CSWRAP_TIMEOUT_MIN=1
+for i in 1 2 3; do
+    cc-sleep 0 fast.c || exit $?
+done
+test 1 = "$(ls "$CSWRAP_TIMEOUT_HISTORY" | wc -l)" || exit 1
+head -n1 "$CSWRAP_TIMEOUT_HISTORY"/* \
+    | grep "^cc-sleep $PWD/fast.c\$" || exit 1
+test 4 = "$(wc -l < "$CSWRAP_TIMEOUT_HISTORY"/*)" || exit 1
+
+# a slow run on a different file is still bound by the static timeout
+CSWRAP_TIMEOUT=1 cc-sleep 8 slow.c 2>slow.out
+test 143 = "$?" || exit 1
+grep '^.*/slow.c: internal warning: child .* timed out after 1s <--\[cc-sleep\]$' \
+    slow.out || exit 1
+
+# a slow run on the fast file is killed after the derived timeout
+cc-sleep 8 fast.c 2>fast.out
+test 143 = "$?" || exit 1
+grep '^.*/fast.c: internal warning: child .* timed out after 1s (budget derived from 3 previous runs) <--\[cc-sleep\]$' \
+    fast.out || exit 1
+
+# runs killed by the static timeout are not recorded
+test 1 = "$(ls "$CSWRAP_TIMEOUT_HISTORY" | wc -l)" || exit 1
+
+# a run killed by the derived timeout is recorded as long as the budget
+test 5 = "$(wc -l < "$CSWRAP_TIMEOUT_HISTORY"/*)" || exit 1
+tail -n1 "$CSWRAP_TIMEOUT_HISTORY"/* | grep -E '^[0-9]{4,}$' || exit 1
+
+# so the budget grows and the file that got slower is no longer killed
+cc-sleep 2 fast.c 2>fast.out || exit 1
+grep 'internal warning' fast.out && exit 1
+test 6 = "$(wc -l < "$CSWRAP_TIMEOUT_HISTORY"/*)" || exit 1
+
+# invalid value of $CSWRAP_TIMEOUT_MIN is rejected
+CSWRAP_TIMEOUT_MIN=x cc-sleep 0 fast.c && exit 1
+
+# all OK
+exit 0
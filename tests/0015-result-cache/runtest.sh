@@ -0,0 +1,100 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked analyzer that counts its runs and reports the first line
+cat > compiler/lint << 'EOF2'
+#!/bin/bash
+echo run >> runs
+for file in "$@"; do
+    printf '%s:1:1: warning: %s\n' "$file" "$(head -n1 "$file")" >&2
+done
+exit 7
+EOF2
+chmod 0755 compiler/lint || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/lint || exit $?
+
+# create a faked clang that also counts runs of the analyzer
+cat > compiler/clang << 'EOF2'
+#!/bin/bash
+for arg in "$@"; do
+    case "$arg" in
+        -*) ;;
+        *) file="$arg" ;;
+    esac
+done
+for arg in "$@"; do
+    case "$arg" in
+        -E)
+            exec sed -e '/^#/d' "$file"
+            ;;
+        --analyze)
+            echo run >> clang-runs
+            printf '%s:1:1: warning: analyzed\n' "$file" >&2
+            exit 0
+            ;;
+    esac
+done
+exit 0
+EOF2
+chmod 0755 compiler/clang || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/clang || exit $?
+
+export CSWRAP_CACHE_DIR="$PWD/cache"
+export CSWRAP_CACHE_FOR="lint:clang"
+rm -rf "$CSWRAP_CACHE_DIR" runs clang-runs
+echo one > test.c
+
+# the first run is a cache miss, the second one is served from the cache
+lint test.c 2>miss.out
+test 7 = "$?" || exit 1
+lint test.c 2>hit.out
+test 7 = "$?" || exit 1
+test 1 = "$(wc -l < runs)" || exit 1
+diff miss.out hit.out || exit 1
+grep "^$PWD/test.c:1:1: warning: one <--\[lint\]\$" hit.out || exit 1
+
+# changing the input file or the command line invalidates the entry
+echo two > test.c
+lint test.c 2>&1 | grep ': warning: two <--\[lint\]$' || exit 1
+lint ./test.c 2>/dev/null
+test 3 = "$(wc -l < runs)" || exit 1
+
+# the capture file is written also on cache hit
+CSWRAP_CAP_FILE="$PWD/cap.err" lint test.c 2>/dev/null
+test 3 = "$(wc -l < runs)" || exit 1
+grep ': warning: two <--\[lint\]$' cap.err || exit 1
+
+# tools not listed in $CSWRAP_CACHE_FOR always run
+CSWRAP_CACHE_FOR=other lint test.c 2>/dev/null
+test 4 = "$(wc -l < runs)" || exit 1
+
+# invocations writing output files always run
+lint -o test.out test.c 2>/dev/null
+lint -o test.out test.c 2>/dev/null
+test 6 = "$(wc -l < runs)" || exit 1
+
+# compilers are keyed by the preprocessed source (no plist output)
+clang --analyze -Xanalyzer -analyzer-output=text test.c 2>/dev/null || exit $?
+echo '# comment' >> test.c
+clang --analyze -Xanalyzer -analyzer-output=text test.c 2>/dev/null || exit $?
+test 1 = "$(wc -l < clang-runs)" || exit 1
+echo 'int x;' >> test.c
+clang --analyze -Xanalyzer -analyzer-output=text test.c 2>/dev/null || exit $?
+test 2 = "$(wc -l < clang-runs)" || exit 1
+
+# print statistics of the cache
+"$PATH_TO_CSWRAP" --cache-stats > stats.out || exit $?
+cat stats.out
+grep '^hits: *3$' stats.out || exit 1
+grep '^entries: *5$' stats.out || exit 1
+
+# invalid value of $CSWRAP_CACHE_SIZE is rejected
+CSWRAP_CACHE_SIZE=x lint test.c && exit 1
+
+# all OK
+exit 0
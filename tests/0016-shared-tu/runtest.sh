@@ -0,0 +1,102 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that logs its args and runs of the preprocessor
+cat > compiler/gcc << 'EOF2'
+#!/bin/bash
+echo "$*" >> args
+for arg in "$@"; do
+    case "$arg" in
+        *.c|*.i) file="$arg" ;;
+    esac
+done
+for arg in "$@"; do
+    if test "-E" = "$arg"; then
+        echo pp >> pp-runs
+        test -z "$PP_SLEEP" || sleep "$PP_SLEEP"
+        printf '%s:1:1: warning: preprocessed %s\n' "$file" "$*" >&2
+        printf '# 1 "%s"\n' "$file"
+        sed -n 's|^#include "\(.*\)"$|# 1 "\1" 1|p' "$file"
+        exit 0
+    fi
+done
+case "$file" in
+    *.i)
+        # take the name of the source file from the first line marker
+        file="$(sed -n '1s|^# 1 "\(.*\)"$|\1|p' "$file")"
+        ;;
+esac
+printf '%s:1:1: warning: analyzed\n' "$file" >&2
+EOF2
+chmod 0755 compiler/gcc || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/gcc || exit $?
+
+export CSWRAP_PP_CACHE_DIR="$PWD/pp"
+rm -rf "$CSWRAP_PP_CACHE_DIR" args pp-runs
+printf '#include "test.h"\n' > test.c
+touch test.h
+
+# the first analysis-only run produces the preprocessed file
+gcc -fsyntax-only -DFOO -I. test.c 2>out || exit $?
+grep "^$PWD/test.c:1:1: warning: analyzed <--\[gcc\]\$" out || exit 1
+test 1 = "$(wc -l < pp-runs)" || exit 1
+tail -n1 args | grep '^-fsyntax-only -x cpp-output /.*/pp/[0-9a-f]*\.i -x none$' \
+    || exit 1
+
+grep "^$PWD/test.c:1:1: warning: preprocessed -DFOO -I. test.c -E <--\[gcc\]\$" \
+    out || exit 1
+
+# the next analysis-only run reuses it, with the diagnostics of the
+# preprocessor replayed before those of the compiler
+gcc -fsyntax-only -DFOO -I. test.c 2>out || exit $?
+test 1 = "$(wc -l < pp-runs)" || exit 1
+cat out
+test 2 = "$(wc -l < out)" || exit 1
+head -n1 out | grep "^$PWD/test.c:1:1: warning: preprocessed -DFOO" || exit 1
+tail -n1 out | grep "^$PWD/test.c:1:1: warning: analyzed" || exit 1
+
+# warning flags may change diagnostics of the preprocessor
+gcc -fsyntax-only -DFOO -I. -Wall test.c 2>out || exit $?
+test 2 = "$(wc -l < pp-runs)" || exit 1
+grep "preprocessed -DFOO -I. -Wall test.c -E" out || exit 1
+
+# a different macro definition needs a different preprocessed file
+gcc -fsyntax-only -DBAR -I. test.c 2>/dev/null || exit $?
+test 3 = "$(wc -l < pp-runs)" || exit 1
+
+# a change of an included header makes the preprocessed file stale
+sleep 1
+echo changed > test.h
+gcc -fsyntax-only -DFOO -I. test.c 2>/dev/null || exit $?
+test 4 = "$(wc -l < pp-runs)" || exit 1
+
+# invocations that write an object file are left intact
+gcc -c -DFOO -I. test.c -o test.o 2>/dev/null || exit $?
+test 4 = "$(wc -l < pp-runs)" || exit 1
+tail -n1 args | grep '^-c -DFOO -I. test.c -o test.o$' || exit 1
+
+# killing the wrapper kills the preprocessor and the tool is not run then
+rm -f args
+PP_SLEEP=30 gcc -fsyntax-only -DKILL test.c 2>out &
+pid=$!
+for i in $(seq 50); do
+    test 5 = "$(wc -l < pp-runs)" && break
+    sleep .1
+done
+test 5 = "$(wc -l < pp-runs)" || exit 1
+SECONDS=0
+kill "$pid" || exit 1
+wait "$pid"
+test 143 = "$?" || exit 1
+test "$SECONDS" -lt 10 || exit 1
+cat out args
+grep "interrupted by signal 15" out || exit 1
+test 1 = "$(wc -l < args)" || exit 1
+
+# all OK
+exit 0
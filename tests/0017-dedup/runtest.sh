@@ -0,0 +1,57 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that warns about a header and about its input
+cat > compiler/cc-warn << 'EOF2'
+#!/bin/bash
+cat >&2 << EOF3
+In file included from $1:1:
+test.h:1:5: warning: header issue
+    1 | int x;
+      |     ^
+test.h:1:5: note: declared here
+$1:2:1: warning: source issue
+EOF3
+EOF2
+chmod 0755 compiler/cc-warn || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cc-warn || exit $?
+touch a.c b.c test.h
+rm -f cap.err
+
+# use a unique build ID so that parallel runs of the test do not interfere
+export CSWRAP_DEDUP="test-$$"
+"$PATH_TO_CSWRAP" --dedup-release "$CSWRAP_DEDUP" || exit $?
+
+# the first occurrence of the header issue is printed in full
+cc-warn a.c 2>a.out || exit $?
+test 6 = "$(wc -l < a.out)" || exit 1
+grep '^In file included from .*/a.c:1: <--\[cc-warn\]$' a.out || exit 1
+grep '^.*/test.h:1:5: note: declared here <--\[cc-warn\]$' a.out || exit 1
+
+# a duplicate is reduced to its primary line, other issues are kept
+CSWRAP_CAP_FILE="$PWD/cap.err" cc-warn b.c 2>b.out || exit $?
+test 2 = "$(wc -l < b.out)" || exit 1
+grep "^$PWD/test.h:1:5: warning: header issue <--\[cc-warn\]\$" b.out || exit 1
+grep "^$PWD/b.c:2:1: warning: source issue <--\[cc-warn\]\$" b.out || exit 1
+diff b.out cap.err || exit 1
+
+# duplicates can be dropped altogether
+CSWRAP_DEDUP_DROP=1 cc-warn b.c 2>drop.out || exit $?
+test 0 = "$(wc -l < drop.out)" || exit 1
+
+# nothing is deduplicated once the set is released
+"$PATH_TO_CSWRAP" --dedup-release "$CSWRAP_DEDUP" || exit $?
+cc-warn b.c 2>b2.out || exit $?
+test 6 = "$(wc -l < b2.out)" || exit 1
+"$PATH_TO_CSWRAP" --dedup-release "$CSWRAP_DEDUP" || exit $?
+
+# invalid build ID is rejected
+"$PATH_TO_CSWRAP" --dedup-release "../x" && exit 1
+
+# all OK
+exit 0
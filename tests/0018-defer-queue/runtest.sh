@@ -0,0 +1,83 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked analyzer that logs its args and sleeps for a while
+cat > compiler/lint << 'EOF2'
+#!/bin/bash
+echo "$*" >> "$(dirname "$0")/../runs"
+case "$1" in
+    slow.c) sleep 1 ;;
+esac
+printf '%s:1:1: warning: checked\n' "$1" >&2
+test fail.c != "$1"
+EOF2
+chmod 0755 compiler/lint || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/lint || exit $?
+
+export CSWRAP_DEFER_QUEUE="$PWD/queue"
+export CSWRAP_TIMEOUT_HISTORY="$PWD/history"
+rm -rf "$CSWRAP_DEFER_QUEUE" "$CSWRAP_TIMEOUT_HISTORY" runs
+mkdir "$CSWRAP_TIMEOUT_HISTORY" || exit $?
+touch fast.c slow.c
+
+# record run times of both files
+CSWRAP_TIMEOUT=30 lint fast.c 2>/dev/null || exit $?
+CSWRAP_TIMEOUT=30 lint slow.c 2>/dev/null || exit $?
+rm -f runs
+
+# tools not listed in $CSWRAP_DEFER_FOR run inline
+lint fast.c 2>/dev/null || exit $?
+test 1 = "$(wc -l < runs)" || exit 1
+rm -f runs
+
+# listed tools are queued and succeed immediately
+export CSWRAP_DEFER_FOR=lint
+CSWRAP_ADD_CFLAGS=-Wextra lint fast.c 2>out || exit $?
+CSWRAP_ADD_CFLAGS=-Wextra lint slow.c 2>>out || exit $?
+test ! -e runs || exit 1
+test 0 = "$(wc -l < out)" || exit 1
+test 2 = "$(ls "$CSWRAP_DEFER_QUEUE" | grep -c '^job-')" || exit 1
+
+# invocations writing output files are not queued
+lint fast.c -o fast.out 2>/dev/null || exit $?
+test 1 = "$(wc -l < runs)" || exit 1
+rm -f runs
+
+# the queue is drained longest first, flags are not translated again
+"$PATH_TO_CSWRAP" --drain-queue -j1 >drain.out 2>drain.err || exit $?
+cat drain.out drain.err
+grep '^2 jobs drained, 0 failed$' drain.out || exit 1
+test "slow.c -Wextra" = "$(head -n1 runs)" || exit 1
+test "fast.c -Wextra" = "$(tail -n1 runs)" || exit 1
+grep "^$PWD/slow.c:1:1: warning: checked <--\[lint\]\$" drain.err || exit 1
+test 0 = "$(ls "$CSWRAP_DEFER_QUEUE" | grep -c '^job-')" || exit 1
+
+# nothing is left to drain
+"$PATH_TO_CSWRAP" --drain-queue -j4 >drain.out || exit $?
+grep '^0 jobs drained, 0 failed$' drain.out || exit 1
+
+# flags added by $CSWRAP_RULES are not added again when drained
+echo '* add=-DRULE' > rules
+touch rule.c
+CSWRAP_RULES="$PWD/rules" lint rule.c 2>/dev/null || exit $?
+rm -f runs
+"$PATH_TO_CSWRAP" --drain-queue -j1 >drain.out 2>/dev/null || exit $?
+test "rule.c -DRULE" = "$(<runs)" || exit 1
+rm -f runs
+
+# failed jobs are reflected in the exit status
+touch fail.c
+lint fail.c 2>/dev/null || exit $?
+"$PATH_TO_CSWRAP" --drain-queue -j1 >drain.out 2>/dev/null && exit 1
+grep '^1 jobs drained, 1 failed$' drain.out || exit 1
+
+# invalid number of jobs is rejected
+"$PATH_TO_CSWRAP" --drain-queue -jx && exit 1
+
+# all OK
+exit 0
@@ -0,0 +1,92 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that creates the output file
+cat > compiler/gcc << 'EOF2'
+#!/bin/bash
+while test 0 -lt "$#"; do
+    case "$1" in
+        -o) touch "$2"; shift ;;
+    esac
+    shift
+done
+EOF2
+chmod 0755 compiler/gcc || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/gcc || exit $?
+
+# create a faked analyzer that logs its args
+cat > compiler/lint << 'EOF2'
+#!/bin/bash
+echo "$PWD: $*" >> "$(dirname "$0")/../runs"
+printf '%s:1:1: warning: checked\n' "$1" >&2
+EOF2
+chmod 0755 compiler/lint || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/lint || exit $?
+
+export CSWRAP_COMPDB_DIR="$PWD/compdb"
+rm -rf "$CSWRAP_COMPDB_DIR" sub runs
+mkdir sub || exit $?
+touch a.c b.c sub/c.c
+
+# only compiler invocations with input files are recorded
+gcc a.c -o a.o -MD -MF a.d -c || exit $?
+gcc --version || exit $?
+lint a.c 2>/dev/null || exit $?
+(cd sub && CSWRAP_ADD_CFLAGS=-Wextra gcc -c -oc.o c.c) || exit $?
+gcc -DFOO a.c b.c -o prog || exit $?
+test 3 = "$(ls "$CSWRAP_COMPDB_DIR" | grep -c '^rec-')" || exit 1
+
+# a rebuild replaces the older entry of the same file and output
+gcc a.c -o a.o -MD -MF a.d -c -DNEW || exit $?
+
+# merge the records into a compilation database
+"$PATH_TO_CSWRAP" --merge-compdb > merge.out || exit $?
+cat merge.out "$CSWRAP_COMPDB_DIR/compile_commands.json"
+grep "^4 entries written to $CSWRAP_COMPDB_DIR/compile_commands.json\$" \
+    merge.out || exit 1
+test 0 = "$(ls "$CSWRAP_COMPDB_DIR" | grep -c '^rec-')" || exit 1
+grep '"-DNEW"' "$CSWRAP_COMPDB_DIR/compile_commands.json" || exit 1
+test 1 = "$(grep -c '"-Wextra"' "$CSWRAP_COMPDB_DIR/compile_commands.json")" \
+    || exit 1
+test 4 = "$(grep -c '"file"' "$CSWRAP_COMPDB_DIR/compile_commands.json")" \
+    || exit 1
+
+# the merged database is preserved by another merge
+"$PATH_TO_CSWRAP" --merge-compdb > merge.out || exit $?
+grep '^4 entries written' merge.out || exit 1
+
+# replay the invocations by lint without writing any output files
+rm -f a.o sub/c.o prog a.d runs
+echo '* add=-DRULE' > rules
+CSWRAP_ADD_CFLAGS=-Wall CSWRAP_RULES="$PWD/rules" \
+    "$PATH_TO_CSWRAP" --replay lint -j2 > replay.out 2> replay.err || exit $?
+cat replay.out replay.err runs
+grep '^3 commands replayed, 0 failed$' replay.out || exit 1
+test 3 = "$(wc -l < runs)" || exit 1
+
+# the current flags and rules are applied (once) to the original args
+grep -Fx "$PWD: a.c -o/dev/null -c -DNEW -Wall -DRULE" runs || exit 1
+grep -Fx "$PWD/sub: -c -o/dev/null c.c -Wall -DRULE" runs || exit 1
+grep -Fx "$PWD: -DFOO a.c b.c -o/dev/null -Wall -DRULE" runs || exit 1
+grep "^$PWD/a.c:1:1: warning: checked <--\[lint\]\$" replay.err || exit 1
+test ! -e a.o && test ! -e sub/c.o && test ! -e prog && test ! -e a.d \
+    || exit 1
+
+# the replayed invocations are not recorded
+test 0 = "$(ls "$CSWRAP_COMPDB_DIR" | grep -c '^rec-')" || exit 1
+
+# the replay fails if any of the replayed commands fails
+"$PATH_TO_CSWRAP" --replay false > replay.out 2>/dev/null && exit 1
+cat replay.out
+grep '^3 commands replayed, 3 failed$' replay.out || exit 1
+
+# replay needs the directory of records
+CSWRAP_COMPDB_DIR= "$PATH_TO_CSWRAP" --replay lint && exit 1
+
+# all OK
+exit 0
@@ -0,0 +1,109 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that processes its input files one by one, each of
+# them says how long to take and how to exit
+cat > compiler/gcc << 'EOF2'
+#!/bin/bash
+echo "$*" >> "$(dirname "$0")/../runs"
+for arg in "$@"; do
+    case "$arg" in
+        *.c)
+            read delay code < "$arg"
+            sleep "$delay"
+            printf '%s:1:1: warning: processed\n' "$arg" >&2
+            test 0 = "$code" || exit "$code"
+            ;;
+    esac
+done
+EOF2
+chmod 0755 compiler/gcc || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/gcc || exit $?
+
+echo "1 0" > a.c
+echo "0 0" > b.c
+echo "0 0" > c.c
+rm -f runs
+
+# without $CSWRAP_FANOUT_FOR, the tool processes all files by one invocation
+gcc -c a.c b.c c.c 2>out || exit $?
+test 1 = "$(wc -l < runs)" || exit 1
+rm -f runs
+
+# with $CSWRAP_FANOUT_FOR, there is one invocation per file, all in parallel
+export CSWRAP_FANOUT_FOR=gcc
+export CSWRAP_FANOUT_JOBS=3
+gcc -fanalyzer -c a.c b.c -Wall c.c 2>out || exit $?
+cat out runs
+test 3 = "$(wc -l < runs)" || exit 1
+grep -Fx -- "-fanalyzer -c a.c -Wall" runs || exit 1
+grep -Fx -- "-fanalyzer -c b.c -Wall" runs || exit 1
+grep -Fx -- "-fanalyzer -c -Wall c.c" runs || exit 1
+
+# the output is in the order of input files although a.c finished last
+printf "$PWD/%s:1:1: warning: processed <--[gcc]\n" a.c b.c c.c > exp
+diff -u exp out || exit 1
+rm -f runs
+
+# invocations with a shared output file are not split
+gcc -fanalyzer a.c b.c -o prog 2>/dev/null || exit $?
+test 1 = "$(wc -l < runs)" || exit 1
+rm -f runs
+
+# "gcc" in $CSWRAP_FANOUT_FOR means "gcc -fanalyzer"
+gcc -c a.c b.c 2>/dev/null || exit $?
+test 1 = "$(wc -l < runs)" || exit 1
+rm -f runs
+
+# the exit status of the first failing file is propagated
+echo "0 3" > b.c
+echo "0 5" > c.c
+gcc -fanalyzer -c a.c b.c c.c 2>out
+test 3 = "$?" || exit 1
+test 3 = "$(wc -l < runs)" || exit 1
+rm -f runs
+
+# timeout applies to each file separately
+echo "0 0" > a.c
+echo "8 0" > b.c
+echo "0 0" > c.c
+CSWRAP_TIMEOUT=1 gcc -fanalyzer -c a.c b.c c.c 2>out
+test 143 = "$?" || exit 1
+cat out
+grep "^$PWD/b.c: internal warning: child .* timed out after 1s <--\[gcc\]\$" \
+    out || exit 1
+grep "^$PWD/a.c: internal warning" out && exit 1
+grep "^$PWD/c.c:1:1: warning: processed <--\[gcc\]\$" out || exit 1
+
+# killing the wrapper kills the per-file invocations, too
+echo "0 0" > a.c
+echo "30 0" > b.c
+echo "30 0" > c.c
+rm -f runs
+gcc -fanalyzer -c a.c b.c c.c 2>out &
+pid=$!
+for i in $(seq 50); do
+    test 3 = "$(wc -l < runs 2>/dev/null)" && break
+    sleep .1
+done
+test 3 = "$(wc -l < runs)" || exit 1
+sleep .5
+SECONDS=0
+kill "$pid" || exit 1
+wait "$pid"
+test 143 = "$?" || exit 1
+test "$SECONDS" -lt 10 || exit 1
+cat out
+grep "^$PWD/b.c: internal warning: child .* terminated by signal 15 <--\[gcc\]\$" \
+    out || exit 1
+grep "^$PWD/c.c: internal warning: child .* terminated by signal 15 <--\[gcc\]\$" \
+    out || exit 1
+grep "^$PWD/a.c:1:1: warning: processed <--\[gcc\]\$" out || exit 1
+
+# all OK
+exit 0
@@ -0,0 +1,73 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create faked tools that log their args
+for tool in gcc lint; do
+    printf '#!/bin/bash\necho "%s $*" >> "$(dirname "$0")/../runs"\n' \
+        "$tool" > "compiler/$tool"
+    chmod 0755 "compiler/$tool" || exit $?
+    ln -fsv "$PATH_TO_CSWRAP" "wrapper/$tool" || exit $?
+done
+
+rm -rf src gen tests runs
+mkdir -p src gen tests || exit $?
+touch src/a.c src/b.c gen/parser.c tests/t.c
+
+# only src/b.c has been changed by the patch under review
+echo src/b.c > changed.txt
+
+cat > rules << EOF2
+# analyze only sources written by hand
+*               add=-fanalyzer
+gen/            del=-fanalyzer disable=lint
+$PWD/tests/     del=-fanalyzer del=-Werror* disable=lint
+@changed.txt    add=-DCHANGED enable=lint
+EOF2
+export CSWRAP_RULES="$PWD/rules"
+
+# flags are added and deleted per input file
+gcc -c src/a.c -Werror -o a.o || exit $?
+gcc -c gen/parser.c -o parser.o || exit $?
+gcc -c tests/t.c -Werror=format -o t.o || exit $?
+gcc -c src/b.c -o b.o || exit $?
+cat runs
+grep -Fx "gcc -c src/a.c -Werror -o a.o -fanalyzer" runs || exit 1
+grep -Fx "gcc -c gen/parser.c -o parser.o" runs || exit 1
+grep -Fx "gcc -c tests/t.c -o t.o" runs || exit 1
+grep -Fx "gcc -c src/b.c -o b.o -fanalyzer -DCHANGED" runs || exit 1
+rm -f runs
+
+# flags of rules matched by any of the input files apply
+gcc -c src/a.c gen/parser.c || exit $?
+grep -Fx "gcc -c src/a.c gen/parser.c" runs || exit 1
+rm -f runs
+
+# the analyzer runs only if it is enabled for at least one input file
+lint src/a.c || exit $?
+lint gen/parser.c || exit $?
+lint tests/t.c gen/parser.c || exit $?
+lint tests/t.c src/b.c || exit $?
+cat runs
+test 2 = "$(wc -l < runs)" || exit 1
+grep "^lint src/a.c" runs || exit 1
+grep "^lint tests/t.c src/b.c" runs || exit 1
+rm -f runs
+
+# a disabled tool still runs if it writes output files
+lint gen/parser.c -o out || exit $?
+test 1 = "$(wc -l < runs)" || exit 1
+rm -f runs
+
+# an invalid rule file is reported and ignored
+echo "src/ frobnicate=1" > bad-rules
+CSWRAP_RULES="$PWD/bad-rules" lint gen/parser.c 2>err || exit $?
+grep "unable to parse $PWD/bad-rules at line 1" err || exit 1
+test 1 = "$(wc -l < runs)" || exit 1
+
+# all OK
+exit 0
@@ -0,0 +1,76 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that warns about a vendored header and its input
+cat > compiler/cc-warn << 'EOF2'
+#!/bin/bash
+cat >&2 << EOF3
+In file included from $1:1:
+vendor/lib.h:1:5: warning: header issue
+    1 | int x;
+      |     ^
+vendor/lib.h:1:5: note: declared here
+$1:2:1: warning: source issue
+    2 | int y;
+      | ^
+gen/parser.c:3:1: note: generated here
+EOF3
+EOF2
+chmod 0755 compiler/cc-warn || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cc-warn || exit $?
+rm -rf vendor gen cap.err
+mkdir vendor gen || exit $?
+touch a.c vendor/lib.h gen/parser.c
+
+# nothing is excluded by default
+CSWRAP_CAP_FILE="$PWD/cap.err" cc-warn a.c 2>all.out || exit $?
+test 9 = "$(wc -l < all.out)" || exit 1
+diff all.out cap.err || exit 1
+rm -f cap.err
+
+# blocks located in excluded paths are not captured, notes of other blocks
+# referring to excluded paths are kept
+export CSWRAP_EXCLUDE="vendor/:$PWD/gen/*"
+CSWRAP_CAP_FILE="$PWD/cap.err" cc-warn a.c 2>out || exit $?
+cat out cap.err
+test 4 = "$(wc -l < cap.err)" || exit 1
+grep "^$PWD/a.c:2:1: warning: source issue <--\[cc-warn\]\$" cap.err || exit 1
+grep "^$PWD/gen/parser.c:3:1: note: generated here <--\[cc-warn\]\$" cap.err \
+    || exit 1
+grep "header issue" cap.err && exit 1
+
+# they are still printed to stderr with a note how many were dropped
+test 10 = "$(wc -l < out)" || exit 1
+grep "^$PWD/vendor/lib.h:1:5: warning: header issue <--\[cc-warn\]\$" out \
+    || exit 1
+grep '^cswrap: note: 1 diagnostic in excluded paths not captured <--\[cc-warn\]$' \
+    out || exit 1
+rm -f cap.err
+
+# they can be dropped from stderr, too
+CSWRAP_EXCLUDE_STDERR=1 cc-warn a.c 2>out || exit $?
+cat out
+test 5 = "$(wc -l < out)" || exit 1
+grep "header issue" out && exit 1
+grep '^cswrap: note: 1 diagnostic in excluded paths not shown <--\[cc-warn\]$' \
+    out || exit 1
+
+# excluded blocks are not captured even if they are duplicates
+rm -f cap.err
+export CSWRAP_DEDUP="test-$$"
+"$PATH_TO_CSWRAP" --dedup-release "$CSWRAP_DEDUP" || exit $?
+cc-warn a.c 2>/dev/null || exit $?
+CSWRAP_CAP_FILE="$PWD/cap.err" cc-warn a.c 2>out || exit $?
+cat out cap.err
+grep "header issue" cap.err && exit 1
+grep "^$PWD/a.c:2:1: warning: source issue <--\[cc-warn\]\$" cap.err || exit 1
+test 1 = "$(wc -l < cap.err)" || exit 1
+"$PATH_TO_CSWRAP" --dedup-release "$CSWRAP_DEDUP" || exit $?
+
+# all OK
+exit 0
@@ -0,0 +1,95 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that floods its output with diagnostics
+cat > compiler/cc-flood << 'EOF2'
+#!/bin/bash
+file=
+for arg; do
+    case "$arg" in
+        *.c) test -n "$file" || file="$arg" ;;
+        *) cnt="$arg" ;;
+    esac
+done
+for i in $(seq 1 "$cnt"); do
+    printf '%s:%d:1: warning: issue\n    x\n    ^\n' "${file:-x.c}" "$i"
+done >&2
+test -z "$FLOOD_SLEEP" || sleep "$FLOOD_SLEEP"
+EOF2
+chmod 0755 compiler/cc-flood || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cc-flood || exit $?
+touch a.c b.c
+rm -f cap.err
+
+# no limit by default
+cc-flood a.c 1000 2>out || exit $?
+test 3000 = "$(wc -l < out)" || exit 1
+
+# the output is cut once the limit on lines is reached
+export CSWRAP_MAX_LINES=10
+CSWRAP_CAP_FILE="$PWD/cap.err" cc-flood a.c 1000 2>out || exit $?
+cat out
+test 11 = "$(wc -l < out)" || exit 1
+diff out cap.err || exit 1
+grep "^$PWD/a.c:4:1: warning: issue <--\[cc-flood\]\$" out || exit 1
+grep "^$PWD/a.c:5:1: warning: issue <--\[cc-flood\]\$" out && exit 1
+grep "^$PWD/a.c: note: 996 further diagnostics suppressed (2990 lines over the limit) <--\[cc-flood\]\$" \
+    out || exit 1
+
+# a single note is emitted for more input files, or none at all
+CSWRAP_MAX_LINES=5 cc-flood a.c b.c 10 2>out || exit $?
+cat out
+test 6 = "$(wc -l < out)" || exit 1
+grep "^cc-flood: note: 8 further diagnostics suppressed (25 lines over the limit) <--\[cc-flood\]\$" \
+    out || exit 1
+CSWRAP_MAX_LINES=5 cc-flood 10 2>out || exit $?
+cat out
+test 6 = "$(wc -l < out)" || exit 1
+grep "^cc-flood: note: 8 further diagnostics suppressed (25 lines over the limit) <--\[cc-flood\]\$" \
+    out || exit 1
+
+# the capture file is not locked while the rest of the output is drained
+rm -f cap.err
+export CSWRAP_CAP_FILE="$PWD/cap.err"
+FLOOD_SLEEP=5 cc-flood a.c 100 2>/dev/null &
+pid=$!
+sleep 2
+SECONDS=0
+CSWRAP_MAX_LINES=0 cc-flood b.c 1 2>/dev/null || exit $?
+test "$SECONDS" -lt 3 || exit 1
+wait "$pid" || exit $?
+unset CSWRAP_CAP_FILE
+cat cap.err
+test 14 = "$(wc -l < cap.err)" || exit 1
+grep -n "^$PWD/b.c:1:1: warning: issue" cap.err | grep '^11:' || exit 1
+grep -n "^$PWD/a.c: note: 96 further diagnostics suppressed" cap.err \
+    | grep '^14:' || exit 1
+
+# output within the limit is not affected
+cc-flood a.c 3 2>out || exit $?
+test 9 = "$(wc -l < out)" || exit 1
+grep "suppressed" out && exit 1
+
+# the limit on bytes applies, too
+unset CSWRAP_MAX_LINES
+CSWRAP_MAX_BYTES=100 cc-flood a.c 1000 2>out || exit $?
+cat out
+grep "^$PWD/a.c: note: 997 further diagnostics suppressed (2993 lines over the limit) <--\[cc-flood\]\$" \
+    out || exit 1
+
+# the draining is fast enough even for a huge output
+time CSWRAP_MAX_LINES=1 cc-flood a.c 100000 2>out || exit $?
+test 2 = "$(wc -l < out)" || exit 1
+
+# an invalid limit is reported and ignored
+CSWRAP_MAX_LINES=x cc-flood a.c 2 2>out || exit $?
+grep "unable to parse the value of \$CSWRAP_MAX_LINES" out || exit 1
+test 7 = "$(wc -l < out)" || exit 1
+
+# all OK
+exit 0
@@ -0,0 +1,65 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that emits diagnostics in the requested format
+cat > compiler/gcc << 'EOF2'
+#!/bin/bash
+case "$1" in
+    -fdiagnostics-format=json)
+        printf '[{"kind": "warning", "message": "a \\"b\\"", "locations": '
+        printf '[{"caret": {"file": "src/a.c", "line": 2, "column": 1}, '
+        printf '"finish": {"file": "missing.c", "line": 2}}]}]\n'
+        ;;
+    -fdiagnostics-format=sarif-stderr)
+        cat << EOF3
+{"\$schema": "https://json.schemastore.org/sarif-2.1.0.json",
+ "runs": [{"results": [{"ruleId": "-Wunused",
+   "locations": [{"physicalLocation": {"artifactLocation":
+     {"uri": "src/my%20file.c", "uriBaseId": "PWD"},
+     "region": {"startLine": 1}}},
+    {"physicalLocation": {"artifactLocation":
+     {"uri": "https://example.com/a.c"}}}],
+   "message": {"text": "{ not json ["}}]}]}
+src/a.c:3:1: warning: text after SARIF
+EOF3
+        ;;
+esac >&2
+EOF2
+chmod 0755 compiler/gcc || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/gcc || exit $?
+rm -rf src cap.err
+mkdir src || exit $?
+touch src/a.c "src/my file.c"
+
+# file names in GCC JSON are made absolute, other text is kept intact
+CSWRAP_CAP_FILE="$PWD/cap.err" gcc -fdiagnostics-format=json 2>out || exit $?
+cat out
+test 1 = "$(wc -l < out)" || exit 1
+diff out cap.err || exit 1
+grep -F "\"caret\": {\"file\": \"$PWD/src/a.c\", \"line\": 2" out || exit 1
+grep -F '"finish": {"file": "missing.c"' out || exit 1
+grep -F '"message": "a \"b\""' out || exit 1
+if python3 --version; then
+    python3 -m json.tool out >/dev/null || exit 1
+fi
+
+# relative URIs in SARIF are made absolute file URIs, text lines that follow
+# the SARIF log are translated as usual
+gcc -fdiagnostics-format=sarif-stderr 2>out || exit $?
+cat out
+grep -F "{\"uri\": \"file://$PWD/src/my%20file.c\", \"uriBaseId\": \"PWD\"}" \
+    out || exit 1
+grep -F '{"uri": "https://example.com/a.c"}' out || exit 1
+grep -F '"message": {"text": "{ not json ["}' out || exit 1
+grep "^$PWD/src/a.c:3:1: warning: text after SARIF <--\[gcc\]\$" out || exit 1
+if python3 --version; then
+    head -n-1 out | python3 -m json.tool >/dev/null || exit 1
+fi
+
+# all OK
+exit 0
@@ -0,0 +1,72 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that emits a complete diagnostic block
+cat > compiler/cc-warn << 'EOF2'
+#!/bin/bash
+cat >&2 << EOF3
+some unrelated text
+In file included from $1:1:
+lib.h:1:5: warning: header issue [-Wfoo]
+    1 | int x;
+      |     ^
+lib.h:1:5: note: declared here
+lib.h:7: fatal error: no column here
+EOF3
+EOF2
+chmod 0755 compiler/cc-warn || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cc-warn || exit $?
+touch a.c lib.h
+rm -f cap.err cap.jsonl
+
+# the text format is the default
+CSWRAP_CAP_FILE="$PWD/cap.err" cc-warn a.c 2>text.out || exit $?
+diff text.out cap.err || exit 1
+
+# stderr is not affected by the capture format
+export CSWRAP_CAP_FORMAT=jsonl
+CSWRAP_CAP_FILE="$PWD/cap.jsonl" cc-warn a.c 2>out || exit $?
+cat cap.jsonl
+diff text.out out || exit 1
+test 3 = "$(wc -l < cap.jsonl)" || exit 1
+
+if python3 --version; then
+    python3 - "$PWD" << 'EOF2' || exit 1
+import json, sys
+cwd = sys.argv[1]
+recs = [json.loads(line) for line in open("cap.jsonl")]
+assert recs[0] == {"tool": "cc-warn", "text": "some unrelated text"}
+r = recs[1]
+assert r["tool"] == "cc-warn"
+assert r["file"] == cwd + "/lib.h"
+assert (r["line"], r["column"]) == (1, 5)
+assert r["severity"] == "warning"
+assert r["message"] == "header issue [-Wfoo]"
+assert r["context"] == ["In file included from %s/a.c:1:" % cwd]
+assert r["notes"] == [{"file": cwd + "/lib.h", "line": 1, "column": 5,
+                       "severity": "note", "message": "declared here"}]
+assert len(r["snippet"]) == 2
+r = recs[2]
+assert r["line"] == 7 and "column" not in r
+assert r["severity"] == "fatal error" and r["message"] == "no column here"
+EOF2
+fi
+
+# duplicates keep only their primary line
+export CSWRAP_DEDUP="test-$$"
+"$PATH_TO_CSWRAP" --dedup-release "$CSWRAP_DEDUP" || exit $?
+rm -f cap.jsonl
+cc-warn a.c 2>/dev/null || exit $?
+CSWRAP_CAP_FILE="$PWD/cap.jsonl" cc-warn a.c 2>/dev/null || exit $?
+cat cap.jsonl
+grep '"header issue' cap.jsonl || exit 1
+grep '"snippet"' cap.jsonl && exit 1
+"$PATH_TO_CSWRAP" --dedup-release "$CSWRAP_DEDUP" || exit $?
+
+# all OK
+exit 0
@@ -0,0 +1,73 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# capture files written by two build nodes
+cat > node1.err << EOF
+In file included from /src/a.c:1:
+/src/lib.h:1:5: warning: header issue <--[gcc]
+    1 | int x;
+      |     ^
+/src/lib.h:1:5: note: declared here <--[gcc]
+/src/a.c:2:1: warning: source issue <--[gcc]
+/src/c.c:3:1: warning: node1 only <--[gcc]
+EOF
+cat > node2.err << EOF
+/src/b.c:1:1: error: other issue <--[clang]
+In file included from /src/a.c:1:
+/src/lib.h:1:5: warning: header issue <--[gcc]
+    1 | int x;
+      |     ^
+/src/lib.h:1:5: note: declared here <--[gcc]
+EOF
+
+# the result does not depend on the order of input files
+"$PATH_TO_CSWRAP" --merge-cap node1.err node2.err > out12 || exit $?
+"$PATH_TO_CSWRAP" --merge-cap node2.err node1.err > out21 || exit $?
+cat out12
+diff out12 out21 || exit 1
+test 13 = "$(wc -l < out12)" || exit 1
+diff <(sort out12) <(cat node1.err node2.err | sort) || exit 1
+
+# blocks are never split, blocks of each file keep their order
+test 2 = "$(grep -A1 '^In file included' out12 | grep -c 'header issue')" \
+    || exit 1
+test "$(grep -n 'source issue' out12 | cut -d: -f1)" \
+    -lt "$(grep -n 'node1 only' out12 | cut -d: -f1)" || exit 1
+
+# messages of one invocation are not split by messages of other nodes
+printf '%s\n' "/src/a.c:5:1: warning: first <--[gcc]" \
+    "/src/z.h:1:1: warning: second <--[gcc]" > run1.err
+printf '%s\n' "/src/b.c:1:1: warning: other <--[gcc]" > run2.err
+"$PATH_TO_CSWRAP" --merge-cap run2.err run1.err > out || exit $?
+cat run1.err run2.err | diff - out || exit 1
+
+# duplicate blocks are dropped if asked to
+"$PATH_TO_CSWRAP" --merge-cap --dedup node1.err node2.err > out 2>err \
+    || exit $?
+cat out err
+test 8 = "$(wc -l < out)" || exit 1
+test 1 = "$(grep -c 'header issue' out)" || exit 1
+grep '^cswrap: note: 4 blocks merged, 1 duplicates dropped$' err || exit 1
+
+# compressed files are decompressed on the fly
+if gzip --version; then
+    gzip -c node2.err > node2.err.gz || exit $?
+    "$PATH_TO_CSWRAP" --merge-cap node1.err node2.err.gz > out || exit $?
+    diff out12 out || exit 1
+fi
+
+# JSON Lines records are merged as they are
+printf '{"tool": "gcc", "text": "b"}\n{"tool": "gcc", "text": "a"}\n' > a.jsonl
+printf '{"tool": "gcc", "text": "a"}\n' > b.jsonl
+"$PATH_TO_CSWRAP" --merge-cap --dedup a.jsonl b.jsonl > out 2>/dev/null \
+    || exit $?
+cat out
+test 2 = "$(wc -l < out)" || exit 1
+
+# a missing file is an error
+"$PATH_TO_CSWRAP" --merge-cap node1.err missing.err > out && exit 1
+test 7 = "$(wc -l < out)" || exit 1
+
+# all OK
+exit 0
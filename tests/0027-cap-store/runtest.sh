@@ -0,0 +1,69 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that warns about each line of its input file
+cat > compiler/cc-warn << 'EOF'
+#!/bin/bash
+n=0
+while read -r line; do
+    n=$((n + 1))
+    echo "$1:$n:1: warning: $line" >&2
+done < "$1"
+EOF
+chmod 0755 compiler/cc-warn || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cc-warn || exit $?
+
+rm -rf store
+export CSWRAP_CAP_STORE="$PWD/store"
+"$PATH_TO_CSWRAP" --cap-store-dump && exit 1
+
+# diagnostics of both files are stored
+echo "a1" > a.c
+echo "b1" > b.c
+cc-warn a.c 2>/dev/null || exit $?
+cc-warn b.c 2>/dev/null || exit $?
+"$PATH_TO_CSWRAP" --cap-store-dump > out || exit $?
+cat out
+test 2 = "$(wc -l < out)" || exit 1
+grep "^$PWD/a.c:1:1: warning: a1 <--\[cc-warn\]\$" out || exit 1
+
+# a recompile replaces diagnostics of the file instead of appending them
+printf 'a2\na3\n' > a.c
+cc-warn a.c 2>/dev/null || exit $?
+"$PATH_TO_CSWRAP" --cap-store-dump > out || exit $?
+cat out
+test 3 = "$(wc -l < out)" || exit 1
+grep "a1" out && exit 1
+grep "^$PWD/b.c:1:1: warning: b1 <--\[cc-warn\]\$" out || exit 1
+
+# the key does not depend on the working directory
+(cd store && cc-warn ../b.c 2>/dev/null) || exit $?
+"$PATH_TO_CSWRAP" --cap-store-dump > out || exit $?
+test 3 = "$(wc -l < out)" || exit 1
+
+# a recompile without diagnostics removes them
+: > a.c
+cc-warn a.c 2>/dev/null || exit $?
+"$PATH_TO_CSWRAP" --cap-store-dump > out || exit $?
+cat out
+test 1 = "$(wc -l < out)" || exit 1
+grep "b1" out || exit 1
+
+# superseded records are eventually compacted away
+seq 1 2000 > a.c
+for i in $(seq 20); do
+    cc-warn a.c 2>/dev/null || exit $?
+done
+ls -l store
+"$PATH_TO_CSWRAP" --cap-store-dump > out || exit $?
+test 2001 = "$(wc -l < out)" || exit 1
+test 1 = "$(ls store/*.seg | wc -l)" || exit 1
+test "$(stat -c %s store/*.seg)" -lt "$((10 * $(wc -c < out)))" || exit 1
+
+# all OK
+exit 0
@@ -0,0 +1,67 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked analyzer that writes diagnostics to both stdout and stderr,
+# and reports its arguments
+cat > compiler/my-lint << 'EOF'
+#!/bin/bash
+echo "args: $*" > args.txt
+echo "$1:1:1: warning: on stdout"
+echo "$1:2:1: note: on stderr" >&2
+EOF
+chmod 0755 compiler/my-lint || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/my-lint || exit $?
+touch a.c
+export CSWRAP_ADD_CFLAGS="-Wextra"
+
+# an unknown tool gets the generic treatment
+my-lint a.c > out 2> err || exit $?
+cat out err
+grep "^a.c:1:1: warning: on stdout\$" out || exit 1
+grep "^$PWD/a.c:2:1: note: on stderr <--\[my-lint\]\$" err || exit 1
+grep "^args: a.c -Wextra\$" args.txt || exit 1
+
+# the tool gets the behavior declared by its profile
+cat > profiles << 'EOF'
+# tool      options
+my-lint     capture-stdout keep-args bypass-arg=--version
+EOF
+export CSWRAP_PROFILES="$PWD/profiles"
+my-lint a.c > out 2> err || exit $?
+cat out err
+test 0 = "$(wc -l < out)" || exit 1
+grep "^$PWD/a.c:1:1: warning: on stdout <--\[my-lint\]\$" err || exit 1
+grep "^args: a.c\$" args.txt || exit 1
+
+# the tool is executed directly if the bypass arg is given
+my-lint a.c --version > out 2> err || exit $?
+grep "^a.c:1:1: warning: on stdout\$" out || exit 1
+grep "^a.c:2:1: note: on stderr\$" err || exit 1
+
+# a profile in the file replaces the built-in one
+cat > compiler/cppcheck << 'EOF'
+#!/bin/bash
+echo "args: $*" > args.txt
+EOF
+chmod 0755 compiler/cppcheck || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cppcheck || exit $?
+export CSWRAP_ADD_CXXFLAGS="-Wextra"
+unset CSWRAP_PROFILES
+cppcheck a.c || exit $?
+grep "^args: a.c\$" args.txt || exit 1
+echo "cppcheck no-cache" >> profiles
+CSWRAP_PROFILES="$PWD/profiles" cppcheck a.c || exit $?
+grep "^args: a.c -Wextra\$" args.txt || exit 1
+
+# an invalid profile is reported
+echo "my-lint no-such-option" > profiles
+CSWRAP_PROFILES="$PWD/profiles" my-lint a.c > out 2> err || exit $?
+grep "unable to parse $PWD/profiles at line 1" err || exit 1
+
+# all OK
+exit 0
@@ -0,0 +1,54 @@
+#include "cswrap-translate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void capture(const char *line, size_t len, void *ctx)
+{
+    fwrite(line, 1U, len, (FILE *) ctx);
+}
+
+static void drain(struct cswrap_translator *tr)
+{
+    const char *line;
+    size_t len;
+    while ((line = cswrap_next_line(tr, &len)))
+        fwrite(line, 1U, len, stdout);
+}
+
+/* usage: client CWD TOOL [--analyze] < OUTPUT_OF_TOOL */
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+        return EXIT_FAILURE;
+
+    const unsigned flags = (3 < argc && !strcmp(argv[3], "--analyze"))
+        ? CSWRAP_ANALYZER_NOTES
+        : 0U;
+
+    struct cswrap_translator *tr = cswrap_translator_new(argv[1], argv[2],
+            flags);
+    FILE *cap = fopen("cap.out", "w");
+    if (!tr || !cap)
+        return EXIT_FAILURE;
+
+    cswrap_set_capture(tr, capture, cap);
+
+    /* feed the output in small chunks to exercise the line buffering */
+    char buf[7];
+    ssize_t len;
+    while (0 < (len = read(STDIN_FILENO, buf, sizeof buf))) {
+        if (!cswrap_feed(tr, buf, len))
+            return EXIT_FAILURE;
+        drain(tr);
+    }
+
+    if (!cswrap_finish(tr))
+        return EXIT_FAILURE;
+    drain(tr);
+
+    cswrap_translator_free(tr);
+    return (fclose(cap)) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
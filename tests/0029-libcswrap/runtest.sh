@@ -0,0 +1,62 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# build a client of libcswrap
+LIB="$PATH_TO_CSEXEC_LIBS/libcswrap.so"
+test -e "$LIB" || exit 42
+"${CC:-cc}" -o client -I "$TEST_SRC_DIR/../../src" "$TEST_SRC_DIR/client.c" \
+    "$LIB" -Wl,-rpath,"$PATH_TO_CSEXEC_LIBS" || exit 42
+
+# paths are resolved relative to the given directory, not our cwd
+rm -rf src
+mkdir -p src/inc
+touch src/a.c src/inc/lib.h
+printf '%s\n' \
+    "In file included from a.c:1:" \
+    "inc/lib.h:1:5: warning: header issue" \
+    "    1 | int x;" \
+    "tool: not a file" \
+    "missing.c:1:1: error: no such file" \
+    > input.txt
+printf 'a.c:2:1: note: no new-line' >> input.txt
+
+./client src my-tool < input.txt > out || exit $?
+cat out cap.out
+printf '%s\n' \
+    "In file included from $PWD/src/a.c:1: <--[my-tool]" \
+    "$PWD/src/inc/lib.h:1:5: warning: header issue <--[my-tool]" \
+    "    1 | int x;" \
+    "tool: not a file" \
+    "missing.c:1:1: error: no such file" \
+    > exp.txt
+printf '%s' "$PWD/src/a.c" >> exp.txt
+diff -u exp.txt out || exit 1
+diff out cap.out || exit 1
+
+# the output is the same as the one of cswrap for the same input
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+printf '#!/bin/sh\ncat "%s" >&2\n' "$PWD/input.txt" > compiler/my-tool
+chmod 0755 compiler/my-tool || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/my-tool || exit $?
+(cd src && exec my-tool 2> ../cswrap.out)
+diff out cswrap.out || exit 1
+
+# notes of clang analyzer are captured but not shown
+printf '%s\n' \
+    "a.c:1:1: warning: issue" \
+    "a.c:1:2: note: step" \
+    "    1 | int x;" \
+    "      | ^" \
+    "plain line" \
+    > input.txt
+./client "$PWD/src" clang --analyze < input.txt > out || exit $?
+cat out cap.out
+test 2 = "$(wc -l < out)" || exit 1
+grep "^plain line\$" out || exit 1
+test 5 = "$(wc -l < cap.out)" || exit 1
+grep "^$PWD/src/a.c:1:2: note: step <--\[clang\]\$" cap.out || exit 1
+
+# all OK
+exit 0
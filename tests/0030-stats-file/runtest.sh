@@ -0,0 +1,49 @@
+#!/bin/bash
+source "$1/../testlib.sh"
+set -x
+
+# create hashed directories for compilers and wrappers
+mkdir -p compiler wrapper
+export PATH="$PWD/wrapper:$PWD/compiler:$PATH"
+
+# create a faked compiler that emits 3 lines of diagnostics
+cat > compiler/cc-stats << 'EOF'
+#!/bin/bash
+printf 'a.c:1:1: warning: first\na.c:2:1: warning: second\nplain text\n' >&2
+exit 7
+EOF
+chmod 0755 compiler/cc-stats || exit $?
+ln -fsv "$PATH_TO_CSWRAP" wrapper/cc-stats || exit $?
+touch a.c
+rm -f cap.err stats.jsonl
+
+# one record per invocation, the exit status of the tool is recorded
+export CSWRAP_STATS_FILE="$PWD/stats.jsonl"
+cc-stats 2>/dev/null
+test 7 = "$?" || exit 1
+CSWRAP_CAP_FILE="$PWD/cap.err" cc-stats 2>/dev/null
+cat stats.jsonl
+test 2 = "$(wc -l < stats.jsonl)" || exit 1
+test 2 = "$(grep -c '"tool": "cc-stats", "status": 7' stats.jsonl)" || exit 1
+test 2 = "$(grep -c '"lines": 3}' stats.jsonl)" || exit 1
+
+# only the invocation with the capture file waited for its lock
+test 1 = "$(grep -c '"lock_waits": 0' stats.jsonl)" || exit 1
+test 1 = "$(grep -c '"lock_waits": 1' stats.jsonl)" || exit 1
+
+# records of concurrent wrappers do not interleave
+rm -f stats.jsonl
+for i in $(seq 16); do
+    CSWRAP_CAP_FILE="$PWD/cap.err" cc-stats 2>/dev/null &
+done
+wait
+test 16 = "$(grep -c '^{"pid": [0-9]*, .*"lines": 3}$' stats.jsonl)" || exit 1
+
+if python3 --version; then
+    python3 -c '
+import json, sys
+for line in open(sys.argv[1]):
+    rec = json.loads(line)
+    assert rec["wall_us"] >= rec["lock_wait_us"]
+' stats.jsonl || exit 1
+fi
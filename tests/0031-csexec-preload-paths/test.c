@@ -0,0 +1,56 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void print_links(const char *exe)
+{
+    char path[PATH_MAX + 1] = { 0 };
+    assert(readlink(exe, path, PATH_MAX) != -1);
+    puts(path);
+
+    char path_at[PATH_MAX + 1] = { 0 };
+    assert(readlinkat(AT_FDCWD, exe, path_at, PATH_MAX) != -1);
+    puts(path_at);
+
+    char *real = realpath(exe, NULL);
+    assert(real);
+    puts(real);
+    free(real);
+
+    char resolved[PATH_MAX];
+    assert(realpath(exe, resolved));
+    puts(resolved);
+
+    char *cfn = canonicalize_file_name(exe);
+    assert(cfn);
+    puts(cfn);
+    free(cfn);
+}
+
+int main(void)
+{
+    print_links("/proc/self/exe");
+    fflush(stdout);
+
+    // the links still point to the same file after the working dir changes
+    assert(chdir("/") == 0);
+
+    // the cached PID needs to be refreshed in the child
+    const pid_t pid = fork();
+    assert(pid != -1);
+    if (!pid) {
+        char exe[64];
+        snprintf(exe, sizeof exe, "/proc/%d/exe", getpid());
+        print_links(exe);
+        return 0;
+    }
+
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    return WEXITSTATUS(status);
+}